@@ -38,6 +38,12 @@ class AssetAPI {
     virtual FileBuffer loadFile(const std::string& fullpath) = 0;
     // open a file bundled with the game, in assets/ or assetspc/
     virtual FileBuffer loadAsset(const std::string& asset) = 0;
+    // read-only access to a bundled file, memory mapped when the platform
+    // allows it (default: loadAsset copy). Must be released with unmapAsset.
+    virtual FileBuffer mapAsset(const std::string& asset) {
+        return loadAsset(asset);
+    }
+    virtual void unmapAsset(const FileBuffer& fb) { delete[] fb.data; }
 
     // get the list of filenames in directory containing "extension" in their
     // name
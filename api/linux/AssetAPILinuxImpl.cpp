@@ -43,6 +43,8 @@
 #else
 #include <dirent.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #endif
 
 #if SAC_IOS
@@ -128,8 +130,7 @@ FileBuffer AssetAPILinuxImpl::loadFile(const std::string& full) {
 #if SAC_IOS
 static char* assetPath = NULL;
 #endif
-FileBuffer AssetAPILinuxImpl::loadAsset(const std::string& asset) {
-    FileBuffer fb;
+static std::string assetFullPath(const std::string& asset) {
 #if SAC_IOS
     if (!assetPath) {
         CFURLRef url = CFBundleCopyResourcesDirectoryURL(mainBundle);
@@ -146,14 +147,19 @@ FileBuffer AssetAPILinuxImpl::loadAsset(const std::string& asset) {
         }
         CFRelease(url);
     }
-    std::string full = assetPath + asset;
+    return assetPath + asset;
 #else
 #ifdef SAC_ASSETS_DIR
-    std::string full = SAC_ASSETS_DIR + asset;
+    return SAC_ASSETS_DIR + asset;
 #else
-    std::string full = "assets/" + asset;
+    return "assets/" + asset;
 #endif
 #endif
+}
+
+FileBuffer AssetAPILinuxImpl::loadAsset(const std::string& asset) {
+    FileBuffer fb;
+    std::string full = assetFullPath(asset);
     fb = loadFile(full);
 #if SAC_DESKTOP
     if (fb.data == 0) {
@@ -169,6 +175,42 @@ FileBuffer AssetAPILinuxImpl::loadAsset(const std::string& asset) {
     return fb;
 }
 
+#if !SAC_WINDOWS && !SAC_EMSCRIPTEN
+static FileBuffer mapFile(const std::string& full) {
+    FileBuffer fb;
+    int fd = open(full.c_str(), O_RDONLY);
+    if (fd < 0)
+        return fb;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            fb.data = (uint8_t*)p;
+            fb.size = st.st_size;
+        }
+    }
+    close(fd);
+    return fb;
+}
+
+FileBuffer AssetAPILinuxImpl::mapAsset(const std::string& asset) {
+    std::string full = assetFullPath(asset);
+    FileBuffer fb = mapFile(full);
+#if SAC_DESKTOP
+    if (fb.data == 0) {
+        full.replace(full.find("assets/"), strlen("assets/"), "assetspc/");
+        fb = mapFile(full);
+    }
+#endif
+    return fb;
+}
+
+void AssetAPILinuxImpl::unmapAsset(const FileBuffer& fb) {
+    if (fb.data)
+        munmap(fb.data, fb.size);
+}
+#endif
+
 std::list<std::string> AssetAPILinuxImpl::listContent(const std::string& directory, const std::string& extension, const std::string& subfolder) {
     std::list<std::string> content;
     std::string realDirectory = directory +  "/" + subfolder + "/";
@@ -30,6 +30,10 @@ class AssetAPILinuxImpl : public AssetAPI {
 
     FileBuffer loadFile(const std::string& full);
     FileBuffer loadAsset(const std::string& asset);
+#if !SAC_WINDOWS && !SAC_EMSCRIPTEN
+    FileBuffer mapAsset(const std::string& asset);
+    void unmapAsset(const FileBuffer& fb);
+#endif
 
     std::list<std::string> listContent(const std::string& directory,
                                        const std::string& extension,
@@ -83,6 +83,7 @@
 
 #include "util/Recorder.h"
 #include "util/Draw.h"
+#include "util/WorkerPool.h"
 
 #include "api/sdl/JoystickAPISDLImpl.h"
 #include "api/sdl/MouseNativeTouchState.h"
@@ -176,12 +177,14 @@ struct CommandLineOptions {
         restore = false;
         verbose = 0;
         forceEtc1 = false;
+        decodedTextureCache = false;
         headless = false;
         profiler = false;
     }
     bool restore;
     int verbose;
     bool forceEtc1;
+    bool decodedTextureCache;
     bool headless;
     bool profiler;
 };
@@ -365,8 +368,24 @@ int setupEngine(void* _game, const SetupInfo* info) {
         static_cast<SoundAPILinuxOpenALImpl*>(ctx->soundAPI)->init(ctx->assetAPI, game->wantsAPI(ContextAPI::Music));
         theSoundSystem.init();
     }
+    #if SAC_ENABLE_PROFILING
+        // started before sacInit to record the startup timeline
+        if (options.profiler)
+            startProfiler();
+    #endif
+
+    // Localization is only needed by game->init: read it while sacInit
+    // loads the other startup assets
+    WorkerPool localizeLoader(1);
     if (game->wantsAPI(ContextAPI::Localize)) {
-        static_cast<LocalizeAPITextImpl*>(ctx->localizeAPI)->init(ctx->assetAPI, getLocaleInfo().c_str());
+        LocalizeAPITextImpl* localizeAPI = static_cast<LocalizeAPITextImpl*>(ctx->localizeAPI);
+        AssetAPI* assetAPI = ctx->assetAPI;
+        const std::string locale = getLocaleInfo();
+        localizeLoader.submit([localizeAPI, assetAPI, locale] () -> void {
+            PROFILE("Startup", "load-localization", BeginEvent);
+            localizeAPI->init(assetAPI, locale.c_str());
+            PROFILE("Startup", "load-localization", EndEvent);
+        });
     }
 
     /////////////////////////////////////////////////////
@@ -379,7 +398,11 @@ int setupEngine(void* _game, const SetupInfo* info) {
     if (options.forceEtc1) {
         OpenGLTextureCreator::forceEtc1Usage();
     }
+    if (options.decodedTextureCache) {
+        OpenGLTextureCreator::enableDecodedCache();
+    }
 
+    localizeLoader.waitAll();
     game->init(state, size);
 
     if (!options.headless)
@@ -391,11 +414,6 @@ int setupEngine(void* _game, const SetupInfo* info) {
         emscripten_set_main_loop(updateAndRender, 0, 0);
     #else
 
-    #if SAC_ENABLE_PROFILING
-        if (options.profiler)
-            startProfiler();
-    #endif
-
     // SDL_JoystickEventState(SDL_ENABLE);
 
     //used for text translation, if needed
@@ -525,6 +543,7 @@ static CommandLineOptions parseCommandLineOption(int argc, char** argv) {
         options.verbose |= !strcmp(argv[i], "--verbose");
         options.headless |= !strcmp(argv[i], "--headless");
         options.forceEtc1 |= !strcmp(argv[i], "--force-etc1");
+        options.decodedTextureCache |= !strcmp(argv[i], "--decoded-texture-cache");
         options.profiler |= !strcmp("-profile", argv[i]);
     #if SAC_INGAME_EDITORS
         if (!strcmp(argv[i], "--debug-area-width") ||
@@ -38,7 +38,7 @@ throw()
 
 EntityManager* EntityManager::instance = 0;
 
-EntityManager::EntityManager() : nextEntity(1) {
+EntityManager::EntityManager() : createdEntityCount(0), deletedEntityCount(0), nextEntity(1) {
     LOGT("audit if System::entityComponents is needed - could be replaced by: if (entities[e] & TransformationSystemBit)");
     LOGT("audit if EntityManager::entityComponents is needed. Lot of duplicated info");
     LOGT("audit if EntityManager::permanentEntities is still useful");
@@ -46,10 +46,6 @@ EntityManager::EntityManager() : nextEntity(1) {
     LOGT("addComponentsToEntities(int N, system1, system2, null)");
     LOGT("DeleteEntities(int N);");
     LOGT("DeleteEntities(int N, system1, system2, null);");
-    LOGT("benchmark 0 emitter");
-    LOGT("benchmark 1 emitter 50, 200, 1000");
-    LOGT("benchmark 2 emitter 50, 200, 1000");
-    LOGT("benchmark 3 emitter 50, 200, 1000");
 }
 
 EntityManager* EntityManager::Instance() {
@@ -74,6 +70,7 @@ void EntityManager::renameEntity(Entity e, hash_t id) {
 
 Entity EntityManager::CreateEntity(const hash_t id, EntityType::Enum type, EntityTemplateRef tmpl) {
     Entity e = 0;
+    createdEntityCount++;
 
     // Reuse id if possible
     if (recyclableEntities.empty()) {
@@ -177,6 +174,7 @@ void EntityManager::DeleteEntity(Entity e) {
         (*it)->Delete(e);
     }
     entityComponents.erase(e);
+    deletedEntityCount++;
 
 
 #if SAC_LINUX && SAC_DESKTOP
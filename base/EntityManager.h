@@ -80,6 +80,8 @@ class EntityManager {
 #endif
 
     int getNumberofEntity() { return entityComponents.size(); }
+    // entities created/deleted since startup (entity churn)
+    unsigned createdEntityCount, deletedEntityCount;
 
 #if SAC_DEBUG
     void validateEntity(Entity e) const;
@@ -66,11 +66,12 @@
 
 #include "systems/opengl/OpenGLTextureCreator.h"
 
-#include "util/DataFileParser.h"
+#include "util/CompiledAssets.h"
 #include "util/Draw.h"
 #include "util/Recorder.h"
 #include "util/Random.h"
 #include "util/LevelEditor.h"
+#include "util/WorkerPool.h"
 
 #if ! SAC_MOBILE
 #include <SDL2/SDL_events.h>
@@ -85,6 +86,8 @@
 
 
 #include <sstream>
+#include <functional>
+#include <set>
 
 Game::Game() {
 #if SAC_INGAME_EDITORS
@@ -93,6 +96,8 @@ Game::Game() {
     targetDT = 1.0f / 60.0f;
 
     isFinished = false;
+    sacInitTime = 0;
+    firstFrameRendered = false;
 
 #if SAC_DESKTOP
     mouseNativeTouchState = 0;
@@ -240,8 +245,9 @@ void Game::buildOrderedSystemsToUpdateList() {
 #endif
     ADD_IF_EXISTING(SoundSystem::GetInstancePointer());
 #if !DISABLE_SPOT_SYSTEM
-    ADD_IF_EXISTING(SpotSystem::GetInstancePointer());
+    // blocks first: spots are computed against their current position
     ADD_IF_EXISTING(SpotBlockSystem::GetInstancePointer());
+    ADD_IF_EXISTING(SpotSystem::GetInstancePointer());
 #endif
     ADD_IF_EXISTING(TextSystem::GetInstancePointer());
     ADD_IF_EXISTING(AnchorSystem::GetInstancePointer());
@@ -427,39 +433,55 @@ void Game::eventsHandler() {
 #endif
 }
 
-void Game::loadFont(AssetAPI* asset, const char* name) {
-    char tmp[1024];
-    strncpy(tmp, name, 1024);
-    strncat(tmp, ".font", 1024);
-    FileBuffer file = asset->loadAsset(tmp);
-    DataFileParser dfp;
-    if (!dfp.load(file, tmp)) {
-        LOGE("Invalid font description file: " << tmp);
-        return;
-    }
-
-    unsigned defCount = dfp.sectionSize(DataFileParser::GlobalSection);
-    LOGW_IF(defCount == 0, "Font definition '" << name << "' has no entry");
-    std::map<uint32_t, float> h2wratio;
-    std::string charUnicode;
-    for (unsigned i=0; i<defCount; i++) {
-        int w_h[2];
-        if (!dfp.get(DataFileParser::GlobalSection, i, charUnicode, w_h, 2)) {
-            LOGE("Unable to parse entry #" << i << " of " << name);
+// Reads a font description: compiled one (.cfont) used in place if available,
+// otherwise the text one. Doesn't touch any shared state so it can run on a
+// worker thread.
+static bool parseFont(AssetAPI* asset, const std::string& name, std::vector<CompiledFont::Glyph>& glyphs) {
+    FileBuffer file = asset->mapAsset(name + CompiledFont::Extension);
+    const CompiledFont::Header* header = CompiledFont::validate(file);
+    std::vector<uint8_t> compiled;
+
+    if (!header) {
+        if (file.data)
+            asset->unmapAsset(file);
+        file = FileBuffer();
+
+        const std::string desc = name + ".font";
+        FileBuffer text = asset->loadAsset(desc);
+        const bool valid = text.data && CompiledFont::compile(text, desc, compiled);
+        delete[] text.data;
+        if (!valid) {
+            LOGE("Invalid font description file: " << desc);
+            return false;
         }
-        std::stringstream ss;
-        ss << std::hex << charUnicode;
-        uint32_t cId;
-        ss >> cId;
-        h2wratio[cId] = (float)w_h[0] / w_h[1];
-        LOGV(2, "Font entry: " << cId << ": " << h2wratio[cId]);
+        FileBuffer inMemory;
+        inMemory.data = &compiled[0];
+        inMemory.size = compiled.size();
+        header = CompiledFont::validate(inMemory);
     }
-    delete[] file.data;
-    // h2wratio[' '] = h2wratio['r'];
-    // h2wratio[0x97] = 1;
 
-    LOGV(1, "Loaded font: " << name << ". Found: " << h2wratio.size() << " entries");
-    theTextSystem.registerFont(name, h2wratio);
+    glyphs.assign(CompiledFont::glyphs(header), CompiledFont::glyphs(header) + header->glyphCount);
+    LOGV(1, "Loaded font: " << name << ". Found: " << glyphs.size() << " entries");
+
+    if (file.data)
+        asset->unmapAsset(file);
+    return !glyphs.empty();
+}
+
+void Game::loadFont(AssetAPI* asset, const char* name) {
+    std::vector<CompiledFont::Glyph> glyphs;
+    if (parseFont(asset, name, glyphs))
+        theTextSystem.registerFont(name, &glyphs[0], glyphs.size());
+}
+
+// Names of the descriptions available as text and/or compiled file
+static std::vector<std::string> listDescriptions(AssetAPI* asset, const char* textExtension, const char* compiledExtension, const std::string& folder) {
+    std::set<std::string> names;
+    for (const auto& n: asset->listAssetContent(textExtension, folder))
+        names.insert(n);
+    for (const auto& n: asset->listAssetContent(compiledExtension, folder))
+        names.insert(n);
+    return std::vector<std::string>(names.begin(), names.end());
 }
 
 void Game::changeResolution(int /*windowW*/, int /*windowH*/) {
@@ -473,29 +495,89 @@ void Game::sacInit() {
     initProfiler();
 #endif
 
+    PROFILE("Startup", "sac-init", BeginEvent);
+    sacInitTime = TimeUtil::GetTime();
+
     theRenderingSystem.init();
 
-    // Auto-load all atlas
-    {
-        const std::string dpiFolder(OpenGLTextureCreator::DPI2Folder(OpenGLTextureCreator::dpi));
-        std::list<std::string> atlas = renderThreadContext->assetAPI->listAssetContent(
-            ".atlas", dpiFolder);
-        LOGV(1, "Autoloading " << atlas.size() << " atlas");
-        std::for_each(atlas.begin(), atlas.end(), [dpiFolder] (const std::string& a) -> void {
-            theRenderingSystem.loadAtlas(dpiFolder + '/' + a);
+    // Startup assets are independent of each other: read and parse them all
+    // on the worker pool, then register them in order on this thread (atlas
+    // indices, texture refs and font glyphs are not thread safe).
+    // On Android AssetAPI uses this thread's JNIEnv, so they are read here.
+    AssetAPI* assetAPI = renderThreadContext->assetAPI;
+    std::vector<std::function<void()> > tasks;
+
+    const std::string dpiFolder(OpenGLTextureCreator::DPI2Folder(OpenGLTextureCreator::dpi));
+    std::vector<std::string> atlas = listDescriptions(assetAPI, ".atlas", CompiledAtlas::Extension, dpiFolder);
+    for (auto& a: atlas) {
+        a = dpiFolder + '/' + a;
+    }
+    std::vector<RenderingSystem::AtlasImages> atlasImages(atlas.size());
+    // registration order is known: so are atlas indices
+    const int firstAtlasIndex = theRenderingSystem.atlas.size();
+    LOGV(1, "Autoloading " << atlas.size() << " atlas");
+    for (unsigned i=0; i<atlas.size(); i++) {
+        tasks.push_back([i, firstAtlasIndex, &atlas, &atlasImages] () -> void {
+            PROFILE("Startup", "parse-atlas-" + atlas[i], BeginEvent);
+            theRenderingSystem.parseAtlas(atlas[i], firstAtlasIndex + i, atlasImages[i]);
+            PROFILE("Startup", "parse-atlas-" + atlas[i], EndEvent);
         });
     }
 
-    // Auto-load all fonts
-    {
-        std::list<std::string> fonts = renderThreadContext->assetAPI->listAssetContent(
-            ".font");
-        LOGV(1, "Autoloading " << fonts.size() << " fonts");
-        std::for_each(fonts.begin(), fonts.end(), [this] (const std::string& typo) -> void {
-            loadFont(renderThreadContext->assetAPI, typo.c_str());
+    const std::vector<std::string> fonts = listDescriptions(assetAPI, ".font", CompiledFont::Extension, "");
+    std::vector<std::vector<CompiledFont::Glyph> > fontGlyphs(fonts.size());
+    LOGV(1, "Autoloading " << fonts.size() << " fonts");
+    for (unsigned i=0; i<fonts.size(); i++) {
+        tasks.push_back([assetAPI, i, &fonts, &fontGlyphs] () -> void {
+            PROFILE("Startup", "parse-font-" + fonts[i], BeginEvent);
+            parseFont(assetAPI, fonts[i], fontGlyphs[i]);
+            PROFILE("Startup", "parse-font-" + fonts[i], EndEvent);
+        });
+    }
+
+    // Entity templates are parsed lazily (on first use, by the game thread)
+    // but their files can be read now.
+    const char* entityPrefix = theEntityManager.entityTemplateLibrary.asset2FilePrefix();
+    std::list<std::string> entityList = assetAPI->listAssetContent(
+        theEntityManager.entityTemplateLibrary.asset2FileSuffix(), entityPrefix);
+    const std::vector<std::string> entities(entityList.begin(), entityList.end());
+    std::vector<FileBuffer> entityFiles(entities.size());
+    LOGV(1, "Prefetching " << entities.size() << " entity templates");
+    tasks.push_back([assetAPI, entityPrefix, &entities, &entityFiles] () -> void {
+        PROFILE("Startup", "read-entity-templates", BeginEvent);
+        const std::string suffix = theEntityManager.entityTemplateLibrary.asset2FileSuffix();
+        for (unsigned i=0; i<entities.size(); i++) {
+            entityFiles[i] = assetAPI->loadAsset(entityPrefix + entities[i] + suffix);
+        }
+        PROFILE("Startup", "read-entity-templates", EndEvent);
+    });
+
+    PROFILE("Startup", "load-assets", BeginEvent);
+#if SAC_ANDROID
+    for (auto& task: tasks) {
+        task();
+    }
+#else
+    WorkerPool::shared().parallelFor(tasks.size(), 1,
+        [&tasks] (unsigned begin, unsigned end) -> void {
+            for (unsigned i=begin; i<end; i++) tasks[i]();
         });
+#endif
+    PROFILE("Startup", "load-assets", EndEvent);
 
+    PROFILE("Startup", "register-assets", BeginEvent);
+    for (unsigned i=0; i<atlas.size(); i++) {
+        theRenderingSystem.registerAtlas(atlas[i], false, atlasImages[i]);
+    }
+    for (unsigned i=0; i<fonts.size(); i++) {
+        if (!fontGlyphs[i].empty())
+            theTextSystem.registerFont(fonts[i].c_str(), &fontGlyphs[i][0], fontGlyphs[i].size());
+    }
+    for (unsigned i=0; i<entities.size(); i++) {
+        if (entityFiles[i].data)
+            theEntityManager.entityTemplateLibrary.addPrefetchedFile(entities[i], entityFiles[i]);
     }
+    PROFILE("Startup", "register-assets", EndEvent);
 
 #if SAC_INGAME_EDITORS
     ImGuiIO& io = ImGui::GetIO();
@@ -548,6 +630,9 @@ void Game::sacInit() {
     ADD_COMPONENT(camera, Transformation);
     TRANSFORM(camera)->size = PlacementHelper::ScreenSize;
     theTouchInputManager.setCamera(camera);
+
+    PROFILE("Startup", "sac-init", EndEvent);
+    LOGI("sacInit done in " << (TimeUtil::GetTime() - sacInitTime) * 1000 << " ms");
 }
 
 int Game::saveState(uint8_t**) {
@@ -727,6 +812,12 @@ void Game::render() {
     PROFILE("Game", "render-game", BeginEvent);
     theRenderingSystem.render();
 
+    if (!firstFrameRendered) {
+        firstFrameRendered = true;
+        PROFILE("Startup", "first-frame", InstantEvent);
+        LOGI("First frame rendered " << (TimeUtil::GetTime() - sacInitTime) * 1000 << " ms after sacInit start");
+    }
+
 #if SAC_DEBUG
     {
         static int count = 0;
@@ -103,6 +103,9 @@ class Game {
         }
     } fpsStats;
     float lastUpdateTime;
+    // startup timeline: sacInit start, first Game::render call
+    float sacInitTime;
+    bool firstFrameRendered;
 #if SAC_INGAME_EDITORS
     GameType::Enum gameType;
     LevelEditor* levelEditor;
@@ -124,6 +124,9 @@ class NamedAssetLibrary : public ResourceHotReload {
                 registerNewAsset(name);
 #endif
             ref2name[result] = name;
+        } else if (useDeferredLoading) {
+            // asset is needed again: cancel a pending unload
+            delayed.unloads.erase(result);
         }
         if (useDeferredLoading) mutex.unlock();
 
@@ -255,8 +258,11 @@ class NamedAssetLibrary : public ResourceHotReload {
     }
 
     void add(const std::string& name, const T& info) {
+        add(Murmur::RuntimeHash(name.c_str()), info);
+    }
+    // 'ref' being the hash of the asset name
+    void add(TRef ref, const T& info) {
         if (useDeferredLoading) mutex.lock();
-        TRef ref = Murmur::RuntimeHash(name.c_str());
         _addRef2Index(ref, assets.size());
         assets.push_back(info);
         if (useDeferredLoading) mutex.unlock();
@@ -44,6 +44,10 @@ void addProfilePoint(const std::string& category, const std::string& name, enum
     LOGW("todo")
 }
 
+void addProfileCounter(const std::string& category, const std::string& name, int value) {
+    LOGW("todo")
+}
+
 #else
 
 
@@ -54,7 +58,10 @@ static std::mutex mutex;
 static bool started;
 
 void initProfiler() {
-    started = false;
+    // keep a session started before sacInit (startup timeline) running
+    std::unique_lock<std::mutex> lck(mutex);
+    if (!started)
+        root.clear();
 }
 
 static inline const char* phaseEnum2String(enum ProfilePhase ph) {
@@ -126,6 +133,28 @@ void addProfilePoint(const std::string& category, const std::string& name, enum
     root.push_back(s);
 }
 
+void addProfileCounter(const std::string& category, const std::string& name, int value) {
+    if (!started)
+        return;
+    timespec t1;
+    clock_gettime(CLOCK_REALTIME, &t1);
+
+    unsigned long long int ts = (unsigned long long int)t1.tv_sec * 1000000 + (unsigned long long int)t1.tv_nsec / 1000;
+    std::stringstream a;
+    a << "{\"name\":\"" << name << "\",";
+    a << "\"cat\":\"" << category << "\",";
+    a << "\"ph\":\"" << phaseEnum2String(CounterEvent) << "\",";
+    a << "\"pid\":1,";
+    a << "\"tid\":" << std::this_thread::get_id() << ",";
+    a << "\"ts\":" << ts << ",";
+    a << "\"args\":{\"" << name << "\":" << value << "}}";
+
+    std::string s = a.str();
+
+    std::unique_lock<std::mutex> lck(mutex);
+    root.push_back(s);
+}
+
 void startProfiler() {
     std::unique_lock<std::mutex> lck(mutex);
     if (started)
@@ -30,6 +30,7 @@
 #include <glm/gtx/rotate_vector.hpp>
 #include <glm/gtx/compatibility.hpp>
 #include <glm/gtx/norm.hpp>
+#include "util/WorkerPool.h"
 
 #include "util/Draw.h"
 INSTANCE_IMPL(CollisionSystem);
@@ -43,6 +44,10 @@ CollisionSystem::CollisionSystem() : ComponentSystemImpl<CollisionComponent>(HAS
     componentSerializer.add(new Property<bool>(HASH("restore_position_on_collision", 0x9c45df9f), OFFSET(restorePositionOnCollision, tc)));
     componentSerializer.add(new Property<bool>(HASH("is_a_ray", 0x78a2c1f4), OFFSET(isARay, tc)));
 
+    cellSize = 0;
+    averageColliderSize = 2;
+    timeOfImpactTolerance = 0.001f;
+
 #if SAC_DEBUG
     showDebug = false;
     maximumRayCastPerSec = -1;
@@ -50,46 +55,51 @@ CollisionSystem::CollisionSystem() : ComponentSystemImpl<CollisionComponent>(HAS
 #endif
 }
 
-struct Coll {
-    Entity other;
-    float t;
-    glm::vec2 normal;
-};
-static void findPotentialCollisions(Entity refEntity, int groupsInside, std::vector<Entity>::const_iterator begin, std::vector<Entity>::const_iterator end, std::vector<Coll>& collisionDuringTheFrame);
-static float performRayObjectCollisionInCell(const CollisionComponent* cc, int groupsInside, Entity* collidedWithLastFrame, const glm::vec2& origin, const glm::vec2& endA, std::vector<Entity>::const_iterator begin, std::vector<Entity>::const_iterator end, glm::vec2* point);
-
-
-static bool isInsideCell(const glm::vec2& p, int x, int y, float cellSize, const glm::vec2& worldSize) {
-    const glm::vec2& cellCenter = -worldSize * 0.5f + glm::vec2(cellSize * (x+.5f), cellSize *(y+.5f));
-    AABB cell;
-    cell.left = cellCenter.x - (cellSize * 0.5f);
-    cell.right = cell.left + cellSize;
-    cell.bottom = cellCenter.y - (cellSize * 0.5f);
-    cell.top = cell.bottom + cellSize;
-    return IntersectionUtil::pointRectangleAABB(p, cell);
+static void findPotentialCollisions(const Broadphase& broadphase, int cellIndex, Entity refEntity, int groupsInside, std::vector<Entity>::const_iterator begin, std::vector<Entity>::const_iterator end, CollisionSystem::Candidates& candidates, std::vector<CollisionSystem::Contact>& out);
+
+void CollisionSystem::Delete(Entity e) {
+    broadphase.remove(Get(e)->proxy, e);
+    world.remove(Get(e)->worldProxy, e);
+    ComponentSystemImpl<CollisionComponent>::Delete(e);
 }
 
 void CollisionSystem::DoUpdate(float dt) {
-    #define CELL_SIZE 4.0f
-    #define INV_CELL_SIZE (1.0f/CELL_SIZE)
-
-    const int w = glm::floor(worldSize.x * INV_CELL_SIZE);
-    const int h = glm::floor(worldSize.y * INV_CELL_SIZE);
+    // Cells ~2 entities wide: small enough to keep cell population low, big
+    // enough to keep the number of cells covered by an entity low. Only
+    // change it when the average size moved a lot since each change
+    // rebuilds the broadphase.
+    float size = cellSize;
+    if (size <= 0) {
+        const float target = averageColliderSize * 2;
+        size = broadphase.cellSize();
+        if (size <= 0 || target > size * 2 || target < size * 0.5f)
+            size = target;
+        // and keep the cell count bounded
+        size = glm::max(size, glm::sqrt(worldSize.x * worldSize.y / 65536.0f));
+    }
+    broadphase.setGrid(worldSize, size);
+    broadphase.resetStats();
 
 #if SAC_DEBUG
+    const int w = broadphase.width();
+    const int h = broadphase.height();
+
     Draw::Clear(HASH("Collision", 0x638cf8ed));
     if (maximumRayCastPerSec > 0)
         maximumRayCastPerSecAccum += maximumRayCastPerSec * dt;
 
     if (showDebug) {
-        if (debug.empty()) {
+        if ((int)debug.size() != w * h) {
+            for (auto d: debug)
+                theEntityManager.DeleteEntity(d);
+            debug.clear();
             for (int j=0; j<h; j++) {
                 for (int i=0; i<w; i++) {
                     Entity d = theEntityManager.CreateEntity(HASH("debug_collision_grid", 0x9c1949ab));
                     ADD_COMPONENT(d, Transformation);
                     TRANSFORM(d)->position =
-                        -worldSize * 0.5f + glm::vec2(CELL_SIZE * (i+.5f), CELL_SIZE *(j+.5f));
-                    TRANSFORM(d)->size = glm::vec2(CELL_SIZE);
+                        -worldSize * 0.5f + glm::vec2(size * (i+.5f), size *(j+.5f));
+                    TRANSFORM(d)->size = glm::vec2(size);
                     TRANSFORM(d)->z = 0.95f;
                     ADD_COMPONENT(d, Rendering);
                     RENDERING(d)->color = Color(i%2,j%2,0, 0.1);
@@ -97,7 +107,7 @@ void CollisionSystem::DoUpdate(float dt) {
                     RENDERING(d)->flags = RenderingFlags::NonOpaque;
                     ADD_COMPONENT(d, Text);
                     TEXT(d)->fontName = HASH("typo", 0x5a18f4a9);
-                    TEXT(d)->charHeight = CELL_SIZE * 0.2;
+                    TEXT(d)->charHeight = size * 0.2;
                     TEXT(d)->show = 1;
                     TEXT(d)->color.a = 0.3f;
                     TEXT(d)->flags = TextComponent::MultiLineBit;
@@ -112,28 +122,28 @@ void CollisionSystem::DoUpdate(float dt) {
     }
 #endif
 
-    struct Cell {
-        Cell() : collidingGroupsInside(0), colliderGroupsInside(0) {}
-        // collider/collider collisions forbidden
-        std::vector<Entity> collidingEntities;
-        std::vector<Entity> colliderEtities;
-        std::vector<Entity> rayEntities;
-        int collidingGroupsInside, colliderGroupsInside;
-    };
-
-    std::vector<Cell> cells;
-
-    cells.reserve(w * h);
-    while ((int)cells.size() < w * h) {
-        cells.push_back(Cell());
+    // suspended entities must not be found by others
+    for (auto e: suspended) {
+        CollisionComponent& cc = components[e];
+        broadphase.remove(cc.proxy, e);
+        world.remove(cc.worldProxy, e);
+        cc.proxy = cc.worldProxy = -1;
     }
 
     int minCollidingEntity = INT_MAX, maxCollidingEntity = 0;
+    float sizeSum = 0;
+    int sizeCount = 0;
+    rays.clear();
 
-    // Assign each entity to cells
+    // Move each entity in the broadphase. Bounds cover the whole move of the
+    // frame, so fast entities meet what they went through.
     FOR_EACH_ENTITY_COMPONENT(Collision, entity, cc)
-        if (!cc->isARay && !cc->group)
+        if (!cc->isARay && !cc->group) {
+            broadphase.remove(cc->proxy, entity);
+            world.remove(cc->worldProxy, entity);
+            cc->proxy = cc->worldProxy = -1;
             continue;
+        }
         #if SAC_DEBUG
         if (cc->group & (cc->group - 1)) {
             LOGW("Invalid collision group '" << cc->group << "' for entity " << theEntityManager.entityName(entity) << ". Must be pow2");
@@ -142,47 +152,44 @@ void CollisionSystem::DoUpdate(float dt) {
 
         cc->collision.count = 0;
 
+        if (cc->isARay) {
+            // rays are cast against the world, see below
+            broadphase.remove(cc->proxy, entity);
+            world.remove(cc->worldProxy, entity);
+            cc->proxy = cc->worldProxy = -1;
+            if (!cc->rayTestDone)
+                rays.push_back(entity);
+            maxCollidingEntity = glm::max(maxCollidingEntity, (int)entity);
+            minCollidingEntity = glm::min(minCollidingEntity, (int)entity);
+            continue;
+        }
+
         const TransformationComponent* tc = TRANSFORM(entity);
+        AABB bounds;
+        IntersectionUtil::computeAABB(tc, bounds);
+        if (cc->prevPositionIsValid) {
+            const glm::vec2 move = cc->previousPosition - tc->position;
+            bounds.left += glm::min(0.0f, move.x);
+            bounds.right += glm::max(0.0f, move.x);
+            bounds.bottom += glm::min(0.0f, move.y);
+            bounds.top += glm::max(0.0f, move.y);
+        }
 
-        glm::vec2 pOffset(glm::rotate(tc->size * .5f, tc->rotation));
-        glm::vec2 nOffset(-pOffset);
-
-        pOffset += tc->position + worldSize * 0.5f;
-        nOffset += tc->position + worldSize * 0.5f;
-
-        int xStart = glm::max(0, glm::min(w-1, (int)glm::floor(pOffset.x * INV_CELL_SIZE)));
-        int xEnd = glm::max(0, glm::min(w-1, (int)glm::floor(nOffset.x * INV_CELL_SIZE)));
-        if (xStart > xEnd)
-            std::swap(xStart, xEnd);
-
-        int yStart = glm::max(0, glm::min(h-1, (int)glm::floor(pOffset.y * INV_CELL_SIZE)));
-        int yEnd = glm::max(0, glm::min(h-1, (int)glm::floor(nOffset.y * INV_CELL_SIZE)));
-        if (yStart > yEnd)
-            std::swap(yStart, yEnd);
-
-        for (int x = xStart; x <= xEnd; x++) {
-            for (int y = yStart; y <= yEnd; y++) {
-                LOGE_IF(x + y * w >=  w * h, "Incorrect cell index: " << x << '+' << y << '*' << w << " >= " << w << '*' << h);
-                Cell& cell = cells[x + y * w];
-                if (cc->group > 1 || cc->isARay) {
-                    if (cc->isARay) {
-                        if (!cc->rayTestDone) {
-                            cell.rayEntities.push_back(entity);
-                        }
-                    } else {
-                        cell.collidingEntities.push_back(entity);
-                        cell.collidingGroupsInside |= cc->group;
-                    }
-                    maxCollidingEntity = glm::max(maxCollidingEntity, (int)entity);
-                    minCollidingEntity = glm::min(minCollidingEntity, (int)entity);
-                } else {
-                    cell.colliderEtities.push_back(entity);
-                    cell.colliderGroupsInside |= cc->group;
-                }
-            }
+        if (cc->group > 1) {
+            cc->proxy = broadphase.update(cc->proxy, entity, bounds, Broadphase::Colliding, cc->group);
+            maxCollidingEntity = glm::max(maxCollidingEntity, (int)entity);
+            minCollidingEntity = glm::min(minCollidingEntity, (int)entity);
+        } else {
+            cc->proxy = broadphase.update(cc->proxy, entity, bounds, Broadphase::Collider, cc->group);
         }
+        sizeSum += glm::max(tc->size.x, tc->size.y);
+        sizeCount++;
     END_FOR_EACH()
 
+    if (sizeCount)
+        averageColliderSize = sizeSum / sizeCount;
+    PROFILE_COUNTER("Collision", "broadphase-moves", broadphase.moves());
+
     // ensure array is big enough
     {
         int arrayRequiredSize = MAX_COLLISION_COUNT_PER_ENTITY * (maxCollidingEntity - minCollidingEntity + 1);
@@ -200,309 +207,257 @@ void CollisionSystem::DoUpdate(float dt) {
         }
     }
 
-    for (unsigned i=0; i<cells.size(); i++) {
-        const Cell& cell = cells[i];
-
 #if SAC_DEBUG
-        if (showDebug) {
-            const int x = i % w;
-            const int y = i / w;
-
+    if (showDebug) {
+        for (int i=0; i<w * h; i++) {
+            const Broadphase::Cell& cell = broadphase.cell(i);
             std::stringstream ss;
-            ss << x << ' ' << y << '\n'
-                << cell.collidingEntities.size() << '('
-                << cell.collidingGroupsInside << "), "
-                << cell.colliderEtities.size() << '('
-                << cell.colliderGroupsInside << ')';
+            ss << i % w << ' ' << i / w << '\n'
+                << cell.entities[Broadphase::Colliding].size() << '('
+                << cell.groups[Broadphase::Colliding] << "), "
+                << cell.entities[Broadphase::Collider].size() << '('
+                << cell.groups[Broadphase::Collider] << ')';
             TEXT(debug[i])->text = ss.str();
         }
+    }
 #endif
 
-        // Browse colliding entities in this cell
-        if (!cell.collidingEntities.empty()) {
-            const unsigned count = cell.collidingEntities.size();
-
-            for (unsigned j=0; j<count; j++) {
-                const Entity refEntity = cell.collidingEntities[j];
-
-                std::vector<Coll> collisionDuringTheFrame;
-                // look for collidingEntities/collidingEntities collisions first
-                findPotentialCollisions(refEntity,
-                    cell.collidingGroupsInside,
-                    cell.collidingEntities.begin() + (j+1),
-                    cell.collidingEntities.end(),
-                    collisionDuringTheFrame);
-
-                // then look for collidingEntities/colliderEntities collisions
-                findPotentialCollisions(refEntity,
-                    cell.colliderGroupsInside,
-                    cell.colliderEtities.begin(),
-                    cell.colliderEtities.end(),
-                    collisionDuringTheFrame);
-
-                if (!collisionDuringTheFrame.empty()) {
-                    auto* cc = COLLISION(refEntity);
-                    auto* tc = TRANSFORM(refEntity);
-
-                    const glm::vec2 p1[] = {
-                        cc->previousPosition,
-                        tc->position
-                    };
-                    const float r1[] = {
-                        cc->previousRotation,
-                        tc->rotation
-                    };
-                    const glm::vec2 s1 = tc->size * 1.01f;
-
-                    for (auto collision: collisionDuringTheFrame) {
-                        const auto* cc2 = COLLISION(collision.other);
-                        const auto* tc2 = TRANSFORM(collision.other);
-                        const glm::vec2 p2[] = {
-                            cc2->previousPosition,
-                            tc2->position
-                        };
-                        const float r2[2] = {
-                            cc2->previousRotation,
-                            tc2->rotation
-                        };
-                        const glm::vec2 s2 = tc2->size * 1.01f;
-
-                        // resolve collision, and keep only 1
-                        Interval<float> timing (0, 1);
-                        int iteration = 5;
-                        do {
-                            const float t = timing.lerp(0.5);
-                            glm::vec2 _pos1 = glm::lerp(p1[0], p1[1], t);
-                            float _r1 = glm::lerp(r1[0], r1[1], t);
-                            glm::vec2 _pos2 = glm::lerp(p2[0], p2[1], t);
-                            float _r2 = glm::lerp(r2[0], r2[1], t);
-
-                            if (IntersectionUtil::rectangleRectangle(
-                                _pos1, s1, _r1,
-                                _pos2, s2, _r2)) {
-                                timing.t2 = t;
-                            } else {
-                                timing.t1 = t;
-                            }
-
-                            if (--iteration == 0) {
-                                collision.t = timing.t1;
-                                break;
-                            }
-                        } while (true);
-                    }
-
-                    std::sort(collisionDuringTheFrame.begin(),
-                        collisionDuringTheFrame.end(),
-                        [] (const Coll& c1, const Coll& c2) -> bool {
-                            return c1.t < c2.t;
-                        }
-                    );
-
-                    int collCount = cc->collision.count = (int) collisionDuringTheFrame.size();
-
-                    for (int i=0; i<collCount; i++) {
-                        const Coll& collision = collisionDuringTheFrame[i];
-
-                        cc->collision.with[i] = collision.other;
-
-                        if (cc->restorePositionOnCollision && cc->prevPositionIsValid) {
-                            tc->position = glm::lerp(p1[0], p1[1], collision.t);
-                            tc->rotation = glm::lerp(r1[0], r1[1], collision.t);
-                        }
-
-                        LOGV(2, "Collision: " << theEntityManager.entityName(refEntity) << " -> " << theEntityManager.entityName(collision.other));
-                    }
-                }
+    // Candidate pairs, gathered per cell. An entity belongs to every cell it
+    // overlaps, so a pair is only reported by the first cell both share.
+    const std::vector<int>& occupied = broadphase.occupiedCells();
+    #define CELLS_PER_JOB 8
+    cellContacts.resize((occupied.size() + CELLS_PER_JOB - 1) / CELLS_PER_JOB);
+    cellCandidates.resize(cellContacts.size());
+    WorkerPool::shared().parallelFor(occupied.size(), CELLS_PER_JOB,
+        [this, &occupied] (unsigned begin, unsigned end) -> void {
+        std::vector<Contact>& out = cellContacts[begin / CELLS_PER_JOB];
+        Candidates& candidates = cellCandidates[begin / CELLS_PER_JOB];
+        out.clear();
+        for (unsigned i=begin; i<end; i++) {
+            const int index = occupied[i];
+            const Broadphase::Cell& cell = broadphase.cell(index);
+            const std::vector<Entity>& collidingEntities = cell.entities[Broadphase::Colliding];
+            const std::vector<Entity>& colliderEntities = cell.entities[Broadphase::Collider];
+
+            for (auto refEntity: collidingEntities) {
+                // collidingEntities/collidingEntities collisions first
+                findPotentialCollisions(broadphase, index, refEntity,
+                    cell.groups[Broadphase::Colliding],
+                    collidingEntities.begin(),
+                    collidingEntities.end(),
+                    candidates,
+                    out);
+
+                // then collidingEntities/colliderEntities collisions
+                findPotentialCollisions(broadphase, index, refEntity,
+                    cell.groups[Broadphase::Collider],
+                    colliderEntities.begin(),
+                    colliderEntities.end(),
+                    candidates,
+                    out);
             }
         }
+    });
+
+    contacts.clear();
+    for (const auto& c: cellContacts)
+        contacts.insert(contacts.end(), c.begin(), c.end());
+    // group by entity (jobs complete in any order: sort 'other' too, to keep
+    // results deterministic)
+    std::sort(contacts.begin(), contacts.end(),
+        [] (const Contact& c1, const Contact& c2) -> bool {
+            return c1.entity < c2.entity ||
+                (c1.entity == c2.entity && c1.other < c2.other);
+        }
+    );
+    contactRanges.clear();
+    for (unsigned i=0; i<contacts.size(); i++) {
+        if (i == 0 || contacts[i].entity != contacts[i - 1].entity)
+            contactRanges.push_back(i);
+    }
+    contactRanges.push_back(contacts.size());
+    PROFILE_COUNTER("Collision", "contacts", contacts.size());
+
+    // Find each collision time. Only reads positions, and each job owns the
+    // contacts of its entities.
+    #define ENTITIES_PER_JOB 16
+    WorkerPool::shared().parallelFor(contactRanges.size() - 1, ENTITIES_PER_JOB,
+        [this] (unsigned begin, unsigned end) -> void {
+        for (unsigned r=begin; r<end; r++) {
+            auto first = contacts.begin() + contactRanges[r];
+            auto last = contacts.begin() + contactRanges[r + 1];
+
+            const auto* cc = COLLISION(first->entity);
+            const auto* tc = TRANSFORM(first->entity);
+            const glm::vec2 p1[] = {
+                cc->prevPositionIsValid ? cc->previousPosition : tc->position,
+                tc->position
+            };
+            const float r1[] = {
+                cc->prevPositionIsValid ? cc->previousRotation : tc->rotation,
+                tc->rotation
+            };
+
+            for (auto it = first; it != last; ++it) {
+                Contact& collision = *it;
+                const auto* cc2 = COLLISION(collision.other);
+                const auto* tc2 = TRANSFORM(collision.other);
+                const glm::vec2 p2[] = {
+                    cc2->prevPositionIsValid ? cc2->previousPosition : tc2->position,
+                    tc2->position
+                };
+                const float r2[2] = {
+                    cc2->prevPositionIsValid ? cc2->previousRotation : tc2->rotation,
+                    tc2->rotation
+                };
+
+                // FLT_MAX if they don't actually meet
+                collision.t = IntersectionUtil::rectangleRectangleTimeOfImpact(
+                    p1, tc->size, r1,
+                    p2, tc2->size, r2,
+                    timeOfImpactTolerance);
+            }
 
-        if (!cell.rayEntities.empty()) {
-            const unsigned count = cell.rayEntities.size();
-            const int xStart = i % w;
-            const int yStart = i / w;
-
-            for (unsigned j=0; j<count; j++) {
-                auto* cc = COLLISION(cell.rayEntities[j]);
-#if SAC_DEBUG
-                if (maximumRayCastPerSec > 0) {
-                    if (maximumRayCastPerSecAccum < 1)
-                        break;
-                    else
-                        maximumRayCastPerSecAccum--;
-                }
-#endif
-                cc->rayTestDone = true;
-                cc->collision.count = 0;
-
-                const glm::vec2& origin = TRANSFORM(cell.rayEntities[j])->position;
-                const glm::vec2 axis = glm::rotate(glm::vec2(1.0f, 0.0f), TRANSFORM(cell.rayEntities[j])->rotation);
-                const glm::vec2 endAxis (origin + axis * glm::max(worldSize.x, worldSize.y));
-
-                glm::vec2 point;
-
-                // from http://www.cse.yorku.ca/~amana/research/grid.pdf
-                const int stepX = glm::sign(axis.x);
-                const int stepY = glm::sign(axis.y);
-
-                const float dX = (CELL_SIZE * (xStart + ((stepX > 0) ? 1 : 0)) - (origin.x + worldSize.x * 0.5f));
-                float tMaxX = dX / axis.x;
-                const float dY = (CELL_SIZE * (yStart + ((stepY > 0) ? 1 : 0)) - (origin.y + worldSize.y * 0.5f));
-                float tMaxY = dY / axis.y;
-
-                const float tDeltaX = (CELL_SIZE / axis.x) * stepX;
-                const float tDeltaY = (CELL_SIZE / axis.y) * stepY;
-
-                LOGV(2, origin << " / " << xStart << ", " << yStart << "/" << stepX << "," << stepY << '/' << axis << '/' << dX << "->" << tMaxX << ", " << dY << "->" << tMaxY);
-                int X = xStart;
-                int Y = yStart;
-
-                const Cell* cell2 = &cell;
-                cc->collision.with[0] = 0;
-
-                while(true) {
-                    LOGV(2, "X=" << X << ", Y=" << Y << '[' << tMaxX << "," << tMaxY << ']');
-
-                    float nearest1 = performRayObjectCollisionInCell(
-                        cc,
-                        cell2->collidingGroupsInside,
-                        &cc->collision.with[0],
-                        origin,
-                        endAxis,
-                        cell2->collidingEntities.begin(),
-                        cell2->collidingEntities.end(),
-                        &cc->collision.at[0]);
-
-                    Entity collidedWithLastFrame2 = 0;
-                    glm::vec2 collisionAt2;
-                    float nearest2 = performRayObjectCollisionInCell(
-                        cc,
-                        cell2->colliderGroupsInside,
-                        &collidedWithLastFrame2,
-                        origin,
-                        endAxis,
-                        cell2->colliderEtities.begin(),
-                        cell2->colliderEtities.end(),
-                        &collisionAt2);
-
-                    if (nearest2 < nearest1) {
-                        cc->collision.with[0] = collidedWithLastFrame2;
-                        cc->collision.at[0] = collisionAt2;
-                    }
-
-                    if (cc->collision.with[0] != 0 && isInsideCell(cc->collision.at[0], X, Y, CELL_SIZE, worldSize)) {
-                        cc->collision.count = 1;
-                        break;
-                    }
-
-
-                    // loop
-                    if (tMaxX < tMaxY) {
-                        tMaxX += tDeltaX;
-                        X += stepX;
-                    } else {
-                        tMaxY += tDeltaY;
-                        Y += stepY;
-                    }
-
-                    if (X >= w || X < 0 || Y >= h || Y < 0)
-                        break;
-
-                    cell2 = &cells[Y * w + X];
+            std::stable_sort(first, last,
+                [] (const Contact& c1, const Contact& c2) -> bool {
+                    return c1.t < c2.t;
                 }
+            );
+        }
+    });
+
+    // Then store the earliest collisions of each entity
+    for (unsigned r=0; r + 1<contactRanges.size(); r++) {
+        const Contact* first = &contacts[contactRanges[r]];
+        const Entity refEntity = first->entity;
+        auto* cc = COLLISION(refEntity);
+        auto* tc = TRANSFORM(refEntity);
+
+        // contacts are sorted by time, misses last
+        int collCount = 0;
+        while (collCount < MAX_COLLISION_COUNT_PER_ENTITY &&
+            contactRanges[r] + collCount < contactRanges[r + 1] &&
+            first[collCount].t <= 1) {
+            collCount++;
+        }
+        cc->collision.count = collCount;
+        if (collCount == 0)
+            continue;
 
-                #if SAC_DEBUG
-                if (showDebug) {
-                    if (cc->collision.count) {
-                        Draw::Vec2(HASH("Collision", 0x638cf8ed), origin, cc->collision.at[0] - origin, Color(1, 0, 0));
-                    } else {
-                        Draw::Vec2(HASH("Collision", 0x638cf8ed), origin, endAxis - origin, Color(0, 0, 0));
-                    }
-                }
-                #endif
-            }
+        for (int i=0; i<collCount; i++) {
+            const Contact& collision = first[i];
+
+            cc->collision.with[i] = collision.other;
+
+            LOGV(2, "Collision: " << theEntityManager.entityName(refEntity) << " -> " << theEntityManager.entityName(collision.other));
+        }
+
+        if (cc->restorePositionOnCollision && cc->prevPositionIsValid) {
+            tc->position = glm::lerp(cc->previousPosition, tc->position, first->t);
+            tc->rotation = glm::lerp(cc->previousRotation, tc->rotation, first->t);
         }
     }
 
     FOR_EACH_ENTITY_COMPONENT(Collision, entity, cc)
-        cc->previousPosition = TRANSFORM(entity)->position;
-        cc->previousRotation = TRANSFORM(entity)->rotation;
+        const auto* tc = TRANSFORM(entity);
+        cc->previousPosition = tc->position;
+        cc->previousRotation = tc->rotation;
         cc->prevPositionIsValid = true;
+        if (cc->group && !cc->isARay)
+            cc->worldProxy = world.update(cc->worldProxy, entity, tc->position, tc->size, tc->rotation, cc->group);
     END_FOR_EACH()
-}
 
-static float performRayObjectCollisionInCell(const CollisionComponent* cc, int groupsInside, Entity* collidedWithLastFrame, const glm::vec2& origin, const glm::vec2& endA, std::vector<Entity>::const_iterator begin, std::vector<Entity>::const_iterator end, glm::vec2* point) {
-    // Quick exit if this cell doesn't have any entity
-    // from our colliding group
-    float nearest = FLT_MAX;
-    if (cc->collideWith & groupsInside) {
-        #if SAC_DEBUG
-        bool showDebug = theCollisionSystem.showDebug;
-        #endif
-        for (auto it = begin; it!=end; ++it) {
-            const Entity testedEntity = *it;
-            if (testedEntity == cc->ignore) continue;
+    // Rays go through the world, up to its border
+    unsigned rayCount = rays.size();
+#if SAC_DEBUG
+    if (maximumRayCastPerSec > 0) {
+        rayCount = glm::min(rayCount, (unsigned)maximumRayCastPerSecAccum);
+        maximumRayCastPerSecAccum -= rayCount;
+    }
+#endif
+    const float rayLength = glm::max(worldSize.x, worldSize.y);
+    rayQueries.resize(rayCount);
+    rayHits.resize(rayCount);
+    for (unsigned i=0; i<rayCount; i++) {
+        const auto* cc = COLLISION(rays[i]);
+        const auto* tc = TRANSFORM(rays[i]);
+        const glm::vec2 axis = glm::rotate(glm::vec2(1.0f, 0.0f), tc->rotation);
+        rayQueries[i] = WorldQuery::Ray(tc->position, tc->position + axis * rayLength, cc->collideWith, cc->ignore);
+    }
+    if (rayCount)
+        world.raycast(&rayQueries[0], rayCount, &rayHits[0]);
 
-            const CollisionComponent* cc2 = COLLISION(testedEntity);
-            if (cc2->group & cc->collideWith) {
-                // Test for collision
+    for (unsigned i=0; i<rayCount; i++) {
+        auto* cc = COLLISION(rays[i]);
+        const WorldQuery::Hit& hit = rayHits[i];
+        cc->rayTestDone = true;
+        cc->collision.count = hit.entity ? 1 : 0;
+        cc->collision.with[0] = hit.entity;
+        cc->collision.at[0] = hit.point;
 
-                glm::vec2 intersectionPoints[2];
-                const auto* tc = TRANSFORM(testedEntity);
-                int cnt = IntersectionUtil::lineRectangle(origin, endA, tc->position, tc->size, tc->rotation, intersectionPoints);
-
-                for (int i=0; i<cnt; i++) {
-                    #if SAC_DEBUG
-                    if (showDebug)
-                        Draw::Point(HASH("Collision", 0x638cf8ed), intersectionPoints[i]);
-                    #endif
-                    // compute distance2
-                    float d = glm::distance2(origin, intersectionPoints[i]);
-                    if (d < nearest) {
-                        nearest = d;
-                        *point = intersectionPoints[i];
-                        *collidedWithLastFrame = testedEntity;
-                    }
-                }
+        #if SAC_DEBUG
+        if (showDebug) {
+            const WorldQuery::Ray& ray = rayQueries[i];
+            if (cc->collision.count) {
+                Draw::Point(HASH("Collision", 0x638cf8ed), hit.point);
+                Draw::Vec2(HASH("Collision", 0x638cf8ed), ray.from, hit.point - ray.from, Color(1, 0, 0));
+            } else {
+                Draw::Vec2(HASH("Collision", 0x638cf8ed), ray.from, ray.to - ray.from, Color(0, 0, 0));
             }
         }
+        #endif
     }
-    return nearest;
+    PROFILE_COUNTER("Collision", "rays", rayCount);
 }
 
-static void findPotentialCollisions(Entity refEntity, int groupsInside, std::vector<Entity>::const_iterator begin, std::vector<Entity>::const_iterator end, std::vector<Coll>& collisionDuringTheFrame) {
-    CollisionComponent* cc = COLLISION(refEntity);
+static void findPotentialCollisions(const Broadphase& broadphase, int cellIndex, Entity refEntity, int groupsInside, std::vector<Entity>::const_iterator begin, std::vector<Entity>::const_iterator end, CollisionSystem::Candidates& candidates, std::vector<CollisionSystem::Contact>& out) {
+    const CollisionComponent* cc = COLLISION(refEntity);
 
     // Quick exit if this cell doesn't have any entity
     // from our colliding group
     if (cc->collideWith & groupsInside) {
-        const TransformationComponent* _tc = TRANSFORM(refEntity);
-        TransformationComponent tc;
-        tc.position = (_tc->position + cc->previousPosition) * 0.5f;
-        tc.size = _tc->position - cc->previousPosition + _tc->size;
-        tc.rotation = _tc->rotation;// incorrect but...
-
+        candidates.clear();
         for (auto it = begin; it!=end; ++it) {
             const Entity testedEntity = *it;
-            if (testedEntity == cc->ignore) continue;
+            if (testedEntity == cc->ignore || testedEntity == refEntity) continue;
 
             const CollisionComponent* cc2 = COLLISION(testedEntity);
             if (cc2->group & cc->collideWith) {
-                // Test for collision
-                if (IntersectionUtil::rectangleRectangle(&tc, TRANSFORM(testedEntity))) {
-                    // try to find the exact collision time
-                    Coll c;
-                    c.other = testedEntity;
-                    c.t = 0;
-                    collisionDuringTheFrame.push_back(c);
-
-
-                    LOGV(2, "Collision : " <<
-                        theEntityManager.entityName(refEntity) << " <-> " <<
-                        theEntityManager.entityName(testedEntity));
-                }
+                // already tested in another cell
+                if (broadphase.pairCell(cc->proxy, cc2->proxy) != cellIndex)
+                    continue;
+                const auto* tc = TRANSFORM(testedEntity);
+                candidates.entities.push_back(testedEntity);
+                candidates.bounds.add(tc->position, tc->size, tc->rotation);
             }
         }
+        if (candidates.entities.empty())
+            return;
+
+        // Test for collision, against the area covered during the frame
+        const TransformationComponent* tc = TRANSFORM(refEntity);
+        candidates.overlaps.resize(candidates.entities.size());
+        IntersectionUtil::rectangleRectangles(
+            (tc->position + cc->previousPosition) * 0.5f,
+            glm::abs(tc->position - cc->previousPosition) + tc->size,
+            tc->rotation, // incorrect but...
+            candidates.bounds,
+            &candidates.overlaps[0]);
+
+        for (unsigned i=0; i<candidates.entities.size(); i++) {
+            if (!candidates.overlaps[i])
+                continue;
+            // exact collision time is computed later
+            CollisionSystem::Contact c;
+            c.entity = refEntity;
+            c.other = candidates.entities[i];
+            c.t = 0;
+            out.push_back(c);
+
+            LOGV(2, "Collision : " <<
+                theEntityManager.entityName(refEntity) << " <-> " <<
+                theEntityManager.entityName(c.other));
+        }
     }
 }
 
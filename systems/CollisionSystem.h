@@ -23,6 +23,9 @@
 #if !DISABLE_COLLISION_SYSTEM
 #include "System.h"
 #include <functional>
+#include "util/Broadphase.h"
+#include "util/IntersectionUtil.h"
+#include "util/WorldQuery.h"
 #if SAC_DEBUG
 #include "base/Frequency.h"
 #endif
@@ -33,7 +36,8 @@ struct CollisionComponent {
     CollisionComponent()
         : group(0), collideWith(0), restorePositionOnCollision(false),
           isARay(false), rayTestDone(false), prevPositionIsValid(false),
-          previousPosition(0.0f), previousRotation(0.0f), ignore(0) {
+          previousPosition(0.0f), previousRotation(0.0f), ignore(0),
+          proxy(-1), worldProxy(-1) {
         collision.count = 0;
     }
     int group;
@@ -49,6 +53,8 @@ struct CollisionComponent {
         glm::vec2* at; /* Note: only valid for raycast atm */
     } collision;
     Entity ignore; /* TODO ignore several entities */
+    // broadphase and world handles, managed by CollisionSystem
+    int proxy, worldProxy;
 };
 
 #define theCollisionSystem CollisionSystem::GetInstance()
@@ -64,7 +70,30 @@ public:
 static glm::vec2 collisionPointToNormal(const glm::vec2& point,
                                         const TransformationComponent* tc);
 
+void Delete(Entity e) override;
+
+// 'entity' collides with 'other' at time 't' of the frame
+struct Contact {
+    Entity entity, other;
+    float t;
+};
+// entities to test at once (see IntersectionUtil batched tests)
+struct Candidates {
+    std::vector<Entity> entities;
+    RectangleBatch bounds;
+    std::vector<uint8_t> overlaps;
+
+    void clear() { entities.clear(); bounds.clear(); }
+};
+
 glm::vec2 worldSize;
+// every entity having a group, at its final position of the frame (mask:
+// group). Used by rays, and available to game code.
+WorldQuery world;
+// broadphase cell size; 0 = derived from the average entity size
+float cellSize;
+// distance left between entities restored by restorePositionOnCollision
+float timeOfImpactTolerance;
 #if SAC_DEBUG
 bool showDebug;
 int maximumRayCastPerSec;
@@ -73,6 +102,16 @@ float maximumRayCastPerSecAccum;
 private:
 std::vector<Entity> debug;
 #endif
+Broadphase broadphase;
+float averageColliderSize;
+std::vector<Entity> rays;
+std::vector<std::vector<Contact> > cellContacts;
+std::vector<Candidates> cellCandidates;
+std::vector<WorldQuery::Ray> rayQueries;
+std::vector<WorldQuery::Hit> rayHits;
+std::vector<Contact> contacts;
+// contacts[contactRanges[i]..contactRanges[i+1]] have the same entity
+std::vector<unsigned> contactRanges;
 std::vector<Entity> collisionEntity;
 std::vector<glm::vec2> collisionPos;
 }
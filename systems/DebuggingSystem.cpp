@@ -155,17 +155,16 @@ static Entity createSystemGraphEntity(const std::string& name, Entity parent, in
     return e;
 }
 
-template <class T, class U>
-std::string createLabel(const std::string& title, const std::list<std::pair<T, U> > pointsList, float scale, const std::string& unit, int optionalCount = -1) {
-    U minDt, maxDt, avg = 0;
-    minDt = maxDt = pointsList.front().second;
-    std::for_each(pointsList.begin(), pointsList.end(), [&minDt, &maxDt, &avg] (std::pair<T, U> pt) -> void {
-        const U t = pt.second;
+static std::string createLabel(const std::string& title, const GraphSamples& samples, float scale, const std::string& unit, int optionalCount = -1) {
+    float minDt, maxDt, avg = 0;
+    minDt = maxDt = samples[0];
+    for (unsigned i=0; i<samples.size(); i++) {
+        const float t = samples[i];
         if (t < minDt) minDt = t;
         if (t > maxDt) maxDt = t;
         avg += t;
-    });
-    avg /= pointsList.size();
+    }
+    avg /= samples.size();
     std::stringstream ss;
     ss << title <<": " << std::fixed << std::setprecision(1) << scale * avg << ' ' << scale * minDt << ' ' << scale * maxDt << ' ' << unit;
 
@@ -221,37 +220,26 @@ void DebuggingSystem::DoUpdate(float dt) {
         LOGI("Initialize DebugSystem: " << fps << ", " << entityCount << ", " << systems);
     }
 
+    // graphs are updated every frame, labels every .5s
     bool reloadTextures = (timeUntilGraphUpdate < 0);
 
-    // Fill FPS graph
-    GRAPH(fps)->pointsList.push_back(std::make_pair(frameCount, 1.0/dt));
-    if (frameCount > 120) GRAPH(fps)->pointsList.pop_front();
-    GRAPH(fps)->reloadTexture = reloadTextures;
-
-    // Fill Entity count graph
-    GRAPH(entityCount)->pointsList.push_back(std::make_pair(frameCount, theEntityManager.getNumberofEntity()));
-    if (frameCount > 120) GRAPH(entityCount)->pointsList.pop_front();
-    GRAPH(entityCount)->reloadTexture = reloadTextures;
+    GRAPH(fps)->samples.push(1.0/dt);
+    GRAPH(entityCount)->samples.push(theEntityManager.getNumberofEntity());
 
     for (int i=0; i<3; i++) {
-        GRAPH(renderStatsEntities[i])->pointsList.push_back(std::make_pair(frameCount, theRenderingSystem.renderingStats[i].count));
-        if (frameCount > 120) GRAPH(renderStatsEntities[i])->pointsList.pop_front();
-        GRAPH(renderStatsEntities[i])->reloadTexture = reloadTextures;
-
-        GRAPH(renderStatsEntities[3 + i])->pointsList.push_back(std::make_pair(frameCount, theRenderingSystem.renderingStats[i].area));
-        if (frameCount > 120) GRAPH(renderStatsEntities[3 + i])->pointsList.pop_front();
-        GRAPH(renderStatsEntities[3 + i])->reloadTexture = reloadTextures;
+        GRAPH(renderStatsEntities[i])->samples.push(theRenderingSystem.renderingStats[i].count);
+        GRAPH(renderStatsEntities[3 + i])->samples.push(theRenderingSystem.renderingStats[i].area);
     }
 
     if (reloadTextures) {
-        TEXT(fpsLabel)->text = createLabel("FPS", GRAPH(fps)->pointsList, 1, "fps");
-        TEXT(renderStatsEntities[0])->text = createLabel("Opaque", GRAPH(renderStatsEntities[0])->pointsList, 1, " drawn");
-        TEXT(renderStatsEntities[1])->text = createLabel("NonOpaque", GRAPH(renderStatsEntities[1])->pointsList, 1, " drawn");
-        TEXT(renderStatsEntities[2])->text = createLabel("Zprepass", GRAPH(renderStatsEntities[2])->pointsList, 1, " drawn");
-        TEXT(renderStatsEntities[3])->text = createLabel("OpSurf", GRAPH(renderStatsEntities[3])->pointsList, 1, " pct");
-        TEXT(renderStatsEntities[4])->text = createLabel("NonOpSurf", GRAPH(renderStatsEntities[4])->pointsList, 1, " pct");
-        TEXT(renderStatsEntities[5])->text = createLabel("ZppSurf", GRAPH(renderStatsEntities[5])->pointsList, 1, " pct");
-        TEXT(entityCountLabel)->text = createLabel("Total", GRAPH(entityCount)->pointsList, 1, "entities");
+        TEXT(fpsLabel)->text = createLabel("FPS", GRAPH(fps)->samples, 1, "fps");
+        TEXT(renderStatsEntities[0])->text = createLabel("Opaque", GRAPH(renderStatsEntities[0])->samples, 1, " drawn");
+        TEXT(renderStatsEntities[1])->text = createLabel("NonOpaque", GRAPH(renderStatsEntities[1])->samples, 1, " drawn");
+        TEXT(renderStatsEntities[2])->text = createLabel("Zprepass", GRAPH(renderStatsEntities[2])->samples, 1, " drawn");
+        TEXT(renderStatsEntities[3])->text = createLabel("OpSurf", GRAPH(renderStatsEntities[3])->samples, 1, " pct");
+        TEXT(renderStatsEntities[4])->text = createLabel("NonOpSurf", GRAPH(renderStatsEntities[4])->samples, 1, " pct");
+        TEXT(renderStatsEntities[5])->text = createLabel("ZppSurf", GRAPH(renderStatsEntities[5])->samples, 1, " pct");
+        TEXT(entityCountLabel)->text = createLabel("Total", GRAPH(entityCount)->samples, 1, "entities");
     }
 
     const auto& systemNames = ComponentSystem::registeredSystemIds();
@@ -275,16 +263,14 @@ void DebuggingSystem::DoUpdate(float dt) {
         }
         Entity e = it->second;
         GraphComponent* graphC = GRAPH(e);
-        graphC->pointsList.push_back(std::make_pair(frameCount, system->updateDuration));
-        if (frameCount > 120) graphC->pointsList.pop_front();
-        graphC->reloadTexture = reloadTextures;
+        graphC->samples.push(system->updateDuration);
 
         // only display system which takes >= .1 ms to update
         if (reloadTextures) {
             if (system->updateDuration < 0.0001) {
                 TEXT(e)->show = false;
             } else {
-                TEXT(e)->text = createLabel(INV_HASH(systemNames[i]), graphC->pointsList, 1000, "ms", system->entityCount());
+                TEXT(e)->text = createLabel(INV_HASH(systemNames[i]), graphC->samples, 1000, "ms", system->entityCount());
                 TEXT(e)->show = true;
                 ANCHOR(e)->position = glm::vec2(-.5, -0.6 - 0.15 * (idx)) * TRANSFORM(systems)->size;
                 idx++;
@@ -62,103 +62,246 @@ static void clear(ImageDesc& desc) {
     memset(desc.datas, 0x40, desc.width * desc.height * desc.channels);
 }
 
+static void clearColumns(ImageDesc& desc, int x0, int x1) {
+    x0 = glm::max(0, x0);
+    x1 = glm::min(desc.width - 1, x1);
+    if (x1 < x0)
+        return;
+    for (int row = 0; row < desc.height; row++) {
+        memset(desc.datas + (row * desc.width + x0) * desc.channels, 0x40, (x1 - x0 + 1) * desc.channels);
+    }
+}
+
+// n-th sample ever pushed is drawn in column n % capacity
+static int sampleColumn(unsigned long n, unsigned capacity, int width) {
+    if (capacity < 2)
+        return 0;
+    return (n % capacity) * (width - 1) / (capacity - 1);
+}
+
+static int valueRow(float value, const GraphComponent* gc, int height) {
+    return (value - gc->drawnMinY) * (height - 1) / (gc->drawnMaxY - gc->drawnMinY);
+}
+
+// how far a line is drawn around its pixels (see putPoint)
+static int lineMargin(const GraphComponent* gc, int width) {
+    int lineWidth = gc->lineWidth * width;
+    if (lineWidth == 0)
+        lineWidth = 2;
+    return lineWidth / 2 + 1;
+}
+
+static void addMargin(float& minY, float& maxY) {
+    float margin = 0.1f * (maxY - minY);
+    if (margin <= 0)
+        margin = glm::max(0.1f * glm::abs(maxY), 0.001f);
+    minY -= margin;
+    maxY += margin;
+}
+
+// Update the Y range used to draw the graph. Returns true if pixels drawn
+// with the previous range are no longer valid.
+static bool updateScale(GraphComponent* gc) {
+    const GraphSamples& samples = gc->samples;
+    if (samples.empty())
+        return false;
+    const unsigned newCount = (unsigned) std::min<unsigned long>(samples.pushed - gc->drawnCount, samples.size());
+
+    float minY, maxY;
+    if (gc->maxY != gc->minY) {
+        if (gc->setFixedScaleMinMaxY) {
+            for (unsigned i = samples.size() - newCount; i < samples.size(); i++) {
+                gc->minY = glm::min(gc->minY, samples[i]);
+                gc->maxY = glm::max(gc->maxY, samples[i]);
+            }
+        }
+        minY = gc->minY;
+        maxY = gc->maxY;
+    } else {
+        // Automatic scale only grows while sweeping, and fits the values
+        // again when drawing restarts from the left
+        const unsigned capacity = samples.capacity();
+        bool fit = gc->drawnCount == 0 ||
+            (gc->drawnCount - 1) / capacity != (samples.pushed - 1) / capacity;
+        for (unsigned i = samples.size() - newCount; !fit && i < samples.size(); i++) {
+            fit = samples[i] < gc->drawnMinY || samples[i] > gc->drawnMaxY;
+        }
+        if (!fit)
+            return false;
+        minY = maxY = samples[0];
+        for (unsigned i = 1; i < samples.size(); i++) {
+            minY = glm::min(minY, samples[i]);
+            maxY = glm::max(maxY, samples[i]);
+        }
+    }
+    addMargin(minY, maxY);
+
+    const bool changed = (minY != gc->drawnMinY || maxY != gc->drawnMaxY);
+    gc->drawnMinY = minY;
+    gc->drawnMaxY = maxY;
+    return changed;
+}
+
+static void drawReferenceLines(ImageDesc& image, const GraphComponent* gc, int x0, int x1) {
+    if (gc->maxY == gc->minY)
+        return;
+    x0 = glm::max(0, x0);
+    x1 = glm::min(image.width - 1, x1);
+    for (float y: {gc->minY, gc->maxY}) {
+        const int row = valueRow(y, gc, image.height);
+        GraphSystem::drawLine(image, std::make_pair(x0, row), std::make_pair(x1 + 1, row), gc->lineWidth * image.width, gc->lineColor);
+    }
+}
+
+// Draw the segment ending at the n-th sample ever pushed
+static void drawSegment(ImageDesc& image, const GraphComponent* gc, unsigned long n) {
+    const GraphSamples& samples = gc->samples;
+    const unsigned long oldest = samples.pushed - samples.size();
+    // no segment across the right border
+    if (n <= oldest || n % samples.capacity() == 0)
+        return;
+    const unsigned i = n - oldest;
+    GraphSystem::drawLine(image,
+        std::make_pair(sampleColumn(n - 1, samples.capacity(), image.width), valueRow(samples[i - 1], gc, image.height)),
+        std::make_pair(sampleColumn(n, samples.capacity(), image.width), valueRow(samples[i], gc, image.height)),
+        gc->lineWidth * image.width, gc->lineColor);
+}
+
+static void markDirty(std::vector<bool>& dirtyColumns, int x0, int x1) {
+    x0 = glm::max(0, x0);
+    x1 = glm::min((int)dirtyColumns.size() - 1, x1);
+    for (int x = x0; x <= x1; x++)
+        dirtyColumns[x] = true;
+}
+
 void GraphSystem::DoUpdate(float) {
-    for (std::map<TextureRef, ImageDesc>::iterator it=textureRef2Image.begin(); it != textureRef2Image.end(); ++it) {
-        clear(it->second);
+    for (auto& t: textures) {
+        t.second.graphs.clear();
     }
 
     FOR_EACH_COMPONENT(Graph, gc)
-        TextureRef texture = theRenderingSystem.textureLibrary.load(gc->textureName.c_str());
+        TextureRef ref = theRenderingSystem.textureLibrary.load(gc->textureName.c_str());
 
-        std::map<TextureRef, ImageDesc>::iterator jt;
-        if ( (jt = textureRef2Image.find(texture)) != textureRef2Image.end()) {
-            if (gc->reloadTexture) drawTexture(jt->second, gc);
-        }
-        else {
-            ImageDesc desc;
+        auto it = textures.find(ref);
+        if (it == textures.end()) {
+            GraphTexture texture;
+            ImageDesc& desc = texture.image;
             desc.width = desc.height = SIZE;
             desc.channels = 4;
             desc.mipmap = 0;
             desc.type = ImageDesc::RAW;
             desc.datas = new char[desc.width * desc.height * desc.channels];
             clear(desc);
-            drawTexture(desc, gc);
+            texture.dirtyColumns.resize(desc.width, false);
 
-            theRenderingSystem.textureLibrary.registerDataSource(texture, desc);
+            theRenderingSystem.textureLibrary.registerDataSource(ref, desc);
 
-            textureRef2Image.insert(std::make_pair(texture, desc));
-        }
-        if(gc->reloadTexture) {
-            theRenderingSystem.textureLibrary.reload(gc->textureName.c_str());
-            gc->reloadTexture = false;
+            it = textures.insert(std::make_pair(ref, texture)).first;
         }
+        it->second.graphs.push_back(gc);
     END_FOR_EACH()
-}
-
-void GraphSystem::drawTexture(ImageDesc &textureDesc, GraphComponent *gc) {
-    float minScaleX = gc->pointsList.begin()->first, minScaleY = gc->pointsList.begin()->second, maxScaleX = gc->pointsList.begin()->first, maxScaleY = gc->pointsList.begin()->second;
-    for (std::list<std::pair<float, float> >::iterator it=gc->pointsList.begin(); it != gc->pointsList.end(); ++it) {
-        minScaleX = std::min(minScaleX, it->first);
-        maxScaleX = std::max(maxScaleX, it->first);
 
-        minScaleY = std::min(minScaleY, it->second);
-        maxScaleY = std::max(maxScaleY, it->second);
-    }
+    for (auto& t: textures) {
+        GraphTexture& texture = t.second;
+        if (texture.graphs.empty())
+            continue;
+
+        bool fullRedraw = false;
+        for (auto* gc: texture.graphs) {
+            const GraphSamples& samples = gc->samples;
+            fullRedraw |= updateScale(gc);
+            fullRedraw |= gc->reloadTexture;
+            // samples were cleared, or too many new ones to draw them incrementally
+            fullRedraw |= samples.pushed < gc->drawnCount ||
+                samples.pushed - gc->drawnCount >= samples.capacity();
+        }
 
-    if (gc->setFixedScaleMinMaxX){
-        gc->maxX = std::max(maxScaleX, gc->maxX);
-        gc->minX = std::min(minScaleX, gc->minX);
-    }
-    if (gc->setFixedScaleMinMaxY){
-        gc->maxY = std::max(maxScaleY, gc->maxY);
-        gc->minY = std::min(minScaleY, gc->minY);
-    }
+        if (fullRedraw) {
+            redraw(texture);
+        } else {
+            drawNewSamples(texture);
+        }
 
-    if (gc->maxX != gc->minX) {
-        if (gc->minX < minScaleX / 2 || gc->maxX > maxScaleX * 2)
-            LOGW_EVERY_N(120, "Check your X-scale on graph '" <<
-                gc->textureName << "' : min/maxX = " << gc->minX << '/' << gc->maxX << " minScale/maxScaleX = " <<
-                minScaleX << '/' << maxScaleX);
-        minScaleX = gc->minX;
-        maxScaleX = gc->maxX;
-    }
-    if (gc->maxY != gc->minY) {
-        if (gc->minY < minScaleY / 2 || gc->maxY > maxScaleY * 2)
-            LOGW_EVERY_N(120, "Check your Y-scale on graph '" <<
-                gc->textureName << "' : min/maxY = " << gc->minY << '/' << gc->maxY << " minScale/maxScaleY = " <<
-                minScaleY << '/' << maxScaleY);
-        minScaleY = gc->minY;
-        maxScaleY = gc->maxY;
+        for (auto* gc: texture.graphs) {
+            gc->drawnCount = gc->samples.pushed;
+            gc->reloadTexture = false;
+        }
+        upload(t.first, texture);
     }
+}
 
-    minScaleY -= 0.1f * std::abs(minScaleY);
-    maxScaleY += 0.1f * std::abs(minScaleY);
-
-    if (gc->maxX != gc->minX) {
-        int value_xmin = (gc->minX - minScaleX) * (textureDesc.height - 1) / (maxScaleX - minScaleX);
-        int value_xmax = (gc->maxX - minScaleX) * (textureDesc.height - 1) / (maxScaleX - minScaleX);
+void GraphSystem::redraw(GraphTexture& texture) {
+    ImageDesc& image = texture.image;
+    clear(image);
 
-        drawLine(textureDesc, std::make_pair(value_xmax, 0), std::make_pair(value_xmax, 255), gc->lineWidth*textureDesc.width, gc->lineColor);
-        drawLine(textureDesc, std::make_pair(value_xmin, 0), std::make_pair(value_xmin, 255), gc->lineWidth*textureDesc.width, gc->lineColor);
+    for (auto* gc: texture.graphs) {
+        drawReferenceLines(image, gc, 0, image.width - 1);
+        const GraphSamples& samples = gc->samples;
+        for (unsigned long n = samples.pushed - samples.size() + 1; n < samples.pushed; n++) {
+            drawSegment(image, gc, n);
+        }
     }
-    if (gc->maxY != gc->minY) {
-        int value_ymin = (gc->minY - minScaleY) * (textureDesc.height - 1) / (maxScaleY - minScaleY);
-        int value_ymax = (gc->maxY - minScaleY) * (textureDesc.height - 1) / (maxScaleY - minScaleY);
+    std::fill(texture.dirtyColumns.begin(), texture.dirtyColumns.end(), true);
+}
 
-        drawLine(textureDesc, std::make_pair(0, value_ymax), std::make_pair(255, value_ymax), gc->lineWidth*textureDesc.width, gc->lineColor);
-        drawLine(textureDesc, std::make_pair(0, value_ymin), std::make_pair(255, value_ymin), gc->lineWidth*textureDesc.width, gc->lineColor);
+void GraphSystem::drawNewSamples(GraphTexture& texture) {
+    ImageDesc& image = texture.image;
+
+    // Erase columns covered by new samples, plus a gap ahead of the sweep
+    // cursor to separate new values from the oldest ones
+    std::vector<std::pair<int, int>> cleared;
+    for (auto* gc: texture.graphs) {
+        const GraphSamples& samples = gc->samples;
+        if (gc->drawnCount == samples.pushed)
+            continue;
+        const int margin = lineMargin(gc, image.width);
+        const unsigned long first = gc->drawnCount;
+        const int x0 = (first % samples.capacity() == 0) ?
+            0 : sampleColumn(first - 1, samples.capacity(), image.width) + 1;
+        const int last = sampleColumn(samples.pushed - 1, samples.capacity(), image.width);
+        // new samples wrapped around the right border
+        if (last < x0) {
+            cleared.push_back(std::make_pair(x0, image.width - 1));
+            cleared.push_back(std::make_pair(0, last + 2 * margin));
+        } else {
+            cleared.push_back(std::make_pair(x0, last + 2 * margin));
+        }
+    }
+    for (const auto& range: cleared) {
+        clearColumns(image, range.first, range.second);
+        markDirty(texture.dirtyColumns, range.first, range.second);
     }
 
-    int previousValue_x = -1, previousValue_y = -1;
-    for (std::list<std::pair<float, float> >::iterator it=gc->pointsList.begin(); it != gc->pointsList.end(); ++it) {
-        int value_x = (it->first - minScaleX) * (textureDesc.width - 1) / (maxScaleX - minScaleX);
-        int value_y = (it->second - minScaleY) * (textureDesc.height - 1) / (maxScaleY - minScaleY);
+    for (auto* gc: texture.graphs) {
+        const int margin = lineMargin(gc, image.width);
+        for (const auto& range: cleared) {
+            drawReferenceLines(image, gc, range.first, range.second);
+        }
+        const GraphSamples& samples = gc->samples;
+        for (unsigned long n = gc->drawnCount; n < samples.pushed; n++) {
+            drawSegment(image, gc, n);
+            // line thickness overflows the segment's columns
+            if (n > 0) {
+                markDirty(texture.dirtyColumns,
+                    sampleColumn(n - 1, samples.capacity(), image.width) - margin,
+                    sampleColumn(n, samples.capacity(), image.width) + margin);
+            }
+        }
+    }
+}
 
-        if (previousValue_x != -1 && previousValue_y != -1) {
-            drawLine(textureDesc, std::make_pair(previousValue_x, previousValue_y), std::make_pair(value_x, value_y), gc->lineWidth*textureDesc.width, gc->lineColor);
+void GraphSystem::upload(const TextureRef& ref, GraphTexture& texture) {
+    std::vector<bool>& dirty = texture.dirtyColumns;
+    const int width = dirty.size();
+    for (int x = 0; x < width; x++) {
+        if (!dirty[x])
+            continue;
+        int end = x;
+        while (end < width && dirty[end]) {
+            dirty[end++] = false;
         }
-        previousValue_x = value_x;
-        previousValue_y = value_y;
+        theRenderingSystem.textureLibrary.updateRegion(ref, x, 0, end - x, texture.image.height);
+        x = end;
     }
 }
 
@@ -22,7 +22,7 @@
 #if !DISABLE_GRAPH_SYSTEM || SAC_DEBUG
 
 #include "System.h"
-#include <list>
+#include <vector>
 #include <utility>
 #include <map>
 #include <string>
@@ -30,27 +30,60 @@
 #include "util/ImageLoader.h"
 #include "base/Color.h"
 
+// Last N values of a graph: once full, pushing a value drops the oldest one
+struct GraphSamples {
+    GraphSamples(unsigned capacity = 120)
+        : values(capacity), first(0), count(0), pushed(0) {}
+
+    void push(float v) {
+        values[(first + count) % values.size()] = v;
+        if (count < values.size()) count++;
+        else first = (first + 1) % values.size();
+        pushed++;
+    }
+    void clear() { first = count = 0; pushed = 0; }
+
+    unsigned size() const { return count; }
+    bool empty() const { return count == 0; }
+    unsigned capacity() const { return values.size(); }
+    // i-th value, 0 being the oldest one
+    float operator[](unsigned i) const { return values[(first + i) % values.size()]; }
+    float back() const { return (*this)[count - 1]; }
+
+    std::vector<float> values;
+    unsigned first, count;
+    // number of values ever pushed
+    unsigned long pushed;
+};
+
 struct GraphComponent {
 
     GraphComponent()
-        : lineWidth(0), maxY(0), maxX(0), minY(0), minX(0),
-          setFixedScaleMinMaxX(false), setFixedScaleMinMaxY(false),
-          reloadTexture(true), lineColor(Color(1, 1, 1)) {}
+        : lineWidth(0), maxY(0), minY(0),
+          setFixedScaleMinMaxY(false),
+          reloadTexture(true), lineColor(Color(1, 1, 1)),
+          drawnCount(0), drawnMinY(0), drawnMaxY(0) {}
 
-    std::list<std::pair<float, float>> pointsList;
+    // Values are drawn from left to right; when the right border is reached,
+    // drawing restarts from the left, erasing the oldest values (sweep).
+    GraphSamples samples;
 
     std::string textureName;
 
     float lineWidth; // between ]0:1] (percent) if 0 -> 1 pixel
 
-    float maxY, maxX, minY, minX;
+    float maxY, minY;
 
-    bool setFixedScaleMinMaxX;
     bool setFixedScaleMinMaxY;
 
+    // force a complete redraw of the texture
     bool reloadTexture;
 
     Color lineColor;
+
+    // GraphSystem state: samples already drawn, and the Y range used
+    unsigned long drawnCount;
+    float drawnMinY, drawnMaxY;
 };
 
 #define theGraphSystem GraphSystem::GetInstance()
@@ -62,14 +95,25 @@ struct GraphComponent {
 
 UPDATABLE_SYSTEM(Graph)
 
-void drawTexture(ImageDesc& textureDesc, GraphComponent* points);
-void drawLine(ImageDesc& textureDesc,
+public:
+static void drawLine(ImageDesc& textureDesc,
               std::pair<int, int> firstPoint,
               std::pair<int, int> secondPoint,
               int lineWidth,
               Color color);
 
-std::map<TextureRef, ImageDesc> textureRef2Image;
+private:
+struct GraphTexture {
+    ImageDesc image;
+    // columns modified since last upload
+    std::vector<bool> dirtyColumns;
+    std::vector<GraphComponent*> graphs;
+};
+std::map<TextureRef, GraphTexture> textures;
+
+void redraw(GraphTexture& texture);
+void drawNewSamples(GraphTexture& texture);
+void upload(const TextureRef& ref, GraphTexture& texture);
 }
 ;
 #endif
@@ -22,7 +22,6 @@
 
 #include "ParticuleSystem.h"
 #include "TransformationSystem.h"
-#include "PhysicsSystem.h"
 #include "base/EntityManager.h"
 
 #include <glm/glm.hpp>
@@ -31,14 +30,52 @@
 
 
 
+// per emitter
 #define MAX_PARTICULE_COUNT 4096
 
+// Velocity Verlet with constant acceleration (same as PhysicsSystem).
+// Plain loops over contiguous arrays: let the compiler vectorize them.
+static void integrate(float* p, float* v, const float* a, float dt, unsigned count) {
+    for (unsigned i=0; i<count; i++) {
+        const float next = v[i] + a[i] * dt;
+        p[i] += (v[i] + next) * dt * 0.5f;
+        v[i] = next;
+    }
+}
+
+static void advance(float* p, const float* v, float dt, unsigned count) {
+    for (unsigned i=0; i<count; i++) {
+        p[i] += v[i] * dt;
+    }
+}
+
+template <typename T>
+static inline void moveLast(std::vector<T>& v, unsigned to) {
+    v[to] = v.back();
+    v.pop_back();
+}
+
+// remove dead particules (order is not preserved)
+static void removeDead(ParticulePool& pool) {
+    for (unsigned i=0; i<pool.count();) {
+        if (pool.time[i] < pool.lifetime[i]) {
+            i++;
+            continue;
+        }
+        moveLast(pool.x, i); moveLast(pool.y, i);
+        moveLast(pool.vx, i); moveLast(pool.vy, i);
+        moveLast(pool.ax, i); moveLast(pool.ay, i);
+        moveLast(pool.rotation, i); moveLast(pool.angularVelocity, i);
+        moveLast(pool.time, i); moveLast(pool.lifetime, i);
+        moveLast(pool.size0, i); moveLast(pool.size1, i);
+        moveLast(pool.color0, i); moveLast(pool.color1, i);
+    }
+}
+
 INSTANCE_IMPL(ParticuleSystem);
 
 ParticuleSystem::ParticuleSystem() : ComponentSystemImpl<ParticuleComponent>(HASH("Particule", 0x52ec2829)) {
     /* nothing saved */
-    minUsedIdx = maxUsedIdx = 0;
-
     ParticuleComponent tc;
     componentSerializer.add(new Property<float>(HASH("emission_rate", 0x9b57fb57), OFFSET(emissionRate, tc)));
     componentSerializer.add(new Property<float>(HASH("duration", 0x150075fa), OFFSET(duration, tc)));
@@ -54,59 +91,32 @@ ParticuleSystem::ParticuleSystem() : ComponentSystemImpl<ParticuleComponent>(HAS
     componentSerializer.add(new Property<float>(HASH("mass", 0xbfe03e46), OFFSET(mass, tc)));
     componentSerializer.add(new Property<glm::vec2>(HASH("gravity", 0x4db1fe87), OFFSET(gravity, tc), glm::vec2(0.001, 0)));
     componentSerializer.add(new Property<int8_t>(HASH("rendering_flags", 0x77a0455a), OFFSET(renderingFlags, tc)));
-
-    poolLastValidElement = -1;
 }
 
 void ParticuleSystem::DoUpdate(float dt) {
-    std::vector<Entity> recyclable;
-
     // update emitted particules
-    {
-        unsigned eraseFromIndex = 0, eraseCount = 0;
-        unsigned count = particules.size();
+    for (auto it=pools.begin(); it!=pools.end(); ) {
+        ParticulePool& pool = it->second;
+        const unsigned count = pool.count();
+
+        float* time = pool.time.data();
         for (unsigned i=0; i<count; i++) {
-            InternalParticule& internal = particules[i];
-            internal.time += dt;
-
-            if (internal.time >= internal.lifetime) {
-                recyclable.push_back(internal.e);
-                internal.e = 0;
-
-                if ((i - eraseFromIndex) == eraseCount) {
-                    eraseCount++;
-                } else {
-                    if (eraseCount) {
-                        particules.erase(
-                            particules.begin() + eraseFromIndex,
-                            particules.begin() + eraseFromIndex + eraseCount
-                        );
-                    }
-
-                    i -= eraseCount;
-                    count -= eraseCount;
-
-                    eraseFromIndex = i;
-                    eraseCount = 1;
-                }
-            } else {
-                const float prog = internal.time / internal.lifetime;
-                RENDERING(internal.e)->color = internal.color.lerp(prog);
-                TRANSFORM(internal.e)->size = glm::vec2(internal.size.lerp(prog));
-            }
+            time[i] += dt;
         }
+        integrate(pool.x.data(), pool.vx.data(), pool.ax.data(), dt, count);
+        integrate(pool.y.data(), pool.vy.data(), pool.ay.data(), dt, count);
+        advance(pool.rotation.data(), pool.angularVelocity.data(), dt, count);
+
+        removeDead(pool);
 
-        if (eraseCount) {
-            particules.erase(
-                particules.begin() + eraseFromIndex,
-                particules.begin() + eraseFromIndex + eraseCount
-            );
+        if (pool.orphan && pool.count() == 0) {
+            pools.erase(it++);
+        } else {
+            ++it;
         }
     }
 
-    // then spawn particule
-    // store in a float so a 0.83 value will go in the 'spawnLeftOver' var
-    float spawnCount = 0.0f;
+    // then spawn particules
     FOR_EACH_ENTITY_COMPONENT(Particule, a, pc)
         if (pc->duration >= 0) {
             pc->duration -= dt;
@@ -116,86 +126,109 @@ void ParticuleSystem::DoUpdate(float dt) {
             }
         }
 
-        // emit particules
-        if (pc->emissionRate > 0) {
-            spawnCount += pc->emissionRate * (dt + pc->spawnLeftOver);
-        }
-    }
-
-    int firstParticuleIndex = (int) particules.size();
-    int recyclableCount = (int)recyclable.size();
-    if (spawnCount > 0) {
+        if (pc->emissionRate <= 0)
+            continue;
 
-        particules.resize(particules.size() + spawnCount);
+        // store in a float so a 0.83 value will go in the 'spawnLeftOver' var
+        int added = pc->emissionRate * (dt + pc->spawnLeftOver);
+        pc->spawnLeftOver += dt - added / pc->emissionRate;
 
-        // recycle particule entities
-        for (int i=0; i<(int)spawnCount && i<recyclableCount; i++) {
-            particules[firstParticuleIndex + i].e = recyclable[i];
+        const TransformationComponent* ptc = TRANSFORM(a);
+        ParticulePool& pool = pools[a];
+        pool.z = ptc->z;
+        pool.texture = pc->texture;
+        pool.renderingFlags = pc->renderingFlags;
+        pool.orphan = false;
+
+        // respect emitter budget
+        added = glm::min(added, (int)MAX_PARTICULE_COUNT - (int)pool.count());
+        if (added > 0) {
+            spawn(pool, pc, ptc, added);
         }
-        // create missing particules
-        for (int i=recyclableCount; i<(int)spawnCount; i++) {
-            Entity e = theEntityManager.CreateEntity(HASH("__/particule", 0xe08bc21));
-            ADD_COMPONENT(e, Transformation);
-            ADD_COMPONENT(e, Rendering);
-            ADD_COMPONENT(e, Physics);
-            particules[firstParticuleIndex + i].e = e;
+    END_FOR_EACH()
+
+    // finally, send them to the renderer
+    auto& sprites = theRenderingSystem.sprites[SpriteSource::Particule];
+    sprites.clear();
+    for (const auto& p: pools) {
+        const ParticulePool& pool = p.second;
+        const unsigned count = pool.count();
+
+        RenderingSystem::Sprite sp;
+        sp.z = pool.z;
+        sp.texture = pool.texture;
+        sp.cameraBitMask = 1;
+        sp.flags = pool.renderingFlags | RenderingFlags::NoCulling;
+        sp.owner = p.first;
+#if SAC_INGAME_EDITORS
+        sp.highLight = false;
+#endif
+        for (unsigned i=0; i<count; i++) {
+            const float prog = pool.time[i] / pool.lifetime[i];
+            sp.position = glm::vec2(pool.x[i], pool.y[i]);
+            sp.size = glm::vec2(Interval<float>::lerpf(pool.size0[i], pool.size1[i], prog));
+            sp.rotation = pool.rotation[i];
+            sp.color = Interval<Color>::lerp(pool.color0[i], pool.color1[i], prog);
+            sprites.push_back(sp);
         }
     }
-    // last but not least, delete unused recyclable particules
-    auto& mgr = theEntityManager;
-    for (int i=(int)spawnCount; i<recyclableCount; i++) {
-        mgr.DeleteEntity(recyclable[i]);
-    }
-
-    if (spawnCount == 0.0f)
-        return;
+}
 
-    FOR_EACH_ENTITY_COMPONENT(Particule, a, pc)
-        if (pc->duration == 0)
-            continue;
-        int added = pc->emissionRate * (dt + pc->spawnLeftOver);
-        pc->spawnLeftOver += dt - added / pc->emissionRate;
+void ParticuleSystem::spawn(ParticulePool& pool, const ParticuleComponent* pc, const TransformationComponent* ptc, int added) {
+    const unsigned first = pool.count();
+    const unsigned count = first + added;
+    pool.x.resize(count); pool.y.resize(count);
+    pool.vx.resize(count); pool.vy.resize(count);
+    pool.ax.resize(count); pool.ay.resize(count);
+    pool.rotation.resize(count); pool.angularVelocity.resize(count);
+    pool.time.resize(count); pool.lifetime.resize(count);
+    pool.size0.resize(count); pool.size1.resize(count);
+    pool.color0.resize(count); pool.color1.resize(count);
+
+    for (unsigned i=first; i<count; i++) {
+        const glm::vec2 position = ptc->position + glm::rotate(glm::vec2(glm::linearRand(-0.5f, 0.5f) * ptc->size.x, glm::linearRand(-0.5f, 0.5f) * ptc->size.y), ptc->rotation);
+        pool.x[i] = position.x;
+        pool.y[i] = position.y;
+        pool.rotation[i] = ptc->rotation;
+        pool.time[i] = 0;
+        pool.lifetime[i] = pc->lifetime.random();
+        pool.size0[i] = pc->initialSize.random();
+        pool.size1[i] = pc->finalSize.random();
+        pool.color0[i] = pc->initialColor.random();
+        pool.color1[i] = pc->finalColor.random();
+
+        if (pc->mass > 0) {
+            // initial push: PhysicsSystem applied force and moment
+            // during 0.016s, i.e an impulse
+            float angle = ptc->rotation + pc->forceDirection.random();
+            const glm::vec2 v = glm::vec2(glm::cos(angle), glm::sin(angle))
+                * pc->forceAmplitude.random() * 0.016f / pc->mass;
+            pool.vx[i] = v.x;
+            pool.vy[i] = v.y;
+            pool.ax[i] = pc->gravity.x;
+            pool.ay[i] = pc->gravity.y;
+            const float momentOfInertia = pc->mass * pool.size0[i] * pool.size0[i] / 6.0f;
+            pool.angularVelocity[i] = (momentOfInertia > 0) ?
+                (pc->moment.random() * 0.016f / momentOfInertia) : 0;
+        } else {
+            pool.vx[i] = pool.vy[i] = pool.ax[i] = pool.ay[i] = 0;
+            pool.angularVelocity[i] = 0;
+        }
+    }
+}
 
+void ParticuleSystem::Delete(Entity e) {
+    auto it = pools.find(e);
+    if (it != pools.end()) {
+        it->second.orphan = true;
+    }
+    ComponentSystemImpl<ParticuleComponent>::Delete(e);
+}
 
-        const TransformationComponent* ptc = TRANSFORM(a);
-        for (int i=0; i<added; i++) {
-            InternalParticule& internal = particules[firstParticuleIndex++];
-            Entity e = internal.e;
-            internal.time = 0;
-            internal.lifetime = pc->lifetime.random();
-
-            TransformationComponent* tc = TRANSFORM(e);
-            tc->position = ptc->position + glm::rotate(glm::vec2(glm::linearRand(-0.5f, 0.5f) * ptc->size.x, glm::linearRand(-0.5f, 0.5f) * ptc->size.y), ptc->rotation);
-            tc->rotation = ptc->rotation;
-            tc->size.x = tc->size.y = pc->initialSize.random();
-            tc->z = ptc->z;
-
-            RenderingComponent* rc = RENDERING(e);
-            rc->flags = pc->renderingFlags | RenderingFlags::NoCulling;
-            rc->color = pc->initialColor.random();
-            rc->texture = pc->texture;
-            rc->show = true;
-
-            PhysicsComponent* ppc = PHYSICS(e);
-            if (pc->mass) {
-                ppc->linearVelocity = glm::vec2(0.0f);
-                ppc->angularVelocity = 0;
-                ppc->gravity = pc->gravity;
-                ppc->mass = pc->mass;
-                float angle = ptc->rotation + pc->forceDirection.random();
-                ppc->addForce(
-                    glm::vec2(
-                        glm::cos(angle),
-                        glm::sin(angle)
-                    ) * pc->forceAmplitude.random(),
-                    glm::vec2(0.0f),//tc->size * glm::linearRand(-0.5f, 0.5f),
-                    0.016f);
-                PhysicsSystem::addMoment(ppc, pc->moment.random());
-            } else {
-                ppc->mass = 0;
-            }
-            internal.color = Interval<Color> (rc->color, pc->finalColor.random());
-            internal.size = Interval<float> (tc->size.x, pc->finalSize.random());
-        }
+unsigned ParticuleSystem::particuleCount() const {
+    unsigned count = 0;
+    for (const auto& p: pools) {
+        count += p.second.count();
     }
+    return count;
 }
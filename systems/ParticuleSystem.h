@@ -26,7 +26,8 @@
 
 #include "base/Interval.h"
 
-#include <list>
+#include <map>
+#include <vector>
 
 struct ParticuleComponent {
     ParticuleComponent()
@@ -55,13 +56,25 @@ struct ParticuleComponent {
     uint8_t renderingFlags;
 };
 
-struct TransformationComponent;
+// Particules of one emitter, stored as a structure of arrays: index i of
+// each array describes the i-th particule.
+struct ParticulePool {
+    ParticulePool() : z(0), texture(InvalidTextureRef), renderingFlags(0),
+        orphan(false) {}
 
-struct InternalParticule {
-    Entity e;
-    float time, lifetime;
-    Interval<Color> color;
-    Interval<float> size;
+    unsigned count() const { return time.size(); }
+
+    std::vector<float> x, y, vx, vy, ax, ay;
+    std::vector<float> rotation, angularVelocity;
+    std::vector<float> time, lifetime;
+    std::vector<float> size0, size1;
+    std::vector<Color> color0, color1;
+
+    // emitter attributes (kept when the emitter is deleted)
+    float z;
+    TextureRef texture;
+    uint8_t renderingFlags;
+    bool orphan;
 };
 
 #define theParticuleSystem ParticuleSystem::GetInstance()
@@ -72,10 +85,16 @@ struct InternalParticule {
 #endif
 UPDATABLE_SYSTEM(Particule)
 
+public:
+// Particules outlive their emitter
+void Delete(Entity e) override;
+
+// alive particules (all emitters)
+unsigned particuleCount() const;
+
 private:
-std::vector<InternalParticule> particules;
-int minUsedIdx, maxUsedIdx;
-std::vector<Entity> pool;
-int poolLastValidElement;
+void spawn(ParticulePool& pool, const ParticuleComponent* pc, const TransformationComponent* ptc, int count);
+
+std::map<Entity, ParticulePool> pools;
 }
 ;
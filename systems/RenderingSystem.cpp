@@ -34,6 +34,7 @@
 #include <glm/gtx/rotate_vector.hpp>
 
 #include "util/IntersectionUtil.h"
+#include "util/MurmurHash.h"
 #include "opengl/OpenGLTextureCreator.h"
 
 #if SAC_DEBUG
@@ -79,8 +80,28 @@ RenderingSystem::RenderingSystem() : ComponentSystemImpl<RenderingComponent>(HAS
 
     vertices = new VertexData[MAX_VERTEX_COUNT];
     indices = new unsigned short[MAX_INDICE_COUNT];
+    instances = new InstanceData[MAX_INSTANCE_COUNT];
+    memset(&instancing, 0, sizeof(instancing));
 
-    nextConstantOffset = 0;
+    staticAllocator = RangeAllocator(MIN_STATIC_VERTEX_COUNT, MAX_STATIC_VERTEX_COUNT);
+    staticBufferCapacity = 0;
+    occlusionCulling = true;
+#if SAC_DEBUG
+    statsEnabled = true;
+#else
+    statsEnabled = false;
+#endif
+    for (int i=0; i<3; ++i)
+        renderingStats[i].reset();
+    overdraw = 0;
+    memset(lastFrameBatchFlushes, 0, sizeof(lastFrameBatchFlushes));
+    lastFrameOccludedCount = 0;
+    lastFrameOccludedArea = 0;
+    textureMemoryBudget = 0;
+    evictedAtlasCount = 0;
+    updateCount = 0;
+    frameDrawCalls = lastFrameDrawCalls = 0;
+    lastFrameSkippedGLCalls = 0;
 }
 
 RenderingSystem::~RenderingSystem() {
@@ -93,6 +114,7 @@ RenderingSystem::~RenderingSystem() {
     delete[] renderQueue;
     delete[] vertices;
     delete[] indices;
+    delete[] instances;
 }
 
 void RenderingSystem::setWindowSize(int width, int height, float sW, float sH) {
@@ -134,9 +156,12 @@ void RenderingSystem::init() {
                 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
                 data))
 
+    // (re)initializing GL: nothing from the shadow state can be trusted
+    glState.invalidateAll();
+
     // Setup pre-multiplied alpha blending
-    GL_OPERATION(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA))
-    GL_OPERATION(glEnable(GL_DEPTH_TEST))
+    glState.blendFunc.update(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GLUpdateOption::Forced);
+    glState.depthTest.update(true, GLUpdateOption::Forced);
     GL_OPERATION(glDepthFunc(GL_GREATER))
 #if SAC_DESKTOP
     GL_OPERATION(glClearDepth(0.0))
@@ -148,16 +173,19 @@ void RenderingSystem::init() {
 
     GL_OPERATION(glGenBuffers(Buffers::Count, glBuffers))
 
-    // create a VBO for indices
-    GL_OPERATION(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glBuffers[Buffers::Indice]))
-
-    // 4 vertices per element (2 triangles with 2 shared vertices)
-    GL_OPERATION(glBindBuffer(GL_ARRAY_BUFFER, glBuffers[Buffers::Dynamic]))
-    GL_OPERATION(glBufferData(GL_ARRAY_BUFFER,
-            MAX_VERTEX_COUNT * sizeof(VertexData), 0, GL_STREAM_DRAW))
-    GL_OPERATION(glBindBuffer(GL_ARRAY_BUFFER, glBuffers[Buffers::Static]))
+    // create streamed VBOs for indices and dynamic vertices. Initial size
+    // is one full batch, they'll grow to fit a whole frame if needed.
+    indiceStream.init(GL_ELEMENT_ARRAY_BUFFER, glBuffers[Buffers::Indice],
+        MAX_INDICE_COUNT * sizeof(unsigned short), &glState);
+    vertexStream.init(GL_ARRAY_BUFFER, glBuffers[Buffers::Dynamic],
+        MAX_VERTEX_COUNT * sizeof(VertexData), &glState);
+
+    // Static VBO grows with staticAllocator (see drawRenderCommands)
+    staticBufferCapacity = staticAllocator.capacity();
+    staticSignatures.assign(staticBufferCapacity, 0);
+    glState.buffers.bind(GL_ARRAY_BUFFER, glBuffers[Buffers::Static]);
     GL_OPERATION(glBufferData(GL_ARRAY_BUFFER,
-            MAX_VERTEX_COUNT * sizeof(VertexData), 0, GL_STREAM_DRAW))
+            staticBufferCapacity * sizeof(VertexData), 0, GL_STATIC_DRAW))
 
     GL_OPERATION(glActiveTexture(GL_TEXTURE0))
 
@@ -173,6 +201,8 @@ void RenderingSystem::init() {
     }
 #endif
 
+    initInstancing();
+
 #if SAC_INGAME_EDITORS
     leProgram = glCreateProgram();
 
@@ -198,6 +228,78 @@ void RenderingSystem::init() {
 #endif
 }
 
+void RenderingSystem::releaseInstancing() {
+    for (const auto& it: instancedEffects) {
+        // programs are gone with a lost context
+        if (glIsProgram(it.second.program))
+            GL_OPERATION(glDeleteProgram(it.second.program))
+    }
+    instancedEffects.clear();
+}
+
+void RenderingSystem::initInstancing() {
+    memset(&instancing, 0, sizeof(instancing));
+    releaseInstancing();
+
+#if SAC_DESKTOP
+    if (GLEW_VERSION_3_3) {
+        instancing.vertexAttribDivisor = glVertexAttribDivisor;
+        instancing.drawArraysInstanced = glDrawArraysInstanced;
+    } else if (GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced) {
+        instancing.vertexAttribDivisor = glVertexAttribDivisorARB;
+        instancing.drawArraysInstanced = glDrawArraysInstancedARB;
+    }
+#elif SAC_ANDROID || SAC_EMSCRIPTEN
+    const char* version = (const char*)glGetString(GL_VERSION);
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    typedef void (SAC_GL_APIENTRY *DivisorProc)(GLuint, GLuint);
+    typedef void (SAC_GL_APIENTRY *DrawProc)(GLenum, GLint, GLsizei, GLsizei);
+    if (version && strstr(version, "OpenGL ES 3")) {
+        instancing.vertexAttribDivisor = (DivisorProc)eglGetProcAddress("glVertexAttribDivisor");
+        instancing.drawArraysInstanced = (DrawProc)eglGetProcAddress("glDrawArraysInstanced");
+    } else if (extensions && strstr(extensions, "GL_EXT_instanced_arrays")) {
+        instancing.vertexAttribDivisor = (DivisorProc)eglGetProcAddress("glVertexAttribDivisorEXT");
+        instancing.drawArraysInstanced = (DrawProc)eglGetProcAddress("glDrawArraysInstancedEXT");
+    } else if (extensions && strstr(extensions, "GL_ANGLE_instanced_arrays")) {
+        instancing.vertexAttribDivisor = (DivisorProc)eglGetProcAddress("glVertexAttribDivisorANGLE");
+        instancing.drawArraysInstanced = (DrawProc)eglGetProcAddress("glDrawArraysInstancedANGLE");
+    }
+#endif
+    if (!instancing.vertexAttribDivisor || !instancing.drawArraysInstanced) {
+        LOGI("Instanced rendering not supported: using ES2 path only");
+        return;
+    }
+
+    // instanced variants of the default effects
+    const EffectRef defaults[] = { defaultShader, defaultShaderNoAlpha, defaultShaderEmpty, defaultShaderNoTexture };
+    for (unsigned i=0; i<4; i++) {
+        Shader variant;
+        if (!effectLibrary.buildInstancedVariant(defaults[i], variant)) {
+            LOGW("Could not build instanced variant of default effect " << (int)defaults[i]);
+            releaseInstancing();
+            return;
+        }
+        instancedEffects[defaults[i]] = variant;
+    }
+
+    // unit quad, in triangle strip order
+    const glm::vec2 quad[] = {
+        glm::vec2(-0.5f, -0.5f), glm::vec2(0.5f, -0.5f),
+        glm::vec2(-0.5f, 0.5f), glm::vec2(0.5f, 0.5f)
+    };
+    glState.buffers.bind(GL_ARRAY_BUFFER, glBuffers[Buffers::Quad]);
+    GL_OPERATION(glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW))
+
+    // instance attributes are never used by the ES2 path, so their divisor
+    // can be set once for all
+    for (int i=EffectLibrary::ATTRIB_INSTANCE_POSITION; i<=EffectLibrary::ATTRIB_INSTANCE_COLOR; i++) {
+        GL_OPERATION(instancing.vertexAttribDivisor(i, 1))
+    }
+
+    instancing.enabled = true;
+    LOGI("Instanced rendering enabled");
+}
+
 // [z][flags][effect][texture][color]
 //   flags:      3 bits
 //  effect:      8 bits
@@ -325,6 +427,132 @@ static bool cull(const TransformationComponent* camera, RenderingSystem::RenderC
 }
 #endif
 
+void RenderingSystem::Delete(Entity e) {
+    releaseStaticSlot(e);
+    ComponentSystemImpl<RenderingComponent>::Delete(e);
+}
+
+void RenderingSystem::releaseStaticSlot(Entity e) {
+    auto it = staticSlots.find(e);
+    if (it != staticSlots.end()) {
+        staticAllocator.release(it->second.offset, it->second.size);
+        staticSlots.erase(it);
+    }
+}
+
+bool RenderingSystem::assignStaticSlot(Entity e, int shape, RenderCommand& c) {
+    // room for the sprite and each of its opaque blocks
+    int blocks = 1;
+    if (c.texture != InvalidTextureRef && !(c.rflags & RenderingFlags::TextureIsFBO)) {
+        const TextureInfo* info = textureLibrary.get(c.texture, false);
+        if (info)
+            blocks += info->opaqueCount;
+    }
+    const unsigned size = blocks * theTransformationSystem.shapes[shape].vertices.size();
+
+    auto it = staticSlots.find(e);
+    if (it != staticSlots.end() && it->second.size != size) {
+        // shape or texture changed
+        releaseStaticSlot(e);
+        it = staticSlots.end();
+    }
+    if (it == staticSlots.end()) {
+        unsigned offset;
+        if (!staticAllocator.allocate(size, &offset))
+            return false;
+        StaticSlot slot;
+        slot.offset = offset;
+        slot.size = size;
+        it = staticSlots.insert(std::make_pair(e, slot)).first;
+    }
+    c.indiceOffset = it->second.offset;
+    return true;
+}
+
+// Identifies the vertices (positions and uvs) of a Constant command: they
+// are only uploaded again if it changes
+static uint32_t constantSignature(const RenderingSystem::RenderCommand& c, int shape) {
+    struct {
+        TextureRef texture;
+        int shape;
+        float z, rotation;
+        float position[2], halfSize[2];
+        uint8_t rflags;
+    } s;
+    memset(&s, 0, sizeof(s));
+    s.texture = c.texture;
+    s.shape = shape;
+    s.z = c.z;
+    s.rotation = c.rotation;
+    s.position[0] = c.position.x;
+    s.position[1] = c.position.y;
+    s.halfSize[0] = c.halfSize.x;
+    s.halfSize[1] = c.halfSize.y;
+    s.rflags = c.rflags & (RenderingFlags::MirrorHorizontal | RenderingFlags::TextureIsFBO);
+    const uint32_t h = Murmur::RuntimeHash(&s, sizeof(s));
+    // 0 means 'nothing uploaded'
+    return h ? h : 1;
+}
+
+const char* RenderingSystem::batchFlushReasonName(BatchFlushReason::Enum e) {
+    switch (e) {
+    case BatchFlushReason::NewCamera: return "NewCamera";
+    case BatchFlushReason::NewFlags: return "NewFlags";
+    case BatchFlushReason::NewTarget: return "NewTarget";
+    case BatchFlushReason::NewTexture: return "NewTexture";
+    case BatchFlushReason::NewEffect: return "NewEffect";
+    case BatchFlushReason::NewColor: return "NewColor";
+    case BatchFlushReason::NewFBO: return "NewFBO";
+    case BatchFlushReason::End: return "End";
+    case BatchFlushReason::Full: return "Full";
+    case BatchFlushReason::NewPath: return "NewPath";
+    case BatchFlushReason::Count: break;
+    }
+    return "";
+}
+
+// Occluders are picked among the biggest opaque squares (other shapes
+// do not fill their bounding rectangle) drawn with the default effects:
+// custom ones may discard fragments
+#define MAX_OCCLUDERS 64
+
+static void buildOcclusionBuffer(OcclusionBuffer& buffer, const RenderingSystem::RenderCommand* commands, unsigned count, float minArea) {
+    static std::vector<std::pair<float, unsigned> > candidates;
+    candidates.clear();
+    for (unsigned i=0; i<count; i++) {
+        const RenderingSystem::RenderCommand& c = commands[i];
+        const float area = 4 * c.halfSize.x * c.halfSize.y;
+        if (c.shapeType == Shape::Square && c.effectRef == DefaultEffectRef && c.textureReady && area >= minArea) {
+            candidates.push_back(std::make_pair(area, i));
+        }
+    }
+    const unsigned n = std::min((unsigned)candidates.size(), (unsigned)MAX_OCCLUDERS);
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(),
+        [] (const std::pair<float, unsigned>& a, const std::pair<float, unsigned>& b) -> bool {
+            return a.first > b.first;
+        });
+    for (unsigned i=0; i<n; i++) {
+        const RenderingSystem::RenderCommand& c = commands[candidates[i].second];
+        buffer.addOccluder(c.position, c.halfSize, c.rotation, c.z);
+    }
+}
+
+// Removes occluded commands, returns the new count
+static unsigned cullOccludedCommands(const OcclusionBuffer& buffer, RenderingSystem::RenderCommand* commands, unsigned count, float* culledArea) {
+    unsigned kept = 0;
+    for (unsigned i=0; i<count; i++) {
+        const RenderingSystem::RenderCommand& c = commands[i];
+        if (buffer.isOccluded(c.position, c.halfSize, c.rotation, c.z)) {
+            *culledArea += 4 * c.halfSize.x * c.halfSize.y;
+        } else {
+            if (kept != i)
+                commands[kept] = c;
+            kept++;
+        }
+    }
+    return kept;
+}
+
 #if SAC_LINUX && SAC_DESKTOP
 void RenderingSystem::updateReload() {
     effectLibrary.updateReload();
@@ -342,6 +570,7 @@ void RenderingSystem::DoUpdate(float dt) {
     static unsigned int cccc = 0;
 #endif
     RenderQueue& outQueue = renderQueue[currentWriteQueue];
+    updateCount++;
 
     LOGV(3, "UPDATE #" << currentWriteQueue << '/' << cccc << ',' << __(dt));
 
@@ -357,11 +586,40 @@ void RenderingSystem::DoUpdate(float dt) {
     std::sort(cameras.begin(), cameras.end(), CameraSystem::sort);
 
     // alloca here is dangerous
-    RenderCommand* opaqueCommands = (RenderCommand*) malloc(entityCount() * sizeof(RenderCommand));
-    RenderCommand* blendedCommands = (RenderCommand*) malloc(entityCount() * sizeof(RenderCommand));
+    unsigned maxCommandCount = entityCount();
+    for (int i=0; i<SpriteSource::Count; i++)
+        maxCommandCount += sprites[i].size();
+    // sprites may be split in several opaque blocks
+    RenderCommand* opaqueCommands = (RenderCommand*) malloc(maxCommandCount * TextureInfo::MaxOpaqueRects * sizeof(RenderCommand));
+    RenderCommand* blendedCommands = (RenderCommand*) malloc(maxCommandCount * sizeof(RenderCommand));
+
+    // culling bounds of the visible entities
+    cullEntities.clear();
+    cullBounds.clear();
+    FOR_EACH_ENTITY_COMPONENT(Rendering, a, rc)
+        if (!rc->show || rc->color.a <= 0) {
+            continue;
+        }
+        const TransformationComponent* tc = TRANSFORM(a);
+        if (rc->flags & RenderingFlags::NoCulling) {
+            // only the center has to be visible
+            cullBounds.add(tc->position, glm::vec2(0.0f), 0);
+        } else if (rc->flags & RenderingFlags::FastCulling) {
+            cullBounds.add(tc->position, tc->size, 0);
+        } else {
+            cullBounds.add(tc->position, tc->size, tc->rotation);
+        }
+        cullEntities.push_back(a);
+    END_FOR_EACH()
+    cullResult.resize(cullBounds.count);
 
     unsigned opaqueIndex = 0, blendedIndex = 0;
     outQueue.count = 0;
+    unsigned occludedCount = 0;
+    float occludedArea = 0;
+    float visibleArea = 0;
+    if (statsEnabled)
+        commandsPerCamera.clear();
     for (auto camera: cameras) {
         const CameraComponent* camComp = CAMERA(camera);
         const TransformationComponent* camTrans = TRANSFORM(camera);
@@ -372,65 +630,14 @@ void RenderingSystem::DoUpdate(float dt) {
         AABB camAABB;
         IntersectionUtil::computeAABB(camTrans, camAABB);
 
-        /* render */
-        FOR_EACH_ENTITY_COMPONENT(Rendering, a, rc)
-            bool ccc = rc->cameraBitMask & (0x1 << camComp->id);
-            if (!rc->show || rc->color.a <= 0 || !ccc ) {
-                continue;
-            }
-
-            const TransformationComponent* tc = TRANSFORM(a);
-
-            if (rc->flags & RenderingFlags::NoCulling) {
-                if (!IntersectionUtil::pointRectangleAABB(tc->position, camAABB)) {
-                    continue;
-                }
-            } else {
-                AABB entityAABB;
-                IntersectionUtil::computeAABB(tc, entityAABB, !(rc->flags & RenderingFlags::FastCulling));
-
-                if (!IntersectionUtil::rectangleRectangleAABB(camAABB, entityAABB)) {
-                    continue;
-                }
-            }
-
-            LOGW_IF(tc->z <= 0 || tc->z > 1, "Entity '" << theEntityManager.entityName(a) <<
-                "' has invalid z value: " << tc->z << ". Will not be drawn");
-
-            RenderCommand c;
-            c.z = tc->z;
-            c.texture = c.atlasIndex = rc->texture;
-            c.effectRef = rc->effectRef;
-            c.halfSize = tc->size * 0.5f;
-            c.color = rc->color;
-#if SAC_INGAME_EDITORS
-            if (rc->highLight) {
-                float t = TimeUtil::GetTime();
-                c.color.r = glm::cos(3 * t);
-                c.color.g = c.color.b = 1 - c.color.r;
-                rc->highLight = false;
-            }
-#endif
-
-            c.shapeType = (int)tc->shape;
-            c.position = tc->position;
-            c.rotation = tc->rotation;
-            c.rflags = rc->flags;
-            if ((rc->flags & RenderingFlags::Constant) && rc->indiceOffset == 0) {
-                rc->indiceOffset = nextConstantOffset;
-                nextConstantOffset += theTransformationSystem.shapes[tc->shape].vertices.size() * 2;
-                c.rflags |= RenderingFlags::ConstantNeedsUpdate;
-            }
-            c.indiceOffset = rc->indiceOffset;
-            c.uv[0] = glm::vec2(0.0f);
-            c.uv[1] = glm::vec2(1.0f);
-#if SAC_DEBUG
-            c.e = a;
+        // classify (opaque/blended) and store a render command
+        auto pushCommand = [&] (RenderCommand& c, const Color& baseColor) -> void {
+#if !SAC_INGAME_EDITORS
+            (void) baseColor;
 #endif
-
             if (c.rflags & RenderingFlags::ZPrePass) {
                 LOGT_EVERY_N(10000, "Hu, why are Z-pre-pass disabled?");
-                continue;
+                return;
 //#if SAC_INGAME_EDITORS
 //                if (highLight.zPrePass) {
 //                    c.color.g = c.color.r = 0;
@@ -458,14 +665,22 @@ void RenderingSystem::DoUpdate(float dt) {
             if (c.rflags & RenderingFlags::Constant)
                 c.flags |= EnableConstantBit;
 
+            c.textureReady = true;
             if (c.texture != InvalidTextureRef && !(c.rflags & RenderingFlags::TextureIsFBO)) {
                 const TextureInfo* info = textureLibrary.get(c.texture, false);
                 if (info) {
                     int atlasIdx = c.atlasIndex = info->atlasIndex;
-                    // If atlas texture is not loaded yet, load it
-                    if (atlasIdx >= 0 && atlas[atlasIdx].ref == InvalidTextureRef) {
-                        atlas[atlasIdx].ref = textureLibrary.load(atlas[atlasIdx].name.c_str());
-                        LOGV(1, "Requested effective load of atlas '" << atlas[atlasIdx].name << "' -> ref=" << atlas[atlasIdx].ref);
+                    if (atlasIdx >= 0) {
+                        // If atlas texture is not loaded yet (or was evicted), load it
+                        if (atlas[atlasIdx].ref == InvalidTextureRef) {
+                            atlas[atlasIdx].ref = textureLibrary.load(atlas[atlasIdx].name.c_str());
+                            textureLibrary.prefetch(atlas[atlasIdx].name);
+                            LOGV(1, "Requested effective load of atlas '" << atlas[atlasIdx].name << "' -> ref=" << atlas[atlasIdx].ref);
+                            PROFILE("Texture", "load-atlas-" + atlas[atlasIdx].name, InstantEvent);
+                        }
+                        atlas[atlasIdx].lastUsedFrame = updateCount;
+                        const TextureInfo* atlasInfo = textureLibrary.get(atlas[atlasIdx].ref, false);
+                        c.textureReady = atlasInfo && !atlasInfo->uploadPending;
                     }
 
                     // Only display the required area of the texture
@@ -476,32 +691,39 @@ void RenderingSystem::DoUpdate(float dt) {
                     // 2. alpha == 1
                     // 3. non empty opaque area
                     // 4. sprite is not a z prepass one
-                    // 5. sprite cover at least 1.25% of the camera source area
+                    // 5. each opaque block covers at least 0.1% of the camera source area
+                    int opaqueBlocks = 0;
                     if (c.rflags & RenderingFlags::NonOpaque &&
                         c.color.a >= 1 &&
-                        info->opaqueSize != glm::vec2(0.0f) &&
-                        !(c.rflags & RenderingFlags::ZPrePass) &&
-                        ((c.halfSize.x * info->opaqueSize.x) * (c.halfSize.y * info->opaqueSize.y) * cameraInvSize) > 0.001) {
-                        // add a smaller full-opaque block at the center
-                        RenderCommand cCenter(c);
-#if SAC_INGAME_EDITORS
-                        cCenter.color = rc->color;
-                        if (highLight.runtimeOpaque) {
-                            cCenter.color.r = 0;
+                        !(c.rflags & RenderingFlags::ZPrePass)) {
+                        // rects are sorted biggest first
+                        while (opaqueBlocks < info->opaqueCount &&
+                            ((c.halfSize.x * info->opaqueSize[opaqueBlocks].x) * (c.halfSize.y * info->opaqueSize[opaqueBlocks].y) * cameraInvSize) > 0.001) {
+                            opaqueBlocks++;
                         }
+                    }
+                    if (opaqueBlocks > 0) {
+                        // add smaller full-opaque blocks
+                        for (int i=0; i<opaqueBlocks; i++) {
+                            RenderCommand cCenter(c);
+#if SAC_INGAME_EDITORS
+                            cCenter.color = baseColor;
+                            if (highLight.runtimeOpaque) {
+                                cCenter.color.r = 0;
+                            }
 #endif
-                        cCenter.flags = OpaqueFlagSet;
+                            cCenter.flags = OpaqueFlagSet;
 
-                        // Note: no need to take rotate info->rotate into account.
-                        // (opaqueStart/Size attributes do not depend on this)
-                        modifyR(cCenter, info->opaqueStart, info->opaqueSize);
+                            // Note: no need to take rotate info->rotate into account.
+                            // (opaqueStart/Size attributes do not depend on this)
+                            modifyR(cCenter, info->opaqueStart[i], info->opaqueSize[i]);
 
-                        if (c.rflags & RenderingFlags::Constant) {
-                            cCenter.indiceOffset = c.indiceOffset + theTransformationSystem.shapes[tc->shape].vertices.size();
-                            cCenter.flags |= EnableConstantBit;
-                        }
+                            if (c.rflags & RenderingFlags::Constant) {
+                                // see assignStaticSlot
+                                cCenter.indiceOffset = c.indiceOffset + (i + 1) * theTransformationSystem.shapes[c.shapeType].vertices.size();
+                                cCenter.flags |= EnableConstantBit;
+                            }
 
-                        if (1 /*cull(camTrans, cCenter)*/) {
                             cCenter.key = makeKeyOpaque(cCenter);
                             opaqueCommands[opaqueIndex++] = cCenter;
                         }
@@ -514,15 +736,15 @@ void RenderingSystem::DoUpdate(float dt) {
 #endif
                         c.key = makeKeyBlended(c);
                         blendedCommands[blendedIndex++] = c;
-                        continue;
+                        return;
                     }
                 }
             }
 
-             if (!(c.rflags & RenderingFlags::FastCulling) && tc->shape == Shape::Square) {
+             if (!(c.rflags & RenderingFlags::FastCulling) && c.shapeType == Shape::Square) {
                 #if 0
                 if (!cull(camTrans, c)) {
-                    continue;
+                    return;
                 }
                 #endif
              }
@@ -540,7 +762,129 @@ void RenderingSystem::DoUpdate(float dt) {
                 c.key = makeKeyOpaque(c);
                 opaqueCommands[opaqueIndex++] = c;
             }
-        END_FOR_EACH()
+        };
+
+        /* render */
+        if (cullBounds.count)
+            IntersectionUtil::rectanglesAABB(camAABB, cullBounds, &cullResult[0]);
+        for (unsigned i=0; i<cullEntities.size(); i++) {
+            const Entity a = cullEntities[i];
+            RenderingComponent* rc = &components[a];
+            bool ccc = rc->cameraBitMask & (0x1 << camComp->id);
+            if (!ccc || !cullResult[i]) {
+                continue;
+            }
+
+            const TransformationComponent* tc = TRANSFORM(a);
+
+            LOGW_IF(tc->z <= 0 || tc->z > 1, "Entity '" << theEntityManager.entityName(a) <<
+                "' has invalid z value: " << tc->z << ". Will not be drawn");
+
+            RenderCommand c;
+            c.z = tc->z;
+            c.texture = c.atlasIndex = rc->texture;
+            c.effectRef = rc->effectRef;
+            c.halfSize = tc->size * 0.5f;
+            c.color = rc->color;
+#if SAC_INGAME_EDITORS
+            if (rc->highLight) {
+                float t = TimeUtil::GetTime();
+                c.color.r = glm::cos(3 * t);
+                c.color.g = c.color.b = 1 - c.color.r;
+                rc->highLight = false;
+            }
+#endif
+
+            c.shapeType = (int)tc->shape;
+            c.position = tc->position;
+            c.rotation = tc->rotation;
+            c.rflags = rc->flags;
+            if (rc->flags & RenderingFlags::Constant) {
+                if (assignStaticSlot(a, tc->shape, c)) {
+                    c.signature = constantSignature(c, tc->shape);
+                } else {
+                    // static VBO is full: draw as a regular sprite
+                    c.rflags &= ~RenderingFlags::Constant;
+                }
+            } else if (!staticSlots.empty()) {
+                // not constant anymore: give its range back
+                releaseStaticSlot(a);
+            }
+            c.uv[0] = glm::vec2(0.0f);
+            c.uv[1] = glm::vec2(1.0f);
+#if SAC_DEBUG
+            c.e = a;
+#endif
+
+            pushCommand(c, rc->color);
+        }
+
+        // entity-less sprites
+        for (int source=0; source<SpriteSource::Count; source++) {
+            for (const auto& sp: sprites[source]) {
+                if (sp.color.a <= 0 || !(sp.cameraBitMask & (0x1 << camComp->id))) {
+                    continue;
+                }
+                const glm::vec2 halfSize = sp.size * 0.5f;
+                if (sp.flags & RenderingFlags::NoCulling) {
+                    if (!IntersectionUtil::pointRectangleAABB(sp.position, camAABB)) {
+                        continue;
+                    }
+                } else {
+                    const AABB spriteAABB = {
+                        sp.position.x - halfSize.x, sp.position.x + halfSize.x,
+                        sp.position.y + halfSize.y, sp.position.y - halfSize.y
+                    };
+                    if (!IntersectionUtil::rectangleRectangleAABB(camAABB, spriteAABB)) {
+                        continue;
+                    }
+                }
+
+                RenderCommand c;
+                c.z = sp.z;
+                c.texture = c.atlasIndex = sp.texture;
+                c.effectRef = DefaultEffectRef;
+                c.halfSize = halfSize;
+                c.color = sp.color;
+#if SAC_INGAME_EDITORS
+                if (sp.highLight) {
+                    float t = TimeUtil::GetTime();
+                    c.color.r = glm::cos(3 * t);
+                    c.color.g = c.color.b = 1 - c.color.r;
+                }
+#endif
+                c.shapeType = (int)Shape::Square;
+                c.position = sp.position;
+                c.rotation = sp.rotation;
+                c.rflags = sp.flags & ~RenderingFlags::Constant;
+                c.uv[0] = glm::vec2(0.0f);
+                c.uv[1] = glm::vec2(1.0f);
+#if SAC_DEBUG
+                c.e = sp.owner;
+#endif
+                pushCommand(c, sp.color);
+            }
+        }
+
+        // OCCLUSION CULLING
+        if (occlusionCulling && opaqueIndex > 0) {
+            occlusionBuffer.reset(camTrans->position, camTrans->size, camTrans->rotation);
+            // an occluder has to cover at least one tile
+            const float tileArea = camTrans->size.x * camTrans->size.y / (OCCLUSION_TILES * OCCLUSION_TILES);
+            buildOcclusionBuffer(occlusionBuffer, opaqueCommands, opaqueIndex, tileArea);
+
+            float area = 0;
+            const unsigned before = opaqueIndex + blendedIndex;
+            opaqueIndex = cullOccludedCommands(occlusionBuffer, opaqueCommands, opaqueIndex, &area);
+            blendedIndex = cullOccludedCommands(occlusionBuffer, blendedCommands, blendedIndex, &area);
+            occludedCount += before - (opaqueIndex + blendedIndex);
+            occludedArea += area * cameraInvSize;
+        }
+
+        if (statsEnabled) {
+            commandsPerCamera.push_back(opaqueIndex + blendedIndex);
+            visibleArea += camTrans->size.x * camTrans->size.y;
+        }
 
         unsigned cnt = outQueue.count + opaqueIndex + blendedIndex + 1;
 
@@ -564,17 +908,19 @@ void RenderingSystem::DoUpdate(float dt) {
         outQueue.count += blendedIndex;
     }
 
-#if SAC_DEBUG
-    float invSize = 400.0f / (theRenderingSystem.screenW * theRenderingSystem.screenH);
-    for (int i=0; i<3; ++i)
-        renderingStats[i].reset();
+    if (statsEnabled) {
+        float invSize = 400.0f / (theRenderingSystem.screenW * theRenderingSystem.screenH);
+        float drawnArea = 0;
+        for (int i=0; i<3; ++i)
+            renderingStats[i].reset();
         std::for_each(outQueue.commands.begin(), outQueue.commands.begin() + outQueue.count,
-            [this, invSize] (const RenderCommand& a) -> void {
+            [this, invSize, &drawnArea] (const RenderCommand& a) -> void {
             if (a.texture == BeginFrameMarker) return;
             if (a.flags & EnableZWriteBit) {
                 if (a.flags & EnableColorWriteBit) {
                     renderingStats[0].count++;
                     renderingStats[0].area += a.halfSize.x * a.halfSize.y * invSize;
+                    drawnArea += 4 * a.halfSize.x * a.halfSize.y;
                 } else {
                     renderingStats[2].count++;
                     renderingStats[2].area += a.halfSize.x * a.halfSize.y * invSize;
@@ -582,14 +928,30 @@ void RenderingSystem::DoUpdate(float dt) {
             } else {
                 renderingStats[1].count++;
                 renderingStats[1].area += a.halfSize.x * a.halfSize.y * invSize;
+                drawnArea += 4 * a.halfSize.x * a.halfSize.y;
             }
         }
-    );
-#endif
+        );
+        overdraw = (visibleArea > 0) ? drawnArea / visibleArea : 0;
+
+        PROFILE_COUNTER("Render", "opaque-commands", renderingStats[0].count);
+        PROFILE_COUNTER("Render", "blended-commands", renderingStats[1].count);
+        PROFILE_COUNTER("Render", "overdraw-percent", (int)(overdraw * 100));
+    }
 
     free (opaqueCommands);
     free (blendedCommands);
 
+    lastFrameOccludedCount = occludedCount;
+    lastFrameOccludedArea = occludedArea;
+
+    evictUnusedAtlases();
+    PROFILE_COUNTER("Render", "occluded-commands", occludedCount);
+    PROFILE_COUNTER("Render", "occluded-area-percent", (int)(occludedArea * 100));
+
+    // once every command is built: assignStaticSlot may have grown it
+    outQueue.staticVertexCount = staticAllocator.capacity();
+
     outQueue.commands.reserve(outQueue.count + 1);
 
     RenderCommand dummy;
@@ -32,6 +32,10 @@
 
 #include "System.h"
 #include "opengl/GLState.h"
+#include "opengl/StreamingBuffer.h"
+#include "util/RangeAllocator.h"
+#include "util/OcclusionBuffer.h"
+#include "util/IntersectionUtil.h"
 
 #if SAC_INGAME_EDITORS
 class LevelEditor;
@@ -47,6 +51,7 @@ typedef int VerticesRef;
 struct TransformationComponent;
 struct GLState;
 struct VertexData;
+struct InstanceData;
 
 namespace RenderingFlags {
     const uint8_t NonOpaque = 0x01;
@@ -55,7 +60,6 @@ namespace RenderingFlags {
     const uint8_t Constant = 0x08;
     const uint8_t FastCulling = 0x10;
     const uint8_t TextureIsFBO = 0x20;
-    const uint8_t ConstantNeedsUpdate = 0x40;
     const uint8_t NoCulling = 0x80;
 }
 
@@ -65,6 +69,7 @@ namespace Buffers
         Indice = 0,
         Dynamic,
         Static,
+        Quad, // unit quad used by instanced draws
 #if SAC_INGAME_EDITORS
         Editor,
 #endif
@@ -75,7 +80,7 @@ namespace Buffers
 
 struct RenderingComponent {
     RenderingComponent()
-        : texture(InvalidTextureRef), show(false), flags(0), indiceOffset(0),
+        : texture(InvalidTextureRef), show(false), flags(0),
           effectRef(DefaultEffectRef), cameraBitMask(1), color(Color())
 #if SAC_INGAME_EDITORS
           ,
@@ -90,7 +95,6 @@ struct RenderingComponent {
     };
     uint8_t show;              // 8 bits
     bitfield8_t flags;         // 8 bits
-    uint16_t indiceOffset;     // 16
     EffectRef effectRef;       // 8 bits
     bitfield8_t cameraBitMask; // 8 bits
     Color color;               // 128 bits
@@ -100,6 +104,32 @@ struct RenderingComponent {
 #endif
 };
 
+// Why the renderer had to start a new batch (i.e a new draw call)
+namespace BatchFlushReason {
+    enum Enum {
+        NewCamera,
+        NewFlags,
+        NewTarget,
+        NewTexture,
+        NewEffect,
+        NewColor,
+        NewFBO,
+        End,
+        Full,
+        NewPath,
+        Count
+    };
+}
+
+// Producers of entity-less sprites (see RenderingSystem::sprites)
+namespace SpriteSource {
+    enum Enum {
+        Text,
+        Particule,
+        Count
+    };
+}
+
 #define theRenderingSystem RenderingSystem::GetInstance()
 #if SAC_DEBUG
 #define RENDERING(e) theRenderingSystem.Get(e, true, __FILE__, __LINE__)
@@ -110,6 +140,8 @@ struct RenderingComponent {
 UPDATABLE_SYSTEM(Rendering)
 
 public:
+void Delete(Entity e) override;
+
 struct RenderCommand;
 struct RenderQueue;
 
@@ -117,7 +149,11 @@ struct Atlas {
     std::string name;
     TextureRef ref;
     // InternalTexture glref;
+    // last update which drew a sprite from this atlas (see textureMemoryBudget)
+    unsigned lastUsedFrame;
 };
+// images (name hash, uv) described by an .atlas file
+typedef std::vector<std::pair<TextureRef, TextureInfo> > AtlasImages;
 
 struct Framebuffer {
     GLuint fbo, rbo, texture;
@@ -126,14 +162,24 @@ struct Framebuffer {
 
 typedef std::pair<GLuint, GLuint> ColorAlphaTextures;
 
-#if SAC_DEBUG
+// Rendering statistics. Always compiled but only gathered when
+// statsEnabled is set (default: debug builds only).
+bool statsEnabled;
+// opaque, blended and z-prepass commands: count and area (% of screen)
 struct Stats {
     unsigned count;
     unsigned area;
 
     void reset() { count = area = 0; }
 } renderingStats[3];
-#endif
+// commands sent for each camera, in drawing order
+std::vector<unsigned> commandsPerCamera;
+// drawn area / visible area (all cameras)
+float overdraw;
+// why batches were flushed during the last rendered frame (empty batches
+// are not counted): sum is lastFrameDrawCalls
+unsigned lastFrameBatchFlushes[BatchFlushReason::Count];
+static const char* batchFlushReasonName(BatchFlushReason::Enum e);
 
 public:
 ~RenderingSystem();
@@ -144,7 +190,17 @@ void setWindowSize(const glm::vec2& windowSize, const glm::vec2& screenSize);
 
 void loadAtlas(const std::string& atlasName,
                bool forceImmediateTextureLoading = false);
+// loadAtlas in 2 steps: parseAtlas doesn't modify anything (callable from any
+// thread), registerAtlas must then be called in atlasIndex order
+void parseAtlas(const std::string& atlasName,
+                int atlasIndex,
+                AtlasImages& images) const;
+void registerAtlas(const std::string& atlasName,
+                   bool forceImmediateTextureLoading,
+                   const AtlasImages& images);
 void unloadAtlas(const std::string& atlasName);
+// Hint: atlas will be used soon, start decoding its image in background
+void prefetchAtlas(const std::string& atlasName);
 void invalidateAtlasTextures();
 
 int saveInternalState(uint8_t** out);
@@ -221,6 +277,9 @@ bool initDone;
 private:
 void drawRenderCommands(RenderQueue& commands);
 void processDelayedTextureJobs();
+void evictUnusedAtlases();
+// number of DoUpdate calls
+unsigned updateCount;
 EffectRef defaultShader, defaultShaderNoAlpha, defaultShaderEmpty,
     defaultShaderNoTexture;
 GLuint whiteTexture;
@@ -231,6 +290,10 @@ void updateReload();
 #endif
 public:
 GLuint glBuffers[Buffers::Count];
+// ring allocators used to upload batches (Dynamic vertices and indices)
+StreamingBuffer vertexStream, indiceStream;
+// draw calls issued by the frame being rendered / by the last one
+unsigned frameDrawCalls, lastFrameDrawCalls;
 
 #if SAC_INGAME_EDITORS
 struct {
@@ -242,16 +305,84 @@ struct {
 
 bool wireframe;
 #endif
-uint16_t nextConstantOffset;
+// Static VBO space of Constant sprites (in vertices, 16 bits indices).
+// Each entity gets room for its shape once per block (sprite + opaque blocks).
+struct StaticSlot {
+    uint16_t offset, size;
+};
+RangeAllocator staticAllocator;
+std::map<Entity, StaticSlot> staticSlots;
+void releaseStaticSlot(Entity e);
+bool assignStaticSlot(Entity e, int shape, RenderCommand& c);
+OcclusionBuffer occlusionBuffer;
+// visible entities of the update and their culling bounds, tested against
+// each camera at once
+std::vector<Entity> cullEntities;
+RectangleBatch cullBounds;
+std::vector<uint8_t> cullResult;
+// render thread side: Static VBO size and signature of the vertices
+// uploaded at each offset (0: nothing uploaded)
+unsigned staticBufferCapacity;
+std::vector<uint32_t> staticSignatures;
+
+// Instanced sprites (GL 3.3 / ES3 or instanced_arrays extensions). Square,
+// non-constant sprites using a default effect are then drawn as instances
+// of a unit quad; everything else goes through the ES2 path.
+struct {
+    bool enabled;
+    void (SAC_GL_APIENTRY *vertexAttribDivisor)(GLuint, GLuint);
+    void (SAC_GL_APIENTRY *drawArraysInstanced)(GLenum, GLint, GLsizei, GLsizei);
+} instancing;
+// default effect -> instanced variant
+std::map<EffectRef, Shader> instancedEffects;
 
-private:
 // GL state
 GLState glState;
+// redundant GL calls filtered by glState during the last frame
+unsigned lastFrameSkippedGLCalls;
+
+// Drop commands hidden by nearer opaque sprites (see OcclusionBuffer)
+bool occlusionCulling;
+// commands culled during the last update, and their area (sum of
+// culled area / camera area ratio)
+unsigned lastFrameOccludedCount;
+float lastFrameOccludedArea;
+
+// GPU memory allowed for textures, in bytes (0: unlimited). When exceeded,
+// atlases not drawn recently are unloaded, least recently used first; they
+// are loaded again on next use.
+unsigned textureMemoryBudget;
+// atlases unloaded because of textureMemoryBudget since startup
+unsigned evictedAtlasCount;
+
+// Sprites without a backing entity (text glyphs, particules). Each
+// producer refills its own list during its update; sprites are then drawn
+// like Square entities.
+struct Sprite {
+    glm::vec2 position, size;
+    float rotation, z;
+    TextureRef texture;
+    Color color;
+    unsigned cameraBitMask;
+    uint8_t flags; // RenderingFlags (Constant is ignored)
+    Entity owner;
+#if SAC_INGAME_EDITORS
+    bool highLight;
+#endif
+};
+std::vector<Sprite> sprites[SpriteSource::Count];
+
+private:
 #if SAC_ANDROID || SAC_EMSCRIPTEN
 bool hasDiscardExtension;
 PFNGLDISCARDFRAMEBUFFEREXTPROC glDiscardFramebufferEXT;
 #endif
 VertexData* vertices;
 unsigned short* indices;
+InstanceData* instances;
+
+void initInstancing();
+// delete instanced variants programs
+void releaseInstancing();
 }
 ;
@@ -1,18 +1,5 @@
 #pragma once
 #include <base/Color.h>
-namespace BatchFlushReason {
-    enum Enum {
-        NewCamera,
-        NewFlags,
-        NewTarget,
-        NewTexture,
-        NewEffect,
-        NewColor,
-        NewFBO,
-        End,
-        Full,
-    };
-}
 struct BatchFlushInfo {
     BatchFlushInfo(const BatchFlushReason::Enum e) : reason(e) {}
     BatchFlushInfo(const BatchFlushReason::Enum e, unsigned f)
@@ -34,18 +21,7 @@ struct BatchFlushInfo {
 static std::vector<std::pair<BatchFlushInfo, int>> batchSizes;
 static std::vector<std::vector<RenderingSystem::RenderCommand>> batchContent;
 static std::string enumToString(BatchFlushReason::Enum e) {
-    switch (e) {
-    case BatchFlushReason::NewCamera: return "NewCamera";
-    case BatchFlushReason::NewFlags: return "NewFlags";
-    case BatchFlushReason::NewTarget: return "NewTarget";
-    case BatchFlushReason::NewTexture: return "NewTexture";
-    case BatchFlushReason::NewEffect: return "NewEffect";
-    case BatchFlushReason::NewColor: return "NewColor";
-    case BatchFlushReason::NewFBO: return "NewFBO";
-    case BatchFlushReason::End: return "End";
-    case BatchFlushReason::Full: return "Full";
-    }
-    return "";
+    return RenderingSystem::batchFlushReasonName(e);
 }
 
 inline std::ostream& operator<<(std::ostream& stream, const BatchFlushInfo& v) {
@@ -40,8 +40,10 @@
 #define C_FRAME_READY 1
 
 struct RenderingSystem::RenderQueue {
-    RenderQueue() : count(0) {}
+    RenderQueue() : count(0), staticVertexCount(0) {}
     uint16_t count;
+    // Static VBO size required by Constant commands
+    unsigned staticVertexCount;
     std::vector<RenderCommand> commands;
 };
 
@@ -64,9 +66,15 @@ struct RenderingSystem::RenderCommand {
     glm::vec2 position;
     float rotation;
     int flags, shapeType;
+    // Constant commands: offset in the Static VBO and signature of their
+    // vertices (re-uploaded only when it differs from the uploaded one)
     uint16_t indiceOffset;
+    uint32_t signature;
     uint8_t rflags;
     bool rotateUV;
+    // false while its atlas is still being decoded: the render thread
+    // skips it, so it must not hide anything (see buildOcclusionBuffer)
+    bool textureReady;
 #if SAC_DEBUG
     Entity e;
 #endif
@@ -79,8 +87,22 @@ struct VertexData {
     glm::vec2 uv;
 };
 
-#define MAX_VERTEX_COUNT 2048
-#define MAX_INDICE_COUNT 1024
+// Per sprite data of the instanced path (see default_instanced.vs)
+struct InstanceData {
+    glm::vec3 position;  // x, y, z
+    glm::vec4 transform; // half-size, rotation, rotateUV
+    glm::vec4 uv;        // uv[0], uv[1]
+    uint8_t color[4];
+};
+
+// Batch capacity: a batch is only flushed early when it reaches one of these
+// limits (indices are 16 bits and relative to the batch first vertex).
+#define MAX_VERTEX_COUNT 16384
+#define MAX_INDICE_COUNT (MAX_VERTEX_COUNT * 3 / 2)
+#define MAX_INSTANCE_COUNT (MAX_VERTEX_COUNT / 4)
+// Static VBO size limits (in vertices)
+#define MIN_STATIC_VERTEX_COUNT 4096
+#define MAX_STATIC_VERTEX_COUNT 65536
 
 void packCameraAttributes(const TransformationComponent* cameraTrans,
                           const CameraComponent* cameraComp,
@@ -26,6 +26,7 @@
 #include "CameraSystem.h"
 #include "TransformationSystem.h"
 #include <sstream>
+#include <cstddef>
 #if SAC_INGAME_EDITORS
 #include "util/LevelEditor.h"
 #endif
@@ -49,6 +50,9 @@ GLuint RenderingSystem::leProgram, RenderingSystem::leProgramuniformColorSampler
 static void computeVerticesScreenPos(const std::vector<glm::vec2>& points, const glm::vec2& position, const glm::vec2& hSize, float rotation, float z, VertexData* out);
 
 GLuint activeProgramColorU;
+// programs of the active effect: ES2 one, and its instanced variant if any
+static Shader activeShader, activeInstancedShader;
+static bool hasInstancedVariant = false;
 
 RenderingSystem::ColorAlphaTextures RenderingSystem::chooseTextures(const InternalTexture& tex, const FramebufferRef& fbo, bool useFbo) {
     if (useFbo) {
@@ -60,18 +64,31 @@ RenderingSystem::ColorAlphaTextures RenderingSystem::chooseTextures(const Intern
 }
 
 static Buffers::Enum previousActiveVertexBuffer = Buffers::Count; /* Invalid value */
+static unsigned previousVertexOffset = 0;
 
-static void changeVertexBuffer(GLuint newBuffer, Buffers::Enum val) {
-    // if (previousActiveVertexBuffer ==
-    GL_OPERATION(glBindBuffer(GL_ARRAY_BUFFER, newBuffer))
+// Note: redundant calls are filtered by the GL state cache
+static void changeVertexBuffer(GLuint newBuffer, Buffers::Enum val, unsigned offset = 0) {
+    GLState& glState = theRenderingSystem.glState;
+    glState.buffers.bind(GL_ARRAY_BUFFER, newBuffer);
 
-    GL_OPERATION(glEnableVertexAttribArray(EffectLibrary::ATTRIB_VERTEX))
+    glState.vertexAttribs.pointer(EffectLibrary::ATTRIB_VERTEX, newBuffer, 3, sizeof(VertexData), offset);
+    glState.vertexAttribs.pointer(EffectLibrary::ATTRIB_UV, newBuffer, 2, sizeof(VertexData), offset + sizeof(glm::vec3));
 
-    GL_OPERATION(glVertexAttribPointer(EffectLibrary::ATTRIB_VERTEX, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), 0))
-    GL_OPERATION(glEnableVertexAttribArray(EffectLibrary::ATTRIB_UV))
-    GL_OPERATION(glVertexAttribPointer(EffectLibrary::ATTRIB_UV, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)sizeof(glm::vec3)))
+    // instance attributes are only used by drawInstancedBatch
+    if (theRenderingSystem.instancing.enabled) {
+        for (int i=EffectLibrary::ATTRIB_INSTANCE_POSITION; i<=EffectLibrary::ATTRIB_INSTANCE_COLOR; i++) {
+            glState.vertexAttribs.disable(i);
+        }
+    }
 
     previousActiveVertexBuffer = val;
+    previousVertexOffset = offset;
+}
+
+// drawInstancedBatch leaves the instanced variant bound
+static void useActiveProgram() {
+    if (activeShader.program)
+        theRenderingSystem.glState.program.update(activeShader.program);
 }
 
 static int drawBatchES2(
@@ -83,28 +100,26 @@ static int drawBatchES2(
     ) {
 
     if (indiceCount > 0) {
+        RenderingSystem& rs = theRenderingSystem;
+        useActiveProgram();
 
-        // bind proper vertex buffer (if needed)
-        if (previousActiveVertexBuffer != activeVertexBuffer) {
-            changeVertexBuffer(theRenderingSystem.glBuffers[activeVertexBuffer], activeVertexBuffer);
-        }
-
+        // Dynamic vertices are appended to the streaming ring buffer: no
+        // orphaning unless the ring wraps
+        unsigned vertexOffset = 0;
         if (activeVertexBuffer == Buffers::Dynamic) {
-            // orphan previous storage
-            GL_OPERATION(glBufferData(GL_ARRAY_BUFFER, MAX_VERTEX_COUNT * sizeof(VertexData), 0, GL_STREAM_DRAW))
-            // update buffer
-            GL_OPERATION(glBufferSubData(GL_ARRAY_BUFFER, 0,
-                batchVertexCount * sizeof(VertexData), vertices))
+            vertexOffset = rs.vertexStream.upload(vertices,
+                batchVertexCount * sizeof(VertexData));
         }
 
-        // orphan
-        GL_OPERATION(glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            sizeof(unsigned short) * MAX_INDICE_COUNT, 0, GL_STREAM_DRAW))
-        // update
-        GL_OPERATION(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
-            (indiceCount - 2) /*batchTriangleCount * 3*/ * sizeof(unsigned short), &indices[1]))
+        // bind proper vertex buffer/offset
+        changeVertexBuffer(rs.glBuffers[activeVertexBuffer], activeVertexBuffer, vertexOffset);
 
-        GL_OPERATION(glDrawElements(GL_TRIANGLE_STRIP, indiceCount - 2/*batchTriangleCount * 3*/, GL_UNSIGNED_SHORT, 0))
+        // same thing for indices
+        const unsigned indiceOffset = rs.indiceStream.upload(&indices[1],
+            (indiceCount - 2) /*batchTriangleCount * 3*/ * sizeof(unsigned short));
+
+        GL_OPERATION(glDrawElements(GL_TRIANGLE_STRIP, indiceCount - 2/*batchTriangleCount * 3*/, GL_UNSIGNED_SHORT, (void*)(size_t)indiceOffset))
+        rs.frameDrawCalls++;
     }
 
     #if SAC_OLD_HARDWARE
@@ -114,6 +129,52 @@ static int drawBatchES2(
     return 0;
 }
 
+static int drawInstancedBatch(
+    const InstanceData* instances
+    , unsigned instanceCount
+    , const glm::mat4& mvp
+    ) {
+
+    if (instanceCount > 0) {
+        RenderingSystem& rs = theRenderingSystem;
+        GLState& glState = rs.glState;
+
+        // per instance data goes to the same ring as dynamic vertices
+        const unsigned offset = rs.vertexStream.upload(instances,
+            instanceCount * sizeof(InstanceData));
+
+        const Shader& shader = activeInstancedShader;
+        glState.program.update(shader.program);
+        glState.uniforms.matrix4(shader.program, shader.uniformMatrix, glm::value_ptr(mvp));
+        glState.uniforms.sampler(shader.program, shader.uniformColorSampler, 0);
+        if (shader.uniformAlphaSampler != (unsigned int)(~0)) {
+            glState.uniforms.sampler(shader.program, shader.uniformAlphaSampler, 1);
+        }
+
+        // per vertex: unit quad corners
+        const GLuint quad = rs.glBuffers[Buffers::Quad];
+        glState.buffers.bind(GL_ARRAY_BUFFER, quad);
+        glState.vertexAttribs.pointer(EffectLibrary::ATTRIB_VERTEX, quad, 2, sizeof(glm::vec2), 0);
+        glState.vertexAttribs.disable(EffectLibrary::ATTRIB_UV);
+
+        // per instance (divisor is 1, see RenderingSystem::initInstancing)
+        const GLuint dynamic = rs.glBuffers[Buffers::Dynamic];
+        glState.buffers.bind(GL_ARRAY_BUFFER, dynamic);
+        glState.vertexAttribs.pointer(EffectLibrary::ATTRIB_INSTANCE_POSITION, dynamic,
+            3, sizeof(InstanceData), offset + offsetof(InstanceData, position));
+        glState.vertexAttribs.pointer(EffectLibrary::ATTRIB_INSTANCE_TRANSFORM, dynamic,
+            4, sizeof(InstanceData), offset + offsetof(InstanceData, transform));
+        glState.vertexAttribs.pointer(EffectLibrary::ATTRIB_INSTANCE_UV, dynamic,
+            4, sizeof(InstanceData), offset + offsetof(InstanceData, uv));
+        glState.vertexAttribs.pointer(EffectLibrary::ATTRIB_INSTANCE_COLOR, dynamic,
+            4, sizeof(InstanceData), offset + offsetof(InstanceData, color), GL_UNSIGNED_BYTE, GL_TRUE);
+
+        GL_OPERATION(rs.instancing.drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instanceCount))
+        rs.frameDrawCalls++;
+    }
+    return 0;
+}
+
 static inline void computeUV(RenderingSystem::RenderCommand& rc, const TextureInfo& info) {
     // Those 2 are used by RenderingSystem to display part of the texture, with different flags.
     // For instance: display a partial-but-opaque-version before the original alpha-blended one.
@@ -167,11 +228,12 @@ static inline void addRenderCommandToBatch(const RenderingSystem::RenderCommand&
     const std::vector<glm::vec2>& vert = polygon.vertices;
 
     // perform world -> screen position transformation (if needed)
-    bool vertexBufferUpdateNeeded = (
-        (!(rc.rflags & RenderingFlags::Constant))
-            ||
-        (rc.rflags & RenderingFlags::ConstantNeedsUpdate)
-            );
+    bool vertexBufferUpdateNeeded = true;
+    if (rc.rflags & RenderingFlags::Constant) {
+        uint32_t& uploaded = theRenderingSystem.staticSignatures[rc.indiceOffset];
+        vertexBufferUpdateNeeded = (uploaded != rc.signature);
+        uploaded = rc.signature;
+    }
 
     if (vertexBufferUpdateNeeded) {
         computeVerticesScreenPos(vert, rc.position, rc.halfSize, rc.rotation, -rc.z, outVertices);
@@ -203,9 +265,9 @@ static inline void addRenderCommandToBatch(const RenderingSystem::RenderCommand&
     if (!(rc.rflags & RenderingFlags::Constant)) {
         *verticesCount += polygon.vertices.size();
     } else if (vertexBufferUpdateNeeded) {
-        LOGI("Update constant buffer @" << rc.indiceOffset);
+        LOGV(2, "Update constant buffer @" << rc.indiceOffset);
         // update constant buffer
-        GL_OPERATION(glBindBuffer(GL_ARRAY_BUFFER, theRenderingSystem.glBuffers[Buffers::Static]))
+        theRenderingSystem.glState.buffers.bind(GL_ARRAY_BUFFER, theRenderingSystem.glBuffers[Buffers::Static]);
         GL_OPERATION(glBufferSubData(GL_ARRAY_BUFFER,
             rc.indiceOffset * sizeof(VertexData),
             vert.size() * sizeof(VertexData),
@@ -218,29 +280,47 @@ static inline void addRenderCommandToBatch(const RenderingSystem::RenderCommand&
 #endif
 }
 
+static inline void addRenderCommandToInstances(const RenderingSystem::RenderCommand& rc,
+    InstanceData* out) {
+    out->position = glm::vec3(rc.position, -rc.z);
+    out->transform = glm::vec4(rc.halfSize, rc.rotation, rc.rotateUV ? 1.0f : 0.0f);
+    out->uv = glm::vec4(rc.uv[0], rc.uv[1]);
+    for (int i=0; i<4; i++) {
+        out->color[i] = (uint8_t)(glm::clamp(rc.color.rgba[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
 Buffers::Enum RenderingSystem::changeShaderProgram(EffectRef ref, const Color& color, const glm::mat4& mvp) {
     const Shader& shader = *effectLibrary.get(ref, false);
+    activeShader = shader;
+    hasInstancedVariant = false;
+    if (instancing.enabled) {
+        std::map<EffectRef, Shader>::const_iterator it = instancedEffects.find(ref);
+        if (it != instancedEffects.end()) {
+            activeInstancedShader = it->second;
+            hasInstancedVariant = true;
+        }
+    }
     // change active shader
-    GL_OPERATION(glUseProgram(shader.program))
+    glState.program.update(shader.program);
     // upload transform matrix (perspective + view)
-    GL_OPERATION( glUniformMatrix4fv(shader.uniformMatrix, 1, GL_FALSE, glm::value_ptr(mvp)))
+    glState.uniforms.matrix4(shader.program, shader.uniformMatrix, glm::value_ptr(mvp));
     // upload texture uniforms
-    GL_OPERATION(glUniform1i(shader.uniformColorSampler, 0))
+    glState.uniforms.sampler(shader.program, shader.uniformColorSampler, 0);
     if (shader.uniformAlphaSampler != (unsigned int)(~0)) {
-        GL_OPERATION(glUniform1i(shader.uniformAlphaSampler, 1))
+        glState.uniforms.sampler(shader.program, shader.uniformAlphaSampler, 1);
     }
     // upload color uniform
     activeProgramColorU = shader.uniformColor;
-    GL_OPERATION(glUniform4fv(activeProgramColorU, 1, color.rgba))
+    glState.uniforms.vec4(shader.program, activeProgramColorU, color.rgba);
 
-    /* Rebind vertex buffer if valid */
+    /* Vertex attributes are not per-program state: the active vertex
+       buffer setup is still valid */
     Buffers::Enum b = previousActiveVertexBuffer;
     if (b == Buffers::Count) {
         b = Buffers::Static;
+        changeVertexBuffer(glBuffers[b], b);
     }
-    changeVertexBuffer(glBuffers[b], b);
-
-    GL_OPERATION(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glBuffers[Buffers::Indice]))
 
     return b;
 }
@@ -263,12 +343,17 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
 
     // Batch variable
     unsigned int batchVertexCount = 0;
+    unsigned int instanceCount = 0;
 
     // matrices
     glm::mat4 camViewPerspMatrix;
 
     LOGV(3, "Begin frame rendering: " << commands.count);
 
+    vertexStream.beginFrame();
+    indiceStream.beginFrame();
+    frameDrawCalls = 0;
+
     #if SAC_DEBUG
     check_GL_errors("Frame start");
     #endif
@@ -284,10 +369,23 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
     #endif
 
 
-    // Setup initial GL state
-    GL_OPERATION(glActiveTexture(GL_TEXTURE1))
-    GL_OPERATION(glBindTexture(GL_TEXTURE_2D, 0))
-    GL_OPERATION(glActiveTexture(GL_TEXTURE0))
+    // Setup initial GL state. Textures, buffers, etc may have been modified
+    // outside of the render loop, so restart from an unknown state.
+    glState.invalidate();
+    GLState::resetCounters();
+    previousActiveVertexBuffer = Buffers::Count;
+    glState.textures.bind(1, 0);
+
+    // Static VBO has to grow: its content is lost, so every Constant
+    // command will be uploaded again
+    if (commands.staticVertexCount > staticBufferCapacity) {
+        LOGI("Static VBO: " << staticBufferCapacity << " -> " << commands.staticVertexCount << " vertices");
+        staticBufferCapacity = commands.staticVertexCount;
+        staticSignatures.assign(staticBufferCapacity, 0);
+        glState.buffers.bind(GL_ARRAY_BUFFER, glBuffers[Buffers::Static]);
+        GL_OPERATION(glBufferData(GL_ARRAY_BUFFER,
+            staticBufferCapacity * sizeof(VertexData), 0, GL_STATIC_DRAW))
+    }
 
     #if SAC_DEBUG
     unsigned int batchTriangleCount = 0;
@@ -297,6 +395,16 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
 
     Buffers::Enum activeVertexBuffer = Buffers::Count; /* invalid value */
     const TextureInfo* previousAtlasInfo = 0;
+
+    // draw the active batch: only one of them is non-empty
+    unsigned batchFlushes[BatchFlushReason::Count];
+    memset(batchFlushes, 0, sizeof(batchFlushes));
+    auto flushBatch = [&] (BatchFlushReason::Enum reason) {
+        if (statsEnabled && ((instanceCount > 0) | (indiceCount > 0)))
+            batchFlushes[reason]++;
+        instanceCount = drawInstancedBatch(instances, instanceCount, camViewPerspMatrix);
+        indiceCount = batchVertexCount = drawBatchES2(vertices, indices, batchVertexCount, indiceCount, activeVertexBuffer);
+    };
     TextureRef previousAtlasRef = -1;
 
     // The idea here is to browse through the list of _ordered_ list of
@@ -314,7 +422,7 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
             batchSizes.push_back(std::make_pair(BatchFlushReason::NewCamera, batchTriangleCount));
             batchTriangleCount = 0;
             #endif
-            indiceCount = batchVertexCount = drawBatchES2(vertices, indices, batchVertexCount, indiceCount, activeVertexBuffer);
+            flushBatch(BatchFlushReason::NewCamera);
 
             PROFILE("Render", "begin-render-frame", InstantEvent);
 
@@ -329,7 +437,7 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
                 glState.viewport.update(windowW, windowH);
             } else {
                 const Framebuffer& fb = ref2Framebuffers[fboRef];
-                glBindFramebuffer(GL_FRAMEBUFFER, fb.fbo);
+                glState.framebuffer.update(fb.fbo);
                 glState.viewport.update(fb.width, fb.height);
             }
 
@@ -368,7 +476,7 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
             batchTriangleCount = 0;
             #endif
             // flush batch before changing state
-            indiceCount = batchVertexCount = drawBatchES2(vertices, indices, batchVertexCount, indiceCount, activeVertexBuffer);
+            flushBatch(BatchFlushReason::NewFlags);
             const bool useTexturing = (rc.texture != InvalidTextureRef);
 
             const int flagBitsChanged = glState.flags.update(rc.flags);
@@ -412,7 +520,7 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
             batchTriangleCount = 0;
             #endif
             // flush before changing effect
-            indiceCount = batchVertexCount = drawBatchES2(vertices, indices, batchVertexCount, indiceCount, activeVertexBuffer);
+            flushBatch(BatchFlushReason::NewEffect);
             const bool useTexturing = (rc.texture != InvalidTextureRef);
 
             currentEffect = rc.effectRef;
@@ -448,6 +556,9 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
                     LOGE_IF(!atlasInfo, "TextureInfo for atlas index: "
                         << info->atlasIndex << " not found (ref=" << aRef << ", name='" << atlas[info->atlasIndex].name << "')");
                 }
+                // texture still being decoded: skip until it's uploaded
+                if (atlasInfo->uploadPending)
+                    continue;
                 rc.glref = atlasInfo->glref;
                 computeUV(rc, *info);
             } else {
@@ -473,7 +584,11 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
         const bool condUseFbo = (useFbo != rcUseFbo);
         const bool condTexture = (!rcUseFbo && boundTexture != rc.glref && (currentFlags & EnableColorWriteBit));
         const bool condFbo = (rcUseFbo && fboRef != rc.framebuffer);
-        const bool condColor = (currentColor != rc.color);
+        // instanced sprites carry their own color
+        const bool instanceable = instancing.enabled
+            && rc.shapeType == Shape::Square && !(rc.rflags & RenderingFlags::Constant);
+        const bool condColor = (currentColor != rc.color)
+            && !(instanceable && hasInstancedVariant && instanceCount > 0);
         if (condUseFbo | condTexture | condFbo | condColor) {
             #if SAC_DEBUG
             if (condUseFbo) {
@@ -482,13 +597,15 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
                 batchSizes.push_back(std::make_pair(BatchFlushInfo(BatchFlushReason::NewTexture, rrr), batchTriangleCount));
             } else if (condColor) {
                 batchSizes.push_back(std::make_pair(BatchFlushInfo(BatchFlushReason::NewColor, rc.color), batchTriangleCount));
-            } else if (condColor) {
+            } else if (condFbo) {
                 batchSizes.push_back(std::make_pair(BatchFlushReason::NewFBO, batchTriangleCount));
             }
             batchTriangleCount = 0;
             #endif
             // flush before changing texture/color
-            indiceCount = batchVertexCount = drawBatchES2(vertices, indices, batchVertexCount, indiceCount, activeVertexBuffer);
+            flushBatch(condUseFbo ? BatchFlushReason::NewTarget :
+                (condTexture ? BatchFlushReason::NewTexture :
+                (condColor ? BatchFlushReason::NewColor : BatchFlushReason::NewFBO)));
             if (rcUseFbo) {
                 fboRef = rc.framebuffer;
                 boundTexture = InternalTexture::Invalid;
@@ -516,15 +633,14 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
 
                 /* Change texture */
                 /*   1. Color texture goes to GL_TEXTURE_0 */
-                GL_OPERATION(glActiveTexture(GL_TEXTURE0))
-                GL_OPERATION(glBindTexture(GL_TEXTURE_2D, glref.first))
+                glState.textures.bind(0, glref.first);
                 /*   2. Alpha texture goes to GL_TEXTURE_1 */
-                GL_OPERATION(glActiveTexture(GL_TEXTURE1))
-                GL_OPERATION(glBindTexture(GL_TEXTURE_2D, glref.second))
+                glState.textures.bind(1, glref.second);
             }
             if (currentColor != rc.color) {
                 currentColor = rc.color;
-                GL_OPERATION(glUniform4fv(activeProgramColorU, 1, currentColor.rgba))
+                useActiveProgram();
+                glState.uniforms.vec4(activeShader.program, activeProgramColorU, currentColor.rgba);
             }
         }
 
@@ -533,15 +649,37 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
         batchContent[batchSizes.size() - 1].push_back(rc);
 #endif
 
+        if (instanceable && hasInstancedVariant) {
+            if ((indiceCount > 0) | (instanceCount >= MAX_INSTANCE_COUNT)) {
+                #if SAC_DEBUG
+                batchSizes.push_back(std::make_pair(indiceCount > 0 ? BatchFlushReason::NewPath : BatchFlushReason::Full, batchTriangleCount));
+                batchTriangleCount = 0;
+                #endif
+                flushBatch(indiceCount > 0 ? BatchFlushReason::NewPath : BatchFlushReason::Full);
+            }
+            addRenderCommandToInstances(rc, instances + instanceCount);
+            instanceCount++;
+            #if SAC_DEBUG
+            batchTriangleCount += 2;
+            #endif
+            continue;
+        } else if (instanceCount > 0) {
+            #if SAC_DEBUG
+            batchSizes.push_back(std::make_pair(BatchFlushReason::NewPath, batchTriangleCount));
+            batchTriangleCount = 0;
+            #endif
+            flushBatch(BatchFlushReason::NewPath);
+        }
+
         // lookup shape
         const Polygon& polygon = theTransformationSystem.shapes[rc.shapeType];
 
-        if (((batchVertexCount + polygon.vertices.size()) >= MAX_VERTEX_COUNT) | ((indiceCount + polygon.indices.size()) >= MAX_INDICE_COUNT)) {
+        if (((batchVertexCount + polygon.vertices.size()) >= MAX_VERTEX_COUNT) | ((indiceCount + polygon.indices.size() + 2) >= MAX_INDICE_COUNT)) {
             #if SAC_DEBUG
             batchSizes.push_back(std::make_pair(BatchFlushReason::Full, batchTriangleCount));
             batchTriangleCount = 0;
             #endif
-            indiceCount = batchVertexCount = drawBatchES2(vertices, indices, batchVertexCount, indiceCount, activeVertexBuffer);
+            flushBatch(BatchFlushReason::Full);
         }
 
         // ADD TO BATCH
@@ -562,7 +700,7 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
     #if SAC_DEBUG
     batchSizes.push_back(std::make_pair(BatchFlushReason::End, batchTriangleCount));
     #endif
-    drawBatchES2(vertices, indices, batchVertexCount, indiceCount, activeVertexBuffer);
+    flushBatch(BatchFlushReason::End);
 
     #if 0
     FIXME
@@ -601,6 +739,18 @@ void RenderingSystem::drawRenderCommands(RenderQueue& commands) {
 
     glState.flags.current = currentFlags;
 
+    lastFrameDrawCalls = frameDrawCalls;
+    lastFrameSkippedGLCalls = GLState::skippedCalls;
+    PROFILE_COUNTER("Render", "draw-calls", frameDrawCalls);
+    PROFILE_COUNTER("Render", "gl-calls-skipped", GLState::skippedCalls);
+    if (statsEnabled) {
+        memcpy(lastFrameBatchFlushes, batchFlushes, sizeof(batchFlushes));
+        for (int i=0; i<BatchFlushReason::Count; ++i) {
+            PROFILE_COUNTER("Render",
+                std::string("batch-flush-") + batchFlushReasonName((BatchFlushReason::Enum)i), batchFlushes[i]);
+        }
+    }
+
     #if SAC_DEBUG
     check_GL_errors("Frame end");
     #endif
@@ -745,14 +895,16 @@ void RenderingSystem::ImImpl_RenderDrawLists2(int cmd_lists_count) {
     GL_OPERATION(glPolygonMode(GL_FRONT_AND_BACK, GL_FILL))
     theRenderingSystem.glState.flags.update(OpaqueFlagSet);
 
+    GLState& glState = theRenderingSystem.glState;
+
     GL_OPERATION(glEnable(GL_BLEND))
-    GL_OPERATION(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA))
+    glState.blendFunc.update(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     GL_OPERATION(glDisable(GL_CULL_FACE))
-    GL_OPERATION(glDisable(GL_DEPTH_TEST))
+    glState.depthTest.update(false);
     GL_OPERATION(glEnable(GL_SCISSOR_TEST))
 
 
-    GL_OPERATION(glUseProgram(leProgram))
+    glState.program.update(leProgram);
     const float width = ImGui::GetIO().DisplaySize.x;
     const float height = ImGui::GetIO().DisplaySize.y;
 
@@ -773,15 +925,9 @@ void RenderingSystem::ImImpl_RenderDrawLists2(int cmd_lists_count) {
 
     glm::mat4 mvp;
     mvp = glm::ortho(0.0f, width, height, 0.0f, 0.0f, 1.0f);
-    GL_OPERATION( glUniformMatrix4fv(leProgramuniformMatrix, 1, GL_FALSE, glm::value_ptr(mvp)))
-    GL_OPERATION(glUniform1i(leProgramuniformColorSampler, 0))
-    GL_OPERATION(glActiveTexture(GL_TEXTURE0))
-    GL_OPERATION(glBindTexture(GL_TEXTURE_2D, fontTex))
-
-    // Enable hard-coded attributes
-    GL_OPERATION(glEnableVertexAttribArray(0))
-    GL_OPERATION(glEnableVertexAttribArray(1))
-    GL_OPERATION(glEnableVertexAttribArray(2))
+    glState.uniforms.matrix4(leProgram, leProgramuniformMatrix, glm::value_ptr(mvp));
+    glState.uniforms.sampler(leProgram, leProgramuniformColorSampler, 0);
+    glState.textures.bind(0, fontTex);
 
     // Render command lists
     for (int n = 0; n < cmd_lists_count; n++)
@@ -793,7 +939,8 @@ void RenderingSystem::ImImpl_RenderDrawLists2(int cmd_lists_count) {
 
         if (!size) continue;
 
-        GL_OPERATION(glBindBuffer(GL_ARRAY_BUFFER, theRenderingSystem.glBuffers[Buffers::Editor]))
+        const GLuint editorBuffer = theRenderingSystem.glBuffers[Buffers::Editor];
+        glState.buffers.bind(GL_ARRAY_BUFFER, editorBuffer);
         GL_OPERATION(glBufferData(GL_ARRAY_BUFFER, size, 0, GL_STREAM_DRAW))
         GL_OPERATION(glBufferSubData(GL_ARRAY_BUFFER, 0,
                 size, &cmd_list->vtx_buffer[0]))
@@ -802,11 +949,8 @@ void RenderingSystem::ImImpl_RenderDrawLists2(int cmd_lists_count) {
         unsigned short* indices = new unsigned short[verticesCount];
         for (unsigned i=0; i<verticesCount; i++) indices[i] = i;
         // Upload indices to indice buffer
-        GL_OPERATION(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, theRenderingSystem.glBuffers[Buffers::Indice]))
-        GL_OPERATION(glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            verticesCount * sizeof(unsigned short), 0, GL_STREAM_DRAW))
-        GL_OPERATION(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
-            verticesCount * sizeof(unsigned short), indices))
+        const unsigned indiceOffset = theRenderingSystem.indiceStream.upload(
+            indices, verticesCount * sizeof(unsigned short));
         delete[] indices;
 
         int vtx_offset = 0;
@@ -816,22 +960,28 @@ void RenderingSystem::ImImpl_RenderDrawLists2(int cmd_lists_count) {
         {
             GL_OPERATION(glScissor((int)pcmd->clip_rect.x, (int)(height - pcmd->clip_rect.w), (int)(pcmd->clip_rect.z - pcmd->clip_rect.x), (int)(pcmd->clip_rect.w - pcmd->clip_rect.y)))
 
-            GL_OPERATION(
-                glVertexAttribPointer(0 /*aWindowPosition*/, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (void*)(vtx_offset * sizeof(ImDrawVert))))
-            GL_OPERATION(
-                glVertexAttribPointer(1 /*aTexCoord*/, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (void*)(vtx_offset * sizeof(ImDrawVert) + 8)))
-            GL_OPERATION(
-                glVertexAttribPointer(2 /*aColor*/, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (void*)(vtx_offset * sizeof(ImDrawVert) + 16)))
-
-            GL_OPERATION(glDrawElements(GL_TRIANGLES, pcmd->vtx_count, GL_UNSIGNED_SHORT, 0))
+            // hard-coded attributes, through the state cache so the next
+            // batches see them
+            glState.vertexAttribs.pointer(0 /*aWindowPosition*/, editorBuffer,
+                2, sizeof(ImDrawVert), vtx_offset * sizeof(ImDrawVert));
+            glState.vertexAttribs.pointer(1 /*aTexCoord*/, editorBuffer,
+                2, sizeof(ImDrawVert), vtx_offset * sizeof(ImDrawVert) + 8);
+            glState.vertexAttribs.pointer(2 /*aColor*/, editorBuffer,
+                4, sizeof(ImDrawVert), vtx_offset * sizeof(ImDrawVert) + 16,
+                GL_UNSIGNED_BYTE, GL_TRUE);
+
+            GL_OPERATION(glDrawElements(GL_TRIANGLES, pcmd->vtx_count, GL_UNSIGNED_SHORT, (void*)(size_t)indiceOffset))
             vtx_offset += pcmd->vtx_count;
 
         }
     }
     GL_OPERATION(glDisable(GL_SCISSOR_TEST))
-    GL_OPERATION(glEnable(GL_DEPTH_TEST))
+    glState.depthTest.update(true);
+    // engine batches never feed attribute 2: leave it disabled
+    glState.vertexAttribs.disable(2);
+    previousActiveVertexBuffer = Buffers::Count;
 
     // Restore pre-multiplied alpha blending
-    GL_OPERATION(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA))
+    glState.blendFunc.update(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 }
 #endif
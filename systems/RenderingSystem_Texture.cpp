@@ -24,98 +24,91 @@
 #include "RenderingSystem_Private.h"
 #include "opengl/OpenGLTextureCreator.h"
 
-#include "util/DataFileParser.h"
+#include "util/CompiledAssets.h"
 
 #include <stdint.h>
 #include <fstream>
-
-void RenderingSystem::loadAtlas(const std::string& atlasName, bool forceImmediateTextureLoading) {
-    const std::string atlasDesc = atlasName + ".atlas";
-
-    FileBuffer file = assetAPI->loadAsset(atlasDesc);
-    if (!file.data) {
-        LOGF("Unable to load atlas description file '" << atlasDesc << "'");
-        return;
+#include <algorithm>
+
+static_assert(CompiledAtlas::MaxOpaqueRects == TextureInfo::MaxOpaqueRects,
+    "compiled atlas and TextureInfo opaque rects limits differ");
+
+// Compiled description (.catlas) is used in place when available, otherwise
+// the text one is compiled in memory
+void RenderingSystem::parseAtlas(const std::string& atlasName, int atlasIndex, AtlasImages& images) const {
+    FileBuffer file = assetAPI->mapAsset(atlasName + CompiledAtlas::Extension);
+    const CompiledAtlas::Header* header = CompiledAtlas::validate(file);
+    std::vector<uint8_t> compiled;
+
+    if (!header) {
+        if (file.data)
+            assetAPI->unmapAsset(file);
+        file = FileBuffer();
+
+        const std::string atlasDesc = atlasName + ".atlas";
+        FileBuffer text = assetAPI->loadAsset(atlasDesc);
+        if (!text.data) {
+            LOGF("Unable to load atlas description file '" << atlasDesc << "'");
+            return;
+        }
+        const bool valid = CompiledAtlas::compile(text, atlasDesc, compiled);
+        delete[] text.data;
+        if (!valid)
+            return;
+        FileBuffer inMemory;
+        inMemory.data = &compiled[0];
+        inMemory.size = compiled.size();
+        header = CompiledAtlas::validate(inMemory);
     }
-    DataFileParser dfp;
-    if (!dfp.load(file, atlasDesc)) {
-        LOGE("Unable to parse '" << atlasDesc << "'");
-        delete[] file.data;
-        return;
+
+    LOGV(1, "atlas '" << atlasName << "' -> index: " << atlasIndex);
+    const glm::vec2 atlasSize(header->atlasSize[0], header->atlasSize[1]);
+    const CompiledAtlas::Image* image = CompiledAtlas::images(header);
+    images.reserve(header->imageCount);
+    for (unsigned i=0; i<header->imageCount; i++, image++) {
+        glm::vec4 opaqueRects[TextureInfo::MaxOpaqueRects];
+        const int opaqueCount = std::min((int)image->opaqueCount, (int)TextureInfo::MaxOpaqueRects);
+        for (int r=0; r<opaqueCount; r++) {
+            opaqueRects[r] = glm::vec4(image->opaqueRects[r][0], image->opaqueRects[r][1],
+                image->opaqueRects[r][2], image->opaqueRects[r][3]);
+        }
+        images.push_back(std::make_pair(image->nameHash,
+            TextureInfo(InternalTexture::Invalid,
+                glm::vec2(image->positionInAtlas[0], image->positionInAtlas[1]),
+                glm::vec2(image->sizeInAtlas[0], image->sizeInAtlas[1]),
+                image->rotated, atlasSize,
+                glm::vec2(image->cropOffset[0], image->cropOffset[1]),
+                glm::vec2(image->originalSize[0], image->originalSize[1]),
+                opaqueRects, opaqueCount, atlasIndex)));
     }
+    LOGV(1, "Atlas '" << atlasName << "' parsed " << header->imageCount << " images"
+        << (file.data ? " (compiled)" : ""));
 
+    if (file.data)
+        assetAPI->unmapAsset(file);
+}
 
+void RenderingSystem::registerAtlas(const std::string& atlasName, bool forceImmediateTextureLoading, const AtlasImages& images) {
     Atlas a;
     a.name = atlasName;
+    a.lastUsedFrame = 0;
     if (forceImmediateTextureLoading) {
         a.ref = textureLibrary.load(atlasName.c_str());
+        textureLibrary.prefetch(atlasName);
     } else {
         a.ref = InvalidTextureRef;
     }
     atlas.push_back(a);
-    int atlasIndex = atlas.size() - 1;
-    int count = 0;
 
-    glm::vec2 atlasSize;
-    if (!dfp.get(DataFileParser::GlobalSection, "atlas_size", &atlasSize.x, 2)) {
-        LOGE("Missing 'atlas_size' attribute in '" << atlasDesc << "'");;
-        goto cleanup;
+    for (const auto& image: images) {
+        textureLibrary.add(image.first, image.second);
     }
-    LOGV(1, "atlas '" << atlasName << "' -> index: " << atlasIndex);
-
-    do {
-        std::stringstream sectionB;
-        sectionB << "image" << count;
-        const hash_t section = Murmur::RuntimeHash(sectionB.str().c_str());
-
-        if (!dfp.hasSection(section))
-            break;
+}
 
-        std::string assetName;
-        if (!dfp.get(section, "name", &assetName, 1)) {
-            LOGE(atlasDesc << ": missing 'name' in section '" << section << "'");
-            goto cleanup;
-        }
-        glm::vec2 originalSize;
-        if (!dfp.get(section, "original_size", &originalSize.x, 2)) {
-            LOGE(atlasDesc << '/' << assetName << ": missing 'original_size' in section '" << section << "'");
-            goto cleanup;
-        }
-        glm::vec2 posInAtlas;
-        if (!dfp.get(section, "position_in_atlas", &posInAtlas.x, 2)) {
-            LOGE(atlasDesc << '/' << assetName << ": missing 'position_in_atlas' in section '" << section << "'");
-            goto cleanup;
-        }
-        glm::vec2 sizeInAtlas;
-        if (!dfp.get(section, "size_in_atlas", &sizeInAtlas.x, 2)) {
-            LOGE(atlasDesc << '/' << assetName << ": missing 'size_in_atlas' in section '" << section << "'");
-            goto cleanup;
-        }
-        glm::vec2 reduxOffset;
-        if (!dfp.get(section, "crop_offset", &reduxOffset.x, 2)) {
-            LOGE(atlasDesc << '/' << assetName << ": missing 'crop_offset' in section '" << section << "'");
-            goto cleanup;
-        }
-        int rotate;
-        if (!dfp.get(section, "rotated", &rotate, 1)) {
-            LOGE(atlasDesc << '/' << assetName << ": missing 'rotated' in section '" << section << "'");
-            goto cleanup;
-        }
-        glm::vec4 opaqueRect;
-        if (!dfp.get(section, "opaque_rect", &opaqueRect.x, 4, false)) {
-            LOGV(1, "No 'opaque_rect' in section '" << section << "' for image " << assetName);
-            opaqueRect = glm::vec4(0.0f);
-        }
-        glm::vec2 start(opaqueRect.x, opaqueRect.y);
-        glm::vec2 size(opaqueRect.z, opaqueRect.w);
-        const TextureInfo info(InternalTexture::Invalid, posInAtlas, sizeInAtlas, rotate, atlasSize, reduxOffset, originalSize, start, size, atlasIndex);
-        textureLibrary.add(assetName, info);
-        count++;
-    } while (true);
-
-    LOGV(1, "Atlas '" << atlasName << "' loaded " << count << " images");
-cleanup:
-    delete[] file.data;
+void RenderingSystem::loadAtlas(const std::string& atlasName, bool forceImmediateTextureLoading) {
+    AtlasImages images;
+    parseAtlas(atlasName, atlas.size(), images);
+    registerAtlas(atlasName, forceImmediateTextureLoading, images);
 }
 
 void RenderingSystem::invalidateAtlasTextures() {
@@ -128,6 +121,20 @@ void RenderingSystem::invalidateAtlasTextures() {
     }
 }
 
+void RenderingSystem::prefetchAtlas(const std::string& atlasName) {
+    for (unsigned i=0; i<atlas.size(); i++) {
+        if (atlas[i].name == atlasName) {
+            if (atlas[i].ref == InvalidTextureRef) {
+                LOGV(1, "Prefetch atlas '" << atlasName << "'");
+                PROFILE("Texture", "prefetch-atlas-" + atlasName, InstantEvent);
+                textureLibrary.prefetch(atlasName);
+            }
+            return;
+        }
+    }
+    LOGW("Cannot prefetch unknown atlas '" << atlasName << "'");
+}
+
 void RenderingSystem::unloadAtlas(const std::string& atlasName) {
     std::stringstream realName;
     realName << OpenGLTextureCreator::DPI2Folder(OpenGLTextureCreator::dpi)
@@ -142,13 +149,63 @@ void RenderingSystem::unloadAtlas(const std::string& atlasName) {
 
 }
 
+void RenderingSystem::evictUnusedAtlases() {
+    if (textureMemoryBudget == 0)
+        return;
+
+    unsigned usage = textureLibrary.memoryUsage();
+    PROFILE_COUNTER("Texture", "texture-memory-kb", usage / 1024);
+    if (usage <= textureMemoryBudget)
+        return;
+
+    // Candidates: loaded atlases not drawn by the last 2 updates (the
+    // previous render queue may still be in use by the render thread)
+    std::vector<int> candidates;
+    for (unsigned i=0; i<atlas.size(); i++) {
+        if (atlas[i].ref != InvalidTextureRef && atlas[i].lastUsedFrame + 2 <= updateCount)
+            candidates.push_back(i);
+    }
+    std::sort(candidates.begin(), candidates.end(), [this] (int a, int b) -> bool {
+        return atlas[a].lastUsedFrame < atlas[b].lastUsedFrame;
+    });
+
+    for (int idx: candidates) {
+        const TextureInfo* info = textureLibrary.get(atlas[idx].ref, false);
+        // load still pending
+        if (!info)
+            continue;
+        LOGI("Evict atlas '" << atlas[idx].name << "' (" << info->memorySize / 1024 << " kB, unused for "
+            << updateCount - atlas[idx].lastUsedFrame << " frames). Texture memory: "
+            << usage / 1024 << '/' << textureMemoryBudget / 1024 << " kB");
+        PROFILE("Texture", "evict-atlas-" + atlas[idx].name, InstantEvent);
+        usage -= std::min(usage, info->memorySize);
+        textureLibrary.unload(atlas[idx].ref);
+        atlas[idx].ref = InvalidTextureRef;
+        evictedAtlasCount++;
+
+        if (usage <= textureMemoryBudget)
+            break;
+    }
+    LOGW_IF(usage > textureMemoryBudget, "Texture memory budget exceeded: "
+        << usage / 1024 << '/' << textureMemoryBudget / 1024 << " kB, nothing left to evict");
+    PROFILE_COUNTER("Texture", "evicted-atlas-count", evictedAtlasCount);
+}
+
 void RenderingSystem::reloadTextures() {
     // Mark atlas textures invalid
     invalidateAtlasTextures();
 
     // reload individual textures
     // textureLibrary.reloadAll();
+    // before new programs are created: with a lost context, the old names
+    // could be reused by them
+    releaseInstancing();
     effectLibrary.reloadAll();
+    // programs are rebuilt: cached uniform values are meaningless
+    glState.invalidateAll();
+    initInstancing();
+    // atlas uvs may have changed: upload constant sprites again
+    std::fill(staticSignatures.begin(), staticSignatures.end(), 0);
 
     // rebuild framebuffers too
     for (auto& fb: nameToFramebuffer) {
@@ -161,6 +218,8 @@ void RenderingSystem::processDelayedTextureJobs() {
     PROFILE("Texture", "processDelayedTextureJobs", BeginEvent);
 
     textureLibrary.update();
+    textureLibrary.uploadDecoded();
+    textureLibrary.uploadRegions();
     effectLibrary.update();
 
     PROFILE("Texture", "processDelayedTextureJobs", EndEvent);
@@ -175,6 +234,8 @@ TextureRef RenderingSystem::loadTextureFile(const char* assetName) {
 #ifndef SAC_EMSCRIPTEN
     mutexes[L_QUEUE].unlock();
 #endif
+    // start decoding now, rather than when the render thread loads it
+    textureLibrary.prefetch(assetName);
     PROFILE("Texture", "loadTextureFile", EndEvent);
     return result;
 }
@@ -190,15 +251,22 @@ glm::vec2 RenderingSystem::getTextureSize(const TextureRef& textureRef) {
         LOGF("Texture size requested for a non-existent texture '" << INV_HASH(textureRef) << "' / " << (hash_t)textureRef);
     }
 
+    glm::vec2 size = info->originalSize;
+    // size is only known once decoded
+    if (info->uploadPending) {
+        const glm::vec2 decodedSize = textureLibrary.waitDecodedSize(textureRef);
+        size = (decodedSize != glm::vec2(0.0f)) ? decodedSize : info->originalSize;
+    }
+
     switch (OpenGLTextureCreator::dpi) {
         case DPI::Low:
-            return info->originalSize * 4.0f;
+            return size * 4.0f;
         case DPI::Medium:
-            return info->originalSize * 2.0f;
+            return size * 2.0f;
         default:
             break;
     }
-    return info->originalSize;
+    return size;
 }
 
 void RenderingSystem::unloadTexture(TextureRef ref, bool allowUnloadAtlas) {
@@ -20,9 +20,7 @@
 #if !DISABLE_SPOT_SYSTEM
 #include "SpotSystem.h"
 #include "TransformationSystem.h"
-#include "util/IntersectionUtil.h"
 
-#include <glm/gtx/norm.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 
 INSTANCE_IMPL(SpotSystem);
@@ -34,61 +32,35 @@ SpotSystem::SpotSystem() : ComponentSystemImpl<SpotComponent>(HASH("Spot", 0x5ee
     componentSerializer.add(new Property<int>(HASH("resolution", 0xc9d35125), OFFSET(resolution, tc)));
 }
 
-struct MyRectangle {
-    glm::vec2 position, size;
-    float rotation;
-};
-
 void SpotSystem::DoUpdate(float) {
-    // retrieve all blockers
-    const unsigned count = theSpotBlockSystem.entityCount();
-    if (count == 0)
-        return;
-    std::vector<MyRectangle> blocks;
-    blocks.reserve(count);
-    theSpotBlockSystem.forEachEntityDo([&] (Entity e) -> void {
-        const auto* tc = TRANSFORM(e);
-        MyRectangle rect;
-        rect.position = tc->position;
-        rect.size = tc->size;
-        rect.rotation = tc->rotation;
-        blocks.push_back(rect);
-    });
-
+    // compute every raycast end point
+    rays.clear();
     FOR_EACH_ENTITY_COMPONENT(Spot, e, sc)
-        auto* tc = TRANSFORM(e);
-        const glm::vec2 p1 = tc->position;
+        const glm::vec2& p1 = TRANSFORM(e)->position;
+
+        LOGF_IF(sc->resolution == 0, "Invalid resolution: " << sc->resolution << ". Must be > 0");
+        const float angleStep = sc->angle / sc->resolution;
+        for (int i=0; i<=sc->resolution; i++) {
+            rays.push_back(WorldQuery::Ray(p1, p1 + glm::rotate(glm::vec2(sc->distance, 0), angleStep * i)));
+        }
+    END_FOR_EACH()
+
+    // raycast them all at once
+    hits.resize(rays.size());
+    if (!rays.empty())
+        theSpotBlockSystem.world.raycast(&rays[0], rays.size(), &hits[0]);
 
+    unsigned ray = 0;
+    FOR_EACH_ENTITY_COMPONENT(Spot, e, sc)
         // clear previous result
         sc->area.vertices.clear();
         sc->area.indices.clear();
 
         // are defined as a triangle fan
-        sc->area.vertices.push_back(p1);
+        sc->area.vertices.push_back(TRANSFORM(e)->position);
 
-        LOGF_IF(sc->resolution == 0, "Invalid resolution: " << sc->resolution << ". Must be > 0");
-        const float angleStep = sc->angle / sc->resolution;
-        for (int i=0; i<=sc->resolution; i++) {
-            // compute raycast end point
-            const glm::vec2 p2 = p1 + glm::rotate(glm::vec2(sc->distance, 0), angleStep * i);
-
-            // raycast
-            glm::vec2 nearestIntersection = p2;
-            float minDistance2 = glm::distance2(p1, p2);
-            glm::vec2 intersections[2];
-            for (const auto& rect: blocks) {
-                int count =
-                    IntersectionUtil::lineRectangle(p1, p2, rect.position, rect.size, rect.rotation, intersections);
-
-                for (int j=0; j<count; j++) {
-                    float d = glm::distance2(p1, intersections[j]);
-                    if (d < minDistance2) {
-                        nearestIntersection = intersections[j];
-                        minDistance2 = d;
-                    }
-                }
-            }
-            sc->area.vertices.push_back(nearestIntersection);
+        for (int i=0; i<=sc->resolution; i++, ray++) {
+            sc->area.vertices.push_back(hits[ray].entity ? hits[ray].point : rays[ray].to);
         }
 
         // define indices
@@ -100,14 +72,29 @@ void SpotSystem::DoUpdate(float) {
         }
         LOGF_IF((int)sc->area.indices.size() != sc->resolution * 3,
             "Incorrect number of indices (3 indices par step expected. Resolution=" << sc->resolution << ", indices count: " << sc->area.indices.size());
-    }
+    END_FOR_EACH()
 }
 
 INSTANCE_IMPL(SpotBlockSystem);
 
 SpotBlockSystem::SpotBlockSystem() : ComponentSystemImpl<SpotBlockComponent>(HASH("SpotBlock", 0x5f0d912f)) { }
 
+void SpotBlockSystem::Delete(Entity e) {
+    world.remove(Get(e)->proxy, e);
+    ComponentSystemImpl<SpotBlockComponent>::Delete(e);
+}
+
 void SpotBlockSystem::DoUpdate(float) {
+    // suspended blocks don't block anything
+    for (auto e: suspended) {
+        SpotBlockComponent& bc = components[e];
+        world.remove(bc.proxy, e);
+        bc.proxy = -1;
+    }
 
+    FOR_EACH_ENTITY_COMPONENT(SpotBlock, e, bc)
+        const auto* tc = TRANSFORM(e);
+        bc->proxy = world.update(bc->proxy, e, tc->position, tc->size, tc->rotation, 1);
+    END_FOR_EACH()
 }
 #endif
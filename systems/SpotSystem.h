@@ -24,6 +24,7 @@
 
 #include "System.h"
 #include "opengl/Polygon.h"
+#include "util/WorldQuery.h"
 
 struct SpotComponent {
     SpotComponent() : angle(6.28318530718f), distance(10.f), resolution(36) {}
@@ -43,10 +44,18 @@ struct SpotComponent {
 #endif
 
 UPDATABLE_SYSTEM(Spot)
+// rays of all spots, cast at once against SpotBlockSystem::world
+std::vector<WorldQuery::Ray> rays;
+std::vector<WorldQuery::Hit> hits;
 }
 ;
 
-struct SpotBlockComponent {};
+struct SpotBlockComponent {
+    SpotBlockComponent() : proxy(-1) {}
+
+    // world handle, managed by SpotBlockSystem
+    int proxy;
+};
 
 #define theSpotBlockSystem SpotBlockSystem::GetInstance()
 #if SAC_DEBUG
@@ -56,6 +65,12 @@ struct SpotBlockComponent {};
 #endif
 
 UPDATABLE_SYSTEM(SpotBlock)
+
+public:
+void Delete(Entity e) override;
+
+// every SpotBlock. Updated before SpotSystem, and available to game code.
+WorldQuery world;
 }
 ;
 #endif
@@ -24,12 +24,13 @@
 #include <ctype.h>
 #include <sstream>
 #include <iomanip>
+#include <cstdio>
 
 #include <glm/glm.hpp>
+#include <glm/gtx/rotate_vector.hpp>
 #include "base/EntityManager.h"
 #include "base/Log.h"
 
-#include "AnchorSystem.h"
 #include "TransformationSystem.h"
 #include "RenderingSystem.h"
 
@@ -42,11 +43,11 @@ const float TextComponent::RIGHT = 1.0f;
 const char InlineImageDelimiter[] = {(char)0xC3, (char)0x97};
 
 // Utility functions
-static Entity createRenderingEntity();
 static void parseInlineImageString(const std::string& s, std::string* image, float* scale);
 static float computePartialStringWidth(TextComponent* trc, size_t from, size_t to, float charHeight, const TextSystem::FontDesc& fontDesc);
 static float computeStringWidth(TextComponent* trc, float charHeight, const TextSystem::FontDesc& fontDesc);
 static float computeStartX(float stringWidth, const TextComponent* trc);
+static bool sameLayoutParameters(const TextSystem::TextLayout& layout, const TextComponent* trc, unsigned length, const TransformationComponent* trans);
 
 // System implementation
 INSTANCE_IMPL(TextSystem);
@@ -157,41 +158,39 @@ struct CharSequenceToUnicode {
     }
 };
 
-static void adjustLineHorizontalCentering(std::vector<Entity>& charInLine, const float startX, const TextComponent* trc, const TransformationComponent* trans) {
-    if (!charInLine.empty()) {
+static void adjustLineHorizontalCentering(std::vector<TextSystem::GlyphLayout>& layout, unsigned lineStart, const float startX, const TextComponent* trc, const TransformationComponent* trans) {
+    if (lineStart < layout.size()) {
         // real line width
-        float leftest = TRANSFORM(charInLine.front())->position.x - TRANSFORM(charInLine.front())->size.x * -0.5f;
-        float rightest = TRANSFORM(charInLine.back())->position.x - TRANSFORM(charInLine.back())->size.x * -0.5f;
+        const auto& front = layout[lineStart];
+        const auto& back = layout.back();
+        float leftest = front.position.x - front.size.x * -0.5f;
+        float rightest = back.position.x - back.size.x * -0.5f;
         float width = rightest - leftest;
         float start = startX + (trans->size.x - width) * trc->positioning;
         float diff = start - startX;
 
-        for (auto e: charInLine) {
-            TRANSFORM(e)->position.x += diff;
+        for (unsigned i=lineStart; i<layout.size(); i++) {
+            layout[i].position.x += diff;
         }
-        charInLine.clear();
     }
 }
 
 void TextSystem::DoUpdate(float dt) {
+    // glyphs are rebuilt every frame
+    auto& glyphs = theRenderingSystem.sprites[SpriteSource::Text];
+    glyphs.clear();
+
     if (!entityWithComponent.empty() && fontRegistry.empty()) {
         LOGW("Trying to use Text, with no font defined");
         return;
     }
 
-    unsigned letterCount = 0;
-
     FOR_EACH_ENTITY_COMPONENT(Text, entity, trc)
-        const unsigned firstEntity = letterCount;
-
         // early quit if hidden
         if (!trc->show) {
             continue;
         }
 
-#if SAC_DEBUG
-        const TextureRef invalidCharTexture = InvalidTextureRef;
-#endif
         // text blinking
         if (trc->blink.onDuration > 0) {
             if (trc->blink.accum >= 0) {
@@ -237,252 +236,257 @@ void TextSystem::DoUpdate(float dt) {
             length--;
         }
 
-        // Add rendering entity if needed
-        int missingCount = length - (renderingEntitiesPool.size() - letterCount);
-        for (int i=0; i <= missingCount; i++) {
-            renderingEntitiesPool.push_back(createRenderingEntity());
+        const TransformationComponent* trans = TRANSFORM(entity);
+
+        // Reuse the previous layout if none of its parameters changed
+        TextLayout& cache = layoutCache[entity];
+        if (!sameLayoutParameters(cache, trc, length, trans)) {
+            cache.text = trc->text;
+            cache.length = length;
+            cache.fontName = trc->fontName;
+            cache.charHeight = trc->charHeight;
+            cache.flags = trc->flags;
+            cache.size = trans->size;
+            cache.positioning = trc->positioning;
+            cache.maxLineToUse = trc->maxLineToUse;
+            layoutText(entity, trc, length, fontDesc, trans, cache.glyphs);
         }
 
-        // Read TRANSFORM after potential calls to createRenderingEntity
-        // Otherwise trans ptr might become invalid
-        const TransformationComponent* trans = TRANSFORM(entity);
+        // emit glyphs in world space
+        const float z = trans->z + 0.001f; // put text in front
 
-        // Determine font size (character height)
-        float stringWidth = 0;
-        float charHeight = trc->charHeight;
-        if (trc->flags & TextComponent::AdjustHeightToFillWidthBit) {
-            const float targetWidth = trans->size.x;
-            stringWidth = computeStringWidth(trc, 1, fontDesc);
-            charHeight = targetWidth / stringWidth;
-            // Limit to maxCharHeight if defined
-            if (trc->maxCharHeight > 0 ) {
-                charHeight = glm::min(trc->maxCharHeight, charHeight);
-            }
-            stringWidth *= charHeight;
+        #if SAC_DEBUG
+        LOGW_IF (z > 1.0,
+            "'" << theEntityManager.entityName(entity) << "' (text='"
+                << trc->text << "') has z = " << trans->z << " -> letters won't be visible");
+        #endif
+        for (const auto& l: cache.glyphs) {
+            // hidden letter (space)
+            if (l.texture == InvalidTextureRef)
+                continue;
+            RenderingSystem::Sprite g;
+            g.position = trans->position + glm::rotate(l.position, trans->rotation);
+            g.size = l.size;
+            g.rotation = trans->rotation;
+            g.z = z;
+            g.texture = l.texture;
+            g.color = l.inlineImage ? Color() : trc->color;
+            g.cameraBitMask = trc->cameraBitMask;
+            g.flags = RenderingFlags::NonOpaque | RenderingFlags::FastCulling;
+            g.owner = entity;
+#if SAC_INGAME_EDITORS
+            g.highLight = trc->highLight;
+#endif
+            glyphs.push_back(g);
         }
 
-relayout:
-        if (stringWidth <= 0) {
-            stringWidth = computeStringWidth(trc, charHeight, fontDesc);
+
+        // if we appended a caret, remove it
+        if (caretInserted) {
+            trc->text.resize(trc->text.length() - 1);
         }
-        int lineCount = 1, layoutCount = 0;
-        // Variables
-        const float startX = (trc->flags & TextComponent::MultiLineBit) ?
-            (trans->size.x * -0.5f) : computeStartX(stringWidth, trc);
-        float x = startX, y = 0;
-        bool newWord = true;
+
+#if SAC_INGAME_EDITORS
+        trc->highLight = false;
+#endif
+    END_FOR_EACH()
+}
+
+// Compute glyphs position (relative to the text entity) and size
+void TextSystem::layoutText(Entity LOG_USAGE_ONLY(entity), TextComponent* trc, unsigned length, const FontDesc& fontDesc, const TransformationComponent* trans, std::vector<GlyphLayout>& layout) {
+    // Determine font size (character height)
+    float stringWidth = 0;
+    float charHeight = trc->charHeight;
+    if (trc->flags & TextComponent::AdjustHeightToFillWidthBit) {
+        const float targetWidth = trans->size.x;
+        stringWidth = computeStringWidth(trc, 1, fontDesc);
+        charHeight = targetWidth / stringWidth;
+        // Limit to maxCharHeight if defined
+        if (trc->maxCharHeight > 0 ) {
+            charHeight = glm::min(trc->maxCharHeight, charHeight);
+        }
+        stringWidth *= charHeight;
+    }
+
+relayout:
+    if (stringWidth <= 0) {
+        stringWidth = computeStringWidth(trc, charHeight, fontDesc);
+    }
+    int lineCount = 1, layoutCount = 0;
+    // Variables
+    const float startX = (trc->flags & TextComponent::MultiLineBit) ?
+        (trans->size.x * -0.5f) : computeStartX(stringWidth, trc);
+    float x = startX, y = 0;
+    bool newWord = true;
 
 #if SAC_DEBUG
-        int lastValidCharIndex = -1;
-        std::vector<int> invalidLettersTexturePosition;
+    int lastValidCharIndex = -1;
+    std::vector<int> invalidLettersTexturePosition;
 #endif
-        CharSequenceToUnicode seqToUni;
-        std::vector<Entity> charInLine;
-
-        // Setup rendering for each individual letter
-        for(unsigned int i=0; i<length; i++) {
-            // If it's a multiline text, we must compute words/lines boundaries
-            if (trc->flags & TextComponent::MultiLineBit) {
-                size_t wordEnd = trc->text.find_first_of(" ,:.", i);
-                size_t lineEnd = trc->text.find_first_of("\n", i);
-                bool newLine = false;
-                if (wordEnd == i) {
-                    // next letter will be the start of a new word
-                    newWord = true;
-                } else if (lineEnd == i) {
-                    // next letter will be the start of a new line
+    CharSequenceToUnicode seqToUni;
+    layout.clear();
+    unsigned lineStart = 0;
+
+    // Setup rendering for each individual letter
+    for(unsigned int i=0; i<length; i++) {
+        // If it's a multiline text, we must compute words/lines boundaries
+        if (trc->flags & TextComponent::MultiLineBit) {
+            size_t wordEnd = trc->text.find_first_of(" ,:.", i);
+            size_t lineEnd = trc->text.find_first_of("\n", i);
+            bool newLine = false;
+            if (wordEnd == i) {
+                // next letter will be the start of a new word
+                newWord = true;
+            } else if (lineEnd == i) {
+                // next letter will be the start of a new line
+                newLine = true;
+            } else if (newWord) {
+                if (wordEnd == std::string::npos) {
+                    wordEnd = trc->text.length();
+                }
+                // compute length of next word
+                const float w = computePartialStringWidth(trc, i, wordEnd - 1, charHeight, fontDesc);
+                // If it doesn't fit on current line -> start new line
+                if (x + w >= trans->size.x * 0.5) {
                     newLine = true;
-                } else if (newWord) {
-                    if (wordEnd == std::string::npos) {
-                        wordEnd = trc->text.length();
-                    }
-                    // compute length of next word
-                    const float w = computePartialStringWidth(trc, i, wordEnd - 1, charHeight, fontDesc);
-                    // If it doesn't fit on current line -> start new line
-                    if (x + w >= trans->size.x * 0.5) {
-                        newLine = true;
-                    }
-                    newWord = false;
                 }
-                // Begin new line if requested
-                if (newLine) {
-                    adjustLineHorizontalCentering(charInLine, startX, trc, trans);
-                    lineCount++;
-                    y -= 1.2f * charHeight;
-                    x = startX;
-                    if (lineEnd == i) {
-                      continue;
-                    }
+                newWord = false;
+            }
+            // Begin new line if requested
+            if (newLine) {
+                adjustLineHorizontalCentering(layout, lineStart, startX, trc, trans);
+                lineStart = layout.size();
+                lineCount++;
+                y -= 1.2f * charHeight;
+                x = startX;
+                if (lineEnd == i) {
+                  continue;
                 }
             }
+        }
 
-            unsigned char letter = (unsigned char)trc->text[i];
-            int skip = -1;
+        unsigned char letter = (unsigned char)trc->text[i];
+        int skip = -1;
 
-            if (!seqToUni.update(letter))
-                continue;
-            uint32_t unicode = seqToUni.unicode;
-            seqToUni.reset();
+        if (!seqToUni.update(letter))
+            continue;
+        uint32_t unicode = seqToUni.unicode;
+        seqToUni.reset();
 #if SAC_DEBUG
-            lastValidCharIndex++;
+        lastValidCharIndex++;
 #endif
 
-            LOGW_IF(renderingEntitiesPool.size() <= letterCount, "Missing rendering text entities");
-            const Entity e = renderingEntitiesPool[letterCount];
-            if (trc->flags & TextComponent::MultiLineBit) {
-                charInLine.push_back(e);
-            }
-            RenderingComponent* rc = RENDERING(e);
-            TransformationComponent* tc = TRANSFORM(e);
-
-            /*
-            AnchorComponent ac = ANCHOR(e);
-            ac->parent = entity;
-            ac->z = 0.001; // put text in front
-            ac->position = trans->position;
-            */
-            rc->show = trc->show;
-            rc->cameraBitMask = trc->cameraBitMask;
-            rc->flags = RenderingFlags::NonOpaque | RenderingFlags::FastCulling;
-#if SAC_INGAME_EDITORS
-            rc->highLight = trc->highLight;
-#endif
-            // At this point, we have the proper unicodeId to display,
-            // except if it's an image delimiter
-            if (unicode == 0x00D7) {
-                size_t next = trc->text.find(InlineImageDelimiter, i+1, 2);
-                LOGV(3, "Inline image '" << trc->text.substr(i, next - i + 1) << "'");
-                LOGE_IF(next == std::string::npos, "Malformed string, cannot find inline image delimiter: '" << trc->text << "'");
-                std::string texture;
-                float scale = 1.0f;
-                parseInlineImageString(
-                    trc->text.substr(i+1, next - 1 - (i+1) + 1), &texture, &scale);
-                rc->texture = theRenderingSystem.loadTextureFile(texture.c_str());
-                rc->color = Color();
-                glm::vec2 size = theRenderingSystem.getTextureSize(texture.c_str());
-                tc->size.y = charHeight * scale;
-                tc->size.x = tc->size.y * size.x / size.y;
-                // skip inline image letters
-                skip = next + 1;
-            } else {
-                if (unicode > fontDesc.highestUnicode) {
+        GlyphLayout glyph;
+        glyph.inlineImage = false;
+        // At this point, we have the proper unicodeId to display,
+        // except if it's an image delimiter
+        if (unicode == 0x00D7) {
+            size_t next = trc->text.find(InlineImageDelimiter, i+1, 2);
+            LOGV(3, "Inline image '" << trc->text.substr(i, next - i + 1) << "'");
+            LOGE_IF(next == std::string::npos, "Malformed string, cannot find inline image delimiter: '" << trc->text << "'");
+            std::string texture;
+            float scale = 1.0f;
+            parseInlineImageString(
+                trc->text.substr(i+1, next - 1 - (i+1) + 1), &texture, &scale);
+            glyph.texture = theRenderingSystem.loadTextureFile(texture.c_str());
+            glyph.inlineImage = true;
+            glm::vec2 size = theRenderingSystem.getTextureSize(texture.c_str());
+            glyph.size.y = charHeight * scale;
+            glyph.size.x = glyph.size.y * size.x / size.y;
+            // skip inline image letters
+            skip = next + 1;
+        } else {
+            if (unicode > fontDesc.highestUnicode) {
 #if SAC_DEBUG
-                    LOGW("Missing unicode char: "
-                        << unicode << "(highest one: " << fontDesc.highestUnicode
-                            << ") for string '" << trc->text << "', entity: '"
-                    << theEntityManager.entityName(entity) << "'");
+                LOGW("Missing unicode char: "
+                    << unicode << "(highest one: " << fontDesc.highestUnicode
+                        << ") for string '" << trc->text << "', entity: '"
+                << theEntityManager.entityName(entity) << "'");
 #endif
-                    unicode = 0;
-                }
-                const CharInfo& info = fontDesc.entries[unicode];
+                unicode = 0;
+            }
+            const CharInfo& info = fontDesc.entries[unicode];
 
-                tc->size = glm::vec2(charHeight * info.h2wRatio, charHeight);
-                // if letter is space, hide it
-                if (unicode == 0x20) {
-                    rc->show = false;
-                } else {
+            glyph.size = glm::vec2(charHeight * info.h2wRatio, charHeight);
+            // if letter is space, hide it
+            if (unicode == 0x20) {
+                glyph.texture = InvalidTextureRef;
+            } else {
 #if SAC_DEBUG
-                    if (info.texture == invalidCharTexture) {
-                        LOGV(1, "Missing unicode char: 0x" << std::hex << unicode << std::dec);
-                        invalidLettersTexturePosition.push_back(lastValidCharIndex);
-                    }
-#endif
-                    rc->texture = info.texture;
-                    rc->color = trc->color;
+                if (info.texture == InvalidTextureRef) {
+                    LOGV(1, "Missing unicode char: 0x" << std::hex << unicode << std::dec);
+                    invalidLettersTexturePosition.push_back(lastValidCharIndex);
                 }
-            }
-            // Advance position
-            letterCount++;
-            x += tc->size.x * 0.5f;
-            tc->position.x = x;
-            tc->position.y = y; // + (inlineImage ? tc->size.x * 0.25 : 0);
-            x += tc->size.x * 0.5f;
-
-            // Special case for numbers rendering, add semi-space to group (e.g: X XXX XXX)
-            if (trc->flags & TextComponent::IsANumberBit && ((length - i - 1) % 3) == 0) {
-                x += fontDesc.entries[(unsigned)'0'].h2wRatio * charHeight * 0.75f;
-            }
-
-            // Fastforward to skip some chars (e.g: inline image description)
-            if (skip >= 0) {
-                i = skip;
+#endif
+                glyph.texture = info.texture;
             }
         }
+        // Advance position
+        x += glyph.size.x * 0.5f;
+        glyph.position.x = x;
+        glyph.position.y = y; // + (inlineImage ? glyph.size.x * 0.25 : 0);
+        x += glyph.size.x * 0.5f;
+        layout.push_back(glyph);
+
+        // Special case for numbers rendering, add semi-space to group (e.g: X XXX XXX)
+        if (trc->flags & TextComponent::IsANumberBit && ((length - i - 1) % 3) == 0) {
+            x += fontDesc.entries[(unsigned)'0'].h2wRatio * charHeight * 0.75f;
+        }
 
-        adjustLineHorizontalCentering(charInLine, startX, trc, trans);
-
-        if (trc->maxLineToUse > 0 && lineCount > trc->maxLineToUse && ++layoutCount < 3) {
-            float target = charHeight * ((float)trc->maxLineToUse) / lineCount;
-            if (target < charHeight) {
-                float weight = 0.5;
-                charHeight = charHeight * (1 - weight) + target * weight;
-                letterCount -= (letterCount - firstEntity);
-                stringWidth = 0;
-                goto relayout;
-            }
+        // Fastforward to skip some chars (e.g: inline image description)
+        if (skip >= 0) {
+            i = skip;
         }
+    }
 
-        // update position
-        AnchorComponent ac;
-        ac.parent = entity;
-        ac.z = 0.001f; // put text in front
+    if (trc->flags & TextComponent::MultiLineBit) {
+        adjustLineHorizontalCentering(layout, lineStart, startX, trc, trans);
+    }
 
-        #if SAC_DEBUG
-        LOGW_IF (trans->z + ac.z > 1.0,
-            "'" << theEntityManager.entityName(entity) << "' (text='"
-                << trc->text << "') has z = " << trans->z << " -> letters won't be visible");
-        #endif
-        for (unsigned i=firstEntity; i<letterCount; i++) {
-            auto* tc = TRANSFORM(renderingEntitiesPool[i]);
-            ac.position = tc->position;
-            AnchorSystem::adjustTransformWithAnchor(tc, trans, &ac);
+    if (trc->maxLineToUse > 0 && lineCount > trc->maxLineToUse && ++layoutCount < 3) {
+        float target = charHeight * ((float)trc->maxLineToUse) / lineCount;
+        if (target < charHeight) {
+            float weight = 0.5;
+            charHeight = charHeight * (1 - weight) + target * weight;
+            stringWidth = 0;
+            goto relayout;
         }
-
+    }
 
 #if SAC_DEBUG
-        if (invalidLettersTexturePosition.size() > 0) {
-            std::stringstream ss;
-            ss << "Missing character(s) in string: '";
-            const auto offset = ss.str().size();
-            ss << trc->text << "', entity: '"
-                << theEntityManager.entityName(entity) << "'.";
-
-            std::string str(offset + trc->text.size(), ' ');
+    if (invalidLettersTexturePosition.size() > 0) {
+        std::stringstream ss;
+        ss << "Missing character(s) in string: '";
+        const auto offset = ss.str().size();
+        ss << trc->text << "', entity: '"
+            << theEntityManager.entityName(entity) << "'.";
 
-            for (auto position : invalidLettersTexturePosition) {
-                str[offset + position] = '^';
-            }
-            //finally, show the log!
-            LOGW_EVERY_N(60, ss.str() << std::endl << std::string(LOG_OFFSET(), ' ') << str);
-        }
-#endif
+        std::string str(offset + trc->text.size(), ' ');
 
-        // if we appended a caret, remove it
-        if (caretInserted) {
-            trc->text.resize(trc->text.length() - 1);
+        for (auto position : invalidLettersTexturePosition) {
+            str[offset + position] = '^';
         }
-
-#if SAC_INGAME_EDITORS
-        trc->highLight = false;
+        //finally, show the log!
+        LOGW_EVERY_N(60, ss.str() << std::endl << std::string(LOG_OFFSET(), ' ') << str);
+    }
 #endif
-    END_FOR_EACH()
+}
 
-    if (renderingEntitiesPool.size() > letterCount*2) {
-        for (unsigned i=letterCount*2; i<renderingEntitiesPool.size(); i++) {
-            theEntityManager.DeleteEntity(renderingEntitiesPool[i]);
-        }
-        renderingEntitiesPool.resize(letterCount*2);
-    }
-    for (unsigned i=letterCount; i<renderingEntitiesPool.size(); i++) {
-        const Entity e = renderingEntitiesPool[i];
-        // ANCHOR(e)->parent = 0;
-        RENDERING(e)->show = false;
+void TextSystem::registerFont(const char* name, const std::map<uint32_t, float>& charH2Wratio) {
+    std::vector<CompiledFont::Glyph> glyphs;
+    glyphs.reserve(charH2Wratio.size());
+    for (std::map<uint32_t, float>::const_iterator it=charH2Wratio.begin(); it!=charH2Wratio.end(); ++it) {
+        CompiledFont::Glyph g;
+        g.unicode = it->first;
+        g.h2wRatio = it->second;
+        glyphs.push_back(g);
     }
+    registerFont(name, &glyphs[0], glyphs.size());
 }
 
-void TextSystem::registerFont(const char* name, const std::map<uint32_t, float>& charH2Wratio) {
+void TextSystem::registerFont(const char* name, const CompiledFont::Glyph* glyphs, unsigned glyphCount) {
     hash_t fontId = Murmur::RuntimeHash(name);
-    uint32_t highestUnicode = charH2Wratio.rbegin()->first;
+    uint32_t highestUnicode = glyphs[glyphCount - 1].unicode;
 
     TextureRef invalidCharTexture = InvalidTextureRef;
     float invalidRatio = 0.5;
@@ -495,21 +499,22 @@ void TextSystem::registerFont(const char* name, const std::map<uint32_t, float>&
         font.entries[i].h2wRatio = invalidRatio;
     }
 
-    for (std::map<uint32_t, float>::const_iterator it=charH2Wratio.begin(); it!=charH2Wratio.end(); ++it) {
-        CharInfo& info = font.entries[it->first];
-        info.h2wRatio = it->second;
-        std::stringstream ss;
-        ss.fill('0');
-        ss << std::hex << std::setw(2) << it->first << '_' << name;
-        info.texture = theRenderingSystem.loadTextureFile(ss.str().c_str());
+    char textureName[256];
+    for (unsigned i=0; i<glyphCount; i++) {
+        CharInfo& info = font.entries[glyphs[i].unicode];
+        info.h2wRatio = glyphs[i].h2wRatio;
+        snprintf(textureName, sizeof(textureName), "%02x_%s", glyphs[i].unicode, name);
+        info.texture = theRenderingSystem.loadTextureFile(textureName);
         if (info.texture == InvalidTextureRef) {
-            LOGW("Font '" << name << "' uses unknown texture: '" << ss.str() << "'");
+            LOGW("Font '" << name << "' uses unknown texture: '" << textureName << "'");
         }
     }
     unsigned space = 0x20;
     unsigned r = glm::min((unsigned)0x72, highestUnicode);
     font.entries[space].h2wRatio = font.entries[r].h2wRatio;
     fontRegistry[fontId] = font;
+    // metrics may have changed
+    layoutCache.clear();
 }
 
 float TextSystem::computeTextComponentWidth(TextComponent* trc) const {
@@ -523,28 +528,10 @@ float TextSystem::computeTextComponentWidth(TextComponent* trc) const {
 }
 
 void TextSystem::Delete(Entity e) {
-    /*
-    for (Entity subE: renderingEntitiesPool) {
-        // if we're deleting all entities, subE could have
-        // already been destroyed, without Text system noticing
-        auto* ac = theAnchorSystem.Get(subE, false);
-        if (ac && ac->parent == e) {
-            ac->parent = 0;
-            RENDERING(subE)->show = false;
-        }
-    }
-    */
+    layoutCache.erase(e);
     ComponentSystemImpl<TextComponent>::Delete(e);
 }
 
-static Entity createRenderingEntity() {
-    Entity e = theEntityManager.CreateEntity(HASH("__/text_letter", 0x1fca5927));
-    ADD_COMPONENT(e, Transformation);
-    ADD_COMPONENT(e, Rendering);
-    // ADD_COMPONENT(e, Anchor);
-    return e;
-}
-
 static void parseInlineImageString(const std::string& s, std::string* image, float* scale) {
     int idx0 = s.find(',');
     if (image)
@@ -604,6 +591,17 @@ static float computeStartX(float stringWidth, const TextComponent* trc) {
     return result;
 }
 
+static bool sameLayoutParameters(const TextSystem::TextLayout& layout, const TextComponent* trc, unsigned length, const TransformationComponent* trans) {
+    return layout.length == length &&
+        layout.fontName == trc->fontName &&
+        layout.charHeight == trc->charHeight &&
+        layout.flags == trc->flags &&
+        layout.size == trans->size &&
+        layout.positioning == trc->positioning &&
+        layout.maxLineToUse == trc->maxLineToUse &&
+        layout.text == trc->text;
+}
+
 TextSystem::~TextSystem() {
     for (auto & font : _instance->fontRegistry) {
         delete[] font.second.entries;
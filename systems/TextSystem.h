@@ -24,9 +24,15 @@
 #include "base/Color.h"
 
 #include "opengl/TextureLibrary.h"
+#include "util/CompiledAssets.h"
 
+#include <glm/glm.hpp>
+
+#include <map>
 #include <vector>
 
+struct TransformationComponent;
+
 struct TextComponent {
     const static float LEFT;
     const static float CENTER;
@@ -98,6 +104,10 @@ public:
 void Delete(Entity e) override;
 void registerFont(const char* name,
                   const std::map<uint32_t, float>& charH2Wratio);
+// 'glyphs' sorted by unicode, at least one
+void registerFont(const char* name,
+                  const CompiledFont::Glyph* glyphs,
+                  unsigned glyphCount);
 
 float computeTextComponentWidth(TextComponent* trc) const;
 
@@ -110,8 +120,34 @@ struct FontDesc {
     CharInfo* entries;
 };
 
+// A letter (or inline image), relative to its text entity
+struct GlyphLayout {
+    glm::vec2 position, size;
+    TextureRef texture; // InvalidTextureRef: hidden (space)
+    bool inlineImage;
+};
+
+// Layout of a text, reused until one of its parameters changes
+struct TextLayout {
+    TextLayout() : length(0), fontName(0), charHeight(0), flags(0),
+        size(0.0f), positioning(0), maxLineToUse(0) {}
+    std::string text;
+    unsigned length;
+    hash_t fontName;
+    float charHeight;
+    int flags;
+    glm::vec2 size;
+    float positioning;
+    int maxLineToUse;
+    std::vector<GlyphLayout> glyphs;
+};
+
 private:
-std::vector<Entity> renderingEntitiesPool;
+void layoutText(Entity entity, TextComponent* trc, unsigned length,
+                const FontDesc& fontDesc, const TransformationComponent* trans,
+                std::vector<GlyphLayout>& layout);
+
+std::map<Entity, TextLayout> layoutCache;
 std::map<hash_t, FontDesc> fontRegistry;
 }
 ;
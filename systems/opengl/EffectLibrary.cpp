@@ -27,9 +27,30 @@
 #include "shaders/empty_fs.h"
 #include "shaders/default_no_texture_fs.h"
 #include "shaders/default_vs.h"
+#include "shaders/default_instanced_vs.h"
 #define VERTEX_SHADER_ARRAY default_vs
 #define VERTEX_SHADER_SIZE default_vs_len
 
+#include "base/Profiler.h"
+#include "base/TimeUtil.h"
+#include "util/MurmurHash.h"
+
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <sstream>
+
+#if SAC_ANDROID || (SAC_DESKTOP && (SAC_LINUX || SAC_DARWIN))
+#include <sys/stat.h>
+#define PROGRAM_BINARY_SUPPORTED 1
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#endif
+
 GLuint EffectLibrary::compileShader(const std::string& LOG_USAGE_ONLY(ctx), GLuint type, const FileBuffer& fb) {
     LOGV(1, "Compiling " << ((type == GL_VERTEX_SHADER) ? "vertex" : "fragment") << " shader '" << ctx << "'");;
 
@@ -53,36 +74,267 @@ GLuint EffectLibrary::compileShader(const std::string& LOG_USAGE_ONLY(ctx), GLui
     return shader;
 }
 
-static Shader buildShaderFromFileBuffer(const char* vsName, const FileBuffer& fragmentFb) {
+#if PROGRAM_BINARY_SUPPORTED
+// Linked programs are cached in the writable data directory, when the
+// driver supports it (GL 4.1, ARB_get_program_binary or
+// OES_get_program_binary). Shaders are compiled otherwise.
+static struct {
+    bool initialized;
+    void (SAC_GL_APIENTRY *getProgramBinary)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    void (SAC_GL_APIENTRY *programBinary)(GLuint, GLenum, const void*, GLint);
+    // binaries are only valid for the driver which produced them
+    uint32_t driverHash;
+} programBinary;
+
+// Cache file content: header followed by the program binary
+struct ProgramBinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t driverHash;
+    uint32_t format;
+    uint32_t length;
+};
+// Cache file format version
+static const uint32_t ProgramBinaryVersion = 1;
+
+namespace ProgramBinaryStatus {
+    // Rejected: the program was modified by the failed load and must be
+    // recreated before compiling the shaders
+    enum Enum { Missing, Loaded, Rejected };
+}
+
+static void initProgramBinary() {
+    if (programBinary.initialized)
+        return;
+    programBinary.initialized = true;
+
+    typedef void (SAC_GL_APIENTRY *GetProc)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    typedef void (SAC_GL_APIENTRY *LoadProc)(GLuint, GLenum, const void*, GLint);
+#if SAC_DESKTOP
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+        programBinary.getProgramBinary = (GetProc)glGetProgramBinary;
+        programBinary.programBinary = (LoadProc)glProgramBinary;
+    }
+#else
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (extensions && strstr(extensions, "GL_OES_get_program_binary")) {
+        programBinary.getProgramBinary = (GetProc)eglGetProcAddress("glGetProgramBinaryOES");
+        programBinary.programBinary = (LoadProc)eglGetProcAddress("glProgramBinaryOES");
+    }
+#endif
+    GLint formats = 0;
+    if (programBinary.getProgramBinary && programBinary.programBinary) {
+        GL_OPERATION(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats))
+    }
+    if (formats <= 0) {
+        LOGI("Program binaries not supported: shaders will always be compiled");
+        programBinary.getProgramBinary = 0;
+        programBinary.programBinary = 0;
+        return;
+    }
+
+    std::stringstream driver;
+    driver << glGetString(GL_VENDOR) << '/' << glGetString(GL_RENDERER) << '/' << glGetString(GL_VERSION);
+    programBinary.driverHash = Murmur::RuntimeHash(driver.str().c_str(), driver.str().size());
+    LOGI("Program binaries cache enabled for '" << driver.str() << "'");
+}
+
+static std::string programBinaryDirectory(AssetAPI* assetAPI) {
+    return assetAPI->getWritableAppDatasPath() + "/shader_cache";
+}
+
+static std::string programBinaryPath(AssetAPI* assetAPI, uint32_t sourceHash) {
+    std::stringstream ss;
+    ss << programBinaryDirectory(assetAPI) << '/' << std::hex << sourceHash << ".bin";
+    return ss.str();
+}
+
+static ProgramBinaryStatus::Enum loadProgramBinary(AssetAPI* assetAPI, uint32_t sourceHash, GLuint program) {
+    const std::string path = programBinaryPath(assetAPI, sourceHash);
+    if (!assetAPI->doesExistFileOrDirectory(path))
+        return ProgramBinaryStatus::Missing;
+    FileBuffer fb = assetAPI->loadFile(path);
+    if (!fb.data)
+        return ProgramBinaryStatus::Missing;
+
+    ProgramBinaryHeader header;
+    bool valid = fb.size >= (int)sizeof(header);
+    if (valid) {
+        memcpy(&header, fb.data, sizeof(header));
+        valid = !memcmp(header.magic, "SACP", 4) &&
+            header.version == ProgramBinaryVersion &&
+            header.driverHash == programBinary.driverHash &&
+            header.length == fb.size - sizeof(header);
+    }
+    if (!valid) {
+        delete[] fb.data;
+        return ProgramBinaryStatus::Missing;
+    }
+    GL_OPERATION(programBinary.programBinary(program, header.format, fb.data + sizeof(header), header.length))
+    delete[] fb.data;
+    GLint status = 0;
+    GL_OPERATION(glGetProgramiv(program, GL_LINK_STATUS, &status))
+    if (status != GL_TRUE) {
+        LOGW("Cached program binary '" << path << "' rejected by the driver");
+        return ProgramBinaryStatus::Rejected;
+    }
+    return ProgramBinaryStatus::Loaded;
+}
+
+static void setRetrievableHint(GLuint program) {
+#if SAC_DESKTOP
+    GL_OPERATION(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE))
+#else
+    (void) program;
+#endif
+}
+
+static void saveProgramBinary(AssetAPI* assetAPI, uint32_t sourceHash, GLuint program) {
+    GLint length = 0;
+    GL_OPERATION(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length))
+    if (length <= 0)
+        return;
+
+    ProgramBinaryHeader header;
+    std::vector<uint8_t> content(sizeof(header) + length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    GL_OPERATION(programBinary.getProgramBinary(program, length, &written, &format, &content[sizeof(header)]))
+    if (written <= 0)
+        return;
+
+    memcpy(header.magic, "SACP", 4);
+    header.version = ProgramBinaryVersion;
+    header.driverHash = programBinary.driverHash;
+    header.format = format;
+    header.length = written;
+    memcpy(&content[0], &header, sizeof(header));
+
+    const std::string directory = programBinaryDirectory(assetAPI);
+    if (!assetAPI->doesExistFileOrDirectory(directory))
+        assetAPI->createDirectory(directory, S_IRWXU);
+    const std::string path = programBinaryPath(assetAPI, sourceHash);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file || fwrite(&content[0], sizeof(header) + written, 1, file) != 1) {
+        LOGW("Unable to write program binary '" << path << "'");
+    }
+    if (file)
+        fclose(file);
+}
+#endif
+
+struct AttribBinding {
+    GLuint location;
+    const char* name;
+};
+static const AttribBinding DefaultAttribs[] = {
+    { EffectLibrary::ATTRIB_VERTEX, "aPosition" },
+    { EffectLibrary::ATTRIB_UV, "aTexCoord" },
+};
+static const AttribBinding InstancedAttribs[] = {
+    { EffectLibrary::ATTRIB_VERTEX, "aPosition" },
+    { EffectLibrary::ATTRIB_INSTANCE_POSITION, "aInstancePosition" },
+    { EffectLibrary::ATTRIB_INSTANCE_TRANSFORM, "aInstanceTransform" },
+    { EffectLibrary::ATTRIB_INSTANCE_UV, "aInstanceUV" },
+    { EffectLibrary::ATTRIB_INSTANCE_COLOR, "aInstanceColor" },
+};
+
+static Shader buildShaderFromFileBuffer(AssetAPI* assetAPI, const char* vsName, const char* fsName, const FileBuffer& fragmentFb, bool instanced = false) {
     Shader out;
     LOGV(1, "building shader ...");;
+    PROFILE("Shader", std::string("build-") + fsName, BeginEvent);
+    LOG_USAGE_ONLY(const float start = TimeUtil::GetTime();)
     out.program = glCreateProgram();
     check_GL_errors("glCreateProgram");
 
     FileBuffer vertexFb;
-    vertexFb.data = VERTEX_SHADER_ARRAY;
-    vertexFb.size = VERTEX_SHADER_SIZE;
-    GLuint vs = EffectLibrary::compileShader(vsName, GL_VERTEX_SHADER, vertexFb);
+    if (instanced) {
+        vertexFb.data = default_instanced_vs;
+        vertexFb.size = default_instanced_vs_len;
+    } else {
+        vertexFb.data = VERTEX_SHADER_ARRAY;
+        vertexFb.size = VERTEX_SHADER_SIZE;
+    }
 
-    GLuint fs = EffectLibrary::compileShader("unknown.fs", GL_FRAGMENT_SHADER, fragmentFb);
+    // color is read from a varying instead of an uniform
+    static const char define[] = "#define SAC_INSTANCED 1\n";
+    std::vector<uint8_t> fragmentSource;
+    if (instanced) {
+        fragmentSource.resize(sizeof(define) - 1 + fragmentFb.size);
+        memcpy(&fragmentSource[0], define, sizeof(define) - 1);
+    } else {
+        fragmentSource.resize(fragmentFb.size);
+    }
+    memcpy(&fragmentSource[fragmentSource.size() - fragmentFb.size], fragmentFb.data, fragmentFb.size);
 
-    GL_OPERATION(glAttachShader(out.program, vs))
-    GL_OPERATION(glAttachShader(out.program, fs))
-    LOGV(2, "Binding GLSL attribs");
-    GL_OPERATION(glBindAttribLocation(out.program, EffectLibrary::ATTRIB_VERTEX, "aPosition"))
-    GL_OPERATION(glBindAttribLocation(out.program, EffectLibrary::ATTRIB_UV, "aTexCoord"))
+    const AttribBinding* attribs = instanced ? InstancedAttribs : DefaultAttribs;
+    const int attribCount = instanced ?
+        sizeof(InstancedAttribs) / sizeof(InstancedAttribs[0]) :
+        sizeof(DefaultAttribs) / sizeof(DefaultAttribs[0]);
 
-    LOGV(2, "Linking GLSL program");
-    GL_OPERATION(glLinkProgram(out.program))
+    bool fromCache = false;
+#if !PROGRAM_BINARY_SUPPORTED
+    (void) assetAPI;
+#else
+    initProgramBinary();
+    uint32_t sourceHash = 0;
+    if (programBinary.programBinary) {
+        // attribute bindings are part of the linked program
+        std::vector<uint8_t> sources(vertexFb.data, vertexFb.data + vertexFb.size);
+        sources.insert(sources.end(), fragmentSource.begin(), fragmentSource.end());
+        for (int i=0; i<attribCount; i++) {
+            sources.push_back((uint8_t)attribs[i].location);
+            sources.insert(sources.end(), attribs[i].name, attribs[i].name + strlen(attribs[i].name) + 1);
+        }
+        sourceHash = Murmur::RuntimeHash(&sources[0], sources.size());
 
-    GLint logLength;
-    glGetProgramiv(out.program, GL_INFO_LOG_LENGTH, &logLength);
-    if (logLength > 1) {
-        char *log = new char[logLength];
-        glGetProgramInfoLog(out.program, logLength, &logLength, log);
-        LOGW("GL shader (vs='" << vsName << "' program error: '" << log << "'");
+        setRetrievableHint(out.program);
+        const ProgramBinaryStatus::Enum status = loadProgramBinary(assetAPI, sourceHash, out.program);
+        fromCache = (status == ProgramBinaryStatus::Loaded);
+        if (status == ProgramBinaryStatus::Rejected) {
+            // start again from a clean program
+            GL_OPERATION(glDeleteProgram(out.program))
+            out.program = glCreateProgram();
+            setRetrievableHint(out.program);
+        }
+    }
+#endif
 
-        delete[] log;
+    if (!fromCache) {
+        GLuint vs = EffectLibrary::compileShader(vsName, GL_VERTEX_SHADER, vertexFb);
+
+        FileBuffer fb;
+        fb.data = &fragmentSource[0];
+        fb.size = fragmentSource.size();
+        GLuint fs = EffectLibrary::compileShader(fsName, GL_FRAGMENT_SHADER, fb);
+
+        GL_OPERATION(glAttachShader(out.program, vs))
+        GL_OPERATION(glAttachShader(out.program, fs))
+        LOGV(2, "Binding GLSL attribs");
+        for (int i=0; i<attribCount; i++) {
+            GL_OPERATION(glBindAttribLocation(out.program, attribs[i].location, attribs[i].name))
+        }
+
+        LOGV(2, "Linking GLSL program");
+        GL_OPERATION(glLinkProgram(out.program))
+
+        GLint logLength;
+        glGetProgramiv(out.program, GL_INFO_LOG_LENGTH, &logLength);
+        if (logLength > 1) {
+            char *log = new char[logLength];
+            glGetProgramInfoLog(out.program, logLength, &logLength, log);
+            LOGW("GL shader (vs='" << vsName << "' program error: '" << log << "'");
+
+            delete[] log;
+        }
+
+        glDeleteShader(vs);
+        glDeleteShader(fs);
+
+#if PROGRAM_BINARY_SUPPORTED
+        if (programBinary.getProgramBinary)
+            saveProgramBinary(assetAPI, sourceHash, out.program);
+#endif
     }
 
     out.uniformMatrix = glGetUniformLocation(out.program, "uMvp");
@@ -90,16 +342,16 @@ static Shader buildShaderFromFileBuffer(const char* vsName, const FileBuffer& fr
     out.uniformAlphaSampler = glGetUniformLocation(out.program, "tex1");
     out.uniformColor= glGetUniformLocation(out.program, "vColor");
 
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-
+    LOGI("Shader '" << vsName << '/' << fsName << "' ready in " << 1000 * (TimeUtil::GetTime() - start)
+        << " ms" << (fromCache ? " (cached binary)" : ""));
+    PROFILE("Shader", std::string("build-") + fsName, EndEvent);
     return out;
 }
 
 static Shader buildShaderFromAsset(AssetAPI* assetAPI, const char* vsName, const char* fsName) {
     LOGI("Compiling shaders: " << vsName << '/' << fsName);
     FileBuffer fragmentFb = assetAPI->loadAsset(fsName);
-    Shader shader = buildShaderFromFileBuffer(vsName, fragmentFb);
+    Shader shader = buildShaderFromFileBuffer(assetAPI, vsName, fsName, fragmentFb);
     delete[] fragmentFb.data;
     return shader;
 }
@@ -131,12 +383,21 @@ bool EffectLibrary::doLoad(const char* assetName, Shader& out, const EffectRef&
     } else {
         const FileBuffer& fb = it->second;
         LOGV(1, "loadShader: '" << assetName << "' from InMemoryShader (" << fb.size << ')');
-        out = buildShaderFromFileBuffer("default.vs", fb);
+        out = buildShaderFromFileBuffer(assetAPI, "default.vs", assetName, fb);
     }
 
     return true;
 }
 
+bool EffectLibrary::buildInstancedVariant(const EffectRef& ref, Shader& out) {
+    std::map<EffectRef, FileBuffer>::iterator it = dataSource.find(ref);
+    if (it == dataSource.end())
+        return false;
+    LOGV(1, "build instanced variant of '" << ref2Name(ref) << "'");
+    out = buildShaderFromFileBuffer(assetAPI, "default_instanced.vs", "instanced variant", it->second, true);
+    return true;
+}
+
 void EffectLibrary::doUnload(const Shader&) {
     LOGT("Effect unloading");
 }
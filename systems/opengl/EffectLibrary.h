@@ -56,5 +56,20 @@ class EffectLibrary : public NamedAssetLibrary<Shader, EffectRef, FileBuffer> {
                                 GLuint type,
                                 const FileBuffer& fb);
 
-    enum { ATTRIB_VERTEX = 0, ATTRIB_UV, ATTRIB_SCALE, NUM_ATTRIBS };
+    // Build the instanced quads variant of an in-memory effect: vertex
+    // shader is default_instanced.vs and the fragment shader is compiled
+    // with SAC_INSTANCED defined (color becomes a varying).
+    // Returns false for effects loaded from asset files.
+    bool buildInstancedVariant(const EffectRef& ref, Shader& out);
+
+    enum {
+        ATTRIB_VERTEX = 0,
+        ATTRIB_UV,
+        ATTRIB_SCALE,
+        ATTRIB_INSTANCE_POSITION,
+        ATTRIB_INSTANCE_TRANSFORM,
+        ATTRIB_INSTANCE_UV,
+        ATTRIB_INSTANCE_COLOR,
+        NUM_ATTRIBS
+    };
 };
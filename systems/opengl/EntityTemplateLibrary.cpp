@@ -43,6 +43,9 @@ EntityTemplateLibrary::~EntityTemplateLibrary() {
         }
     }
     assets.clear();
+    for (auto& it: prefetched) {
+        delete[] it.second.data;
+    }
 }
 
 void EntityTemplateLibrary::registerDataSource(EntityTemplateRef ref, FileBuffer fb) {
@@ -53,6 +56,17 @@ bool EntityTemplateLibrary::isRegisteredDataSource(EntityTemplateRef ref) {
     return NamedAssetLibrary::isRegisteredDataSource(ref);
 }
 
+void EntityTemplateLibrary::addPrefetchedFile(const std::string& name, FileBuffer fb) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = prefetched.find(name2ref(name));
+    if (it != prefetched.end()) {
+        delete[] it->second.data;
+        it->second = fb;
+    } else {
+        prefetched.insert(std::make_pair(name2ref(name), fb));
+    }
+}
+
 void EntityTemplateLibrary::unregisterDataSource(EntityTemplateRef ) {
     LOGT("Pfff");
     #if 0
@@ -102,7 +116,12 @@ bool EntityTemplateLibrary::doLoad(const char* name, EntityTemplate& out, const
     char* filename = (char*)alloca(l);
     asset2File(name, filename, l);
 
-    if (it == dataSource.end()) {
+    auto pt = prefetched.find(r);
+    if (it == dataSource.end() && pt != prefetched.end()) {
+        LOGV(1, "loadEntityTemplate: '" << name << "' from prefetched file");
+        fb = pt->second;
+        prefetched.erase(pt);
+    } else if (it == dataSource.end()) {
         LOGV(1, "loadEntityTemplate: '" << name << "' from file");
         fb = assetAPI->loadAsset(filename);
         if (!fb.size) {
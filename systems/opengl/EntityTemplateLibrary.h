@@ -66,6 +66,10 @@ class EntityTemplateLibrary
     bool isRegisteredDataSource(EntityTemplateRef r);
     void unregisterDataSource(EntityTemplateRef r);
 
+    // File content read ahead of time (e.g. by startup workers): next load
+    // of 'name' parses it instead of reading the file again. Takes ownership.
+    void addPrefetchedFile(const std::string& name, FileBuffer fb);
+
     ~EntityTemplateLibrary();
 
     const char* asset2FilePrefix() const;
@@ -81,6 +85,7 @@ class EntityTemplateLibrary
     bool reloading;
 #endif
     std::map<EntityTemplateRef, EntityTemplateRef> template2parent;
+    std::map<EntityTemplateRef, FileBuffer> prefetched;
     LocalizeAPI* localizeAPI;
 
     void applyTemplateToAll(const EntityTemplateRef& ref);
@@ -1,10 +1,22 @@
 #include "GLState.h"
 
+#include <cstring>
+
 #if SAC_INGAME_EDITORS
 #include "../RenderingSystem.h"
 #include "util/LevelEditor.h"
 #endif
 
+unsigned GLState::skippedCalls = 0;
+unsigned GLState::issuedCalls = 0;
+
+#define SKIP_IF_CLEAN(cond) \
+    if (!(cond) && option != GLUpdateOption::Forced) { \
+        skippedCalls++; \
+        return; \
+    } \
+    issuedCalls++;
+
 GLState::GLState() {
     viewport.w = 0;
     viewport.h = 0;
@@ -12,8 +24,24 @@ GLState::GLState() {
     flags.current = 0;
 }
 
+void GLState::invalidate() {
+    depthTest.known = false;
+    blendFunc.src = blendFunc.dst = GL_NONE;
+    framebuffer.known = false;
+    program.current = 0;
+    textures.invalidate();
+    buffers.array = buffers.element = ~0u;
+    vertexAttribs.invalidate();
+}
+
+void GLState::invalidateAll() {
+    invalidate();
+    uniforms.perProgram.clear();
+}
+
 void GLState::Viewport::update(int _w, int _h, GLUpdateOption::Enum option) {
     if (_w != w || _h != h || option == GLUpdateOption::Forced) {
+        issuedCalls++;
         w = _w;
         h = _h;
 #if SAC_INGAME_EDITORS
@@ -21,14 +49,15 @@ void GLState::Viewport::update(int _w, int _h, GLUpdateOption::Enum option) {
 #else
         GL_OPERATION(glViewport(0, 0, w, h))
 #endif
+    } else {
+        skippedCalls++;
     }
 }
 
 void GLState::Clear::update(const Color& _color, GLUpdateOption::Enum option) {
-    if (_color != color || option == GLUpdateOption::Forced) {
-        color = _color;
-        GL_OPERATION(glClearColor(color.r, color.g, color.b, color.a))
-    }
+    SKIP_IF_CLEAN(_color != color)
+    color = _color;
+    GL_OPERATION(glClearColor(color.r, color.g, color.b, color.a))
 }
 
 uint32_t GLState::Flags::update(uint32_t bits, GLUpdateOption::Enum option) {
@@ -36,6 +65,11 @@ uint32_t GLState::Flags::update(uint32_t bits, GLUpdateOption::Enum option) {
     if (option == GLUpdateOption::Forced) {
         bitsChanged = ~0;
     }
+    if (bitsChanged) {
+        issuedCalls++;
+    } else {
+        skippedCalls++;
+    }
 
     if (bitsChanged & EnableZWriteBit ) {
         GL_OPERATION(glDepthMask(bits & EnableZWriteBit))
@@ -62,3 +96,145 @@ uint32_t GLState::Flags::update(uint32_t bits, GLUpdateOption::Enum option) {
     current = bits;
     return bitsChanged;
 }
+
+void GLState::DepthTest::update(bool enable, GLUpdateOption::Enum option) {
+    SKIP_IF_CLEAN(!known || enable != enabled)
+    known = true;
+    enabled = enable;
+    if (enabled) {
+        GL_OPERATION(glEnable(GL_DEPTH_TEST))
+    } else {
+        GL_OPERATION(glDisable(GL_DEPTH_TEST))
+    }
+}
+
+void GLState::BlendFunc::update(GLenum _src, GLenum _dst, GLUpdateOption::Enum option) {
+    SKIP_IF_CLEAN(_src != src || _dst != dst)
+    src = _src;
+    dst = _dst;
+    GL_OPERATION(glBlendFunc(src, dst))
+}
+
+void GLState::Framebuffer::update(GLuint fbo, GLUpdateOption::Enum option) {
+    SKIP_IF_CLEAN(!known || fbo != current)
+    known = true;
+    current = fbo;
+    GL_OPERATION(glBindFramebuffer(GL_FRAMEBUFFER, current))
+}
+
+bool GLState::Program::update(GLuint p, GLUpdateOption::Enum option) {
+    if (p == current && option != GLUpdateOption::Forced) {
+        skippedCalls++;
+        return false;
+    }
+    issuedCalls++;
+    current = p;
+    GL_OPERATION(glUseProgram(current))
+    return true;
+}
+
+GLState::Uniforms::Value* GLState::Uniforms::find(GLuint program, GLint location, bool* created) {
+    std::vector<Value>& values = perProgram[program];
+    // programs only have a handful of uniforms: linear search is fine
+    for (auto& v: values) {
+        if (v.location == location) {
+            *created = false;
+            return &v;
+        }
+    }
+    Value v;
+    v.location = location;
+    values.push_back(v);
+    *created = true;
+    return &values.back();
+}
+
+void GLState::Uniforms::matrix4(GLuint program, GLint location, const float* m, GLUpdateOption::Enum option) {
+    bool created;
+    Value* v = find(program, location, &created);
+    SKIP_IF_CLEAN(created || memcmp(v->v, m, 16 * sizeof(float)))
+    memcpy(v->v, m, 16 * sizeof(float));
+    GL_OPERATION(glUniformMatrix4fv(location, 1, GL_FALSE, m))
+}
+
+void GLState::Uniforms::vec4(GLuint program, GLint location, const float* f, GLUpdateOption::Enum option) {
+    bool created;
+    Value* v = find(program, location, &created);
+    SKIP_IF_CLEAN(created || memcmp(v->v, f, 4 * sizeof(float)))
+    memcpy(v->v, f, 4 * sizeof(float));
+    GL_OPERATION(glUniform4fv(location, 1, f))
+}
+
+void GLState::Uniforms::sampler(GLuint program, GLint location, int unit, GLUpdateOption::Enum option) {
+    bool created;
+    Value* v = find(program, location, &created);
+    const float u = unit;
+    SKIP_IF_CLEAN(created || v->v[0] != u)
+    v->v[0] = u;
+    GL_OPERATION(glUniform1i(location, unit))
+}
+
+GLState::Textures::Textures() {
+    invalidate();
+}
+
+void GLState::Textures::invalidate() {
+    activeUnit = -1;
+    for (int i=0; i<GLSTATE_TEXTURE_UNITS; i++)
+        bound[i] = ~0u;
+}
+
+void GLState::Textures::bind(int unit, GLuint texture, GLUpdateOption::Enum option) {
+    SKIP_IF_CLEAN(bound[unit] != texture)
+    if (activeUnit != unit) {
+        activeUnit = unit;
+        GL_OPERATION(glActiveTexture(GL_TEXTURE0 + unit))
+    }
+    bound[unit] = texture;
+    GL_OPERATION(glBindTexture(GL_TEXTURE_2D, texture))
+}
+
+void GLState::BufferBindings::bind(GLenum target, GLuint buffer, GLUpdateOption::Enum option) {
+    GLuint& current = (target == GL_ARRAY_BUFFER) ? array : element;
+    SKIP_IF_CLEAN(current != buffer)
+    current = buffer;
+    GL_OPERATION(glBindBuffer(target, buffer))
+}
+
+GLState::VertexAttribs::VertexAttribs() {
+    invalidate();
+}
+
+void GLState::VertexAttribs::invalidate() {
+    for (int i=0; i<GLSTATE_VERTEX_ATTRIBS; i++) {
+        attribs[i].known = attribs[i].enableKnown = attribs[i].enabled = false;
+    }
+}
+
+void GLState::VertexAttribs::pointer(GLuint index, GLuint arrayBuffer, GLint size, GLsizei stride, size_t offset, GLenum type, GLboolean normalized, GLUpdateOption::Enum option) {
+    Attrib& a = attribs[index];
+    if (!a.enableKnown || !a.enabled || option == GLUpdateOption::Forced) {
+        issuedCalls++;
+        a.enableKnown = a.enabled = true;
+        GL_OPERATION(glEnableVertexAttribArray(index))
+    } else {
+        skippedCalls++;
+    }
+    SKIP_IF_CLEAN(!a.known || a.buffer != arrayBuffer || a.size != size || a.type != type || a.normalized != normalized || a.stride != stride || a.offset != offset)
+    a.known = true;
+    a.buffer = arrayBuffer;
+    a.size = size;
+    a.type = type;
+    a.normalized = normalized;
+    a.stride = stride;
+    a.offset = offset;
+    GL_OPERATION(glVertexAttribPointer(index, size, type, normalized, stride, (void*)offset))
+}
+
+void GLState::VertexAttribs::disable(GLuint index, GLUpdateOption::Enum option) {
+    Attrib& a = attribs[index];
+    SKIP_IF_CLEAN(!a.enableKnown || a.enabled)
+    a.enableKnown = true;
+    a.enabled = false;
+    GL_OPERATION(glDisableVertexAttribArray(index))
+}
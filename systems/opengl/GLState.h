@@ -1,5 +1,8 @@
 #pragma once
 
+#include <vector>
+#include <map>
+
 #include "OpenglHelper.h"
 #include "../../base/Color.h"
 
@@ -18,9 +21,26 @@ namespace GLUpdateOption {
     enum Enum { IfDirty, Forced };
 }
 
+#define GLSTATE_TEXTURE_UNITS 2
+#define GLSTATE_VERTEX_ATTRIBS 8
+
+// Shadow copy of the GL state, used to filter out redundant GL calls.
+// Every state change done by the renderer during a frame must go through it.
 struct GLState {
     GLState();
 
+    // Forget everything we know about the GL state, except uniform values
+    // (only modified through this cache). Must be called when other code
+    // may have changed GL state behind our back (ie: at frame start).
+    void invalidate();
+    // Same as invalidate() but also drop uniform values (context loss,
+    // program reload...)
+    void invalidateAll();
+
+    // number of GL calls filtered / issued since last resetCounters()
+    static unsigned skippedCalls, issuedCalls;
+    static void resetCounters() { skippedCalls = issuedCalls = 0; }
+
     struct Viewport {
         Viewport() : w(0), h(0) {}
         int w, h;
@@ -44,4 +64,114 @@ struct GLState {
         uint32_t update(uint32_t bits,
                         GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
     } flags;
+
+    struct DepthTest {
+        DepthTest() : known(false), enabled(false) {}
+        bool known, enabled;
+
+        void update(bool enable,
+                    GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+    } depthTest;
+
+    struct BlendFunc {
+        BlendFunc() : src(GL_NONE), dst(GL_NONE) {}
+        GLenum src, dst;
+
+        void update(GLenum src,
+                    GLenum dst,
+                    GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+    } blendFunc;
+
+    struct Framebuffer {
+        Framebuffer() : known(false), current(0) {}
+        bool known;
+        GLuint current;
+
+        void update(GLuint fbo,
+                    GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+    } framebuffer;
+
+    struct Program {
+        Program() : current(0) {}
+        GLuint current;
+
+        // returns true if program actually changed
+        bool update(GLuint program,
+                    GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+    } program;
+
+    // Uniform values, per program (uniforms are program state in GL).
+    // Apply to the program last set through 'program'.
+    struct Uniforms {
+        struct Value {
+            GLint location;
+            float v[16];
+        };
+        std::map<GLuint, std::vector<Value>> perProgram;
+
+        void matrix4(GLuint program,
+                     GLint location,
+                     const float* m,
+                     GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+        void vec4(GLuint program,
+                  GLint location,
+                  const float* v,
+                  GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+        void sampler(GLuint program,
+                     GLint location,
+                     int unit,
+                     GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+
+        private:
+        Value* find(GLuint program, GLint location, bool* created);
+    } uniforms;
+
+    struct Textures {
+        Textures();
+        // active unit index (-1 = unknown)
+        int activeUnit;
+        // texture bound to GL_TEXTURE_2D, per unit (~0 = unknown)
+        GLuint bound[GLSTATE_TEXTURE_UNITS];
+
+        void bind(int unit,
+                  GLuint texture,
+                  GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+        void invalidate();
+    } textures;
+
+    struct BufferBindings {
+        BufferBindings() : array(~0u), element(~0u) {}
+        GLuint array, element;
+
+        void bind(GLenum target,
+                  GLuint buffer,
+                  GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+    } buffers;
+
+    // Vertex attrib pointers (they capture the GL_ARRAY_BUFFER bound when
+    // set, so 'buffers.array' is part of their identity)
+    struct VertexAttribs {
+        struct Attrib {
+            bool known, enableKnown, enabled;
+            GLuint buffer;
+            GLint size;
+            GLenum type;
+            GLboolean normalized;
+            GLsizei stride;
+            size_t offset;
+        } attribs[GLSTATE_VERTEX_ATTRIBS];
+
+        VertexAttribs();
+        void pointer(GLuint index,
+                     GLuint arrayBuffer,
+                     GLint size,
+                     GLsizei stride,
+                     size_t offset,
+                     GLenum type = GL_FLOAT,
+                     GLboolean normalized = GL_FALSE,
+                     GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+        void disable(GLuint index,
+                     GLUpdateOption::Enum option = GLUpdateOption::IfDirty);
+        void invalidate();
+    } vertexAttribs;
 };
@@ -36,6 +36,18 @@
 
 #include "OpenglHelper.h"
 
+#if SAC_DESKTOP && (SAC_LINUX || SAC_DARWIN)
+#include "util/MurmurHash.h"
+#include <sstream>
+#include <thread>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define DECODED_CACHE_SUPPORTED 1
+#endif
+
 #define ALPHA_MASK_TAG "_alpha"
 
 DPI::Enum OpenGLTextureCreator::dpi = DPI::High;
@@ -89,6 +101,101 @@ void OpenGLTextureCreator::forceEtc1Usage() {
     LOGW("ETC1 texture usage forced");
     pvrFormatSupported = s3tcFormatSupported = false;
 }
+
+static bool decodedCacheEnabled = false;
+
+void OpenGLTextureCreator::enableDecodedCache() {
+#if DECODED_CACHE_SUPPORTED
+    LOGI("Decoded ETC1 textures cache enabled");
+    decodedCacheEnabled = true;
+#else
+    LOGW("Decoded textures cache not supported on this platform");
+#endif
+}
+#endif
+
+#if DECODED_CACHE_SUPPORTED
+// Cache file content: header followed by the RGBA pixels
+struct DecodedCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width, height, channels;
+};
+static const uint32_t DecodedCacheVersion = 1;
+
+static std::string decodedCacheDirectory(AssetAPI* assetAPI) {
+    return assetAPI->getWritableAppDatasPath() + "/decoded_textures";
+}
+
+// Key is the compressed file content
+static std::string decodedCachePath(AssetAPI* assetAPI, const FileBuffer& file) {
+    std::stringstream ss;
+    ss << decodedCacheDirectory(assetAPI) << '/' << std::hex
+        << Murmur::RuntimeHash(file.data, file.size) << std::dec << '_' << file.size << ".rgba";
+    return ss.str();
+}
+
+static bool readDecodedCache(const std::string& path, ImageDesc& out) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    bool valid = false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(DecodedCacheHeader)) {
+        void* mapping = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            const DecodedCacheHeader* header = (const DecodedCacheHeader*) mapping;
+            const size_t pixelsSize = (size_t)header->width * header->height * header->channels;
+            valid = !memcmp(header->magic, "SACD", 4) &&
+                header->version == DecodedCacheVersion &&
+                (size_t)st.st_size == sizeof(DecodedCacheHeader) + pixelsSize;
+            if (valid) {
+                out.width = header->width;
+                out.height = header->height;
+                out.channels = header->channels;
+                out.mipmap = 0;
+                out.type = ImageDesc::RAW;
+                out.datas = new char[pixelsSize];
+                memcpy(out.datas, (const char*)mapping + sizeof(DecodedCacheHeader), pixelsSize);
+            }
+            munmap(mapping, st.st_size);
+        }
+    }
+    close(fd);
+    LOGW_IF(!valid, "Ignoring invalid decoded texture cache file '" << path << "'");
+    return valid;
+}
+
+static void writeDecodedCache(AssetAPI* assetAPI, const std::string& path, const ImageDesc& image) {
+    const std::string directory = decodedCacheDirectory(assetAPI);
+    if (!assetAPI->doesExistFileOrDirectory(directory))
+        assetAPI->createDirectory(directory, S_IRWXU);
+
+    DecodedCacheHeader header;
+    memcpy(header.magic, "SACD", 4);
+    header.version = DecodedCacheVersion;
+    header.width = image.width;
+    header.height = image.height;
+    header.channels = image.channels;
+
+    // write to a temporary file first: other threads may read the cache
+    std::stringstream tmp;
+    tmp << path << '.' << std::this_thread::get_id();
+    FILE* file = fopen(tmp.str().c_str(), "wb");
+    if (!file) {
+        LOGW("Unable to write decoded texture cache file '" << tmp.str() << "'");
+        return;
+    }
+    const size_t pixelsSize = (size_t)image.width * image.height * image.channels;
+    const bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(image.datas, pixelsSize, 1, file) == 1;
+    fclose(file);
+    if (!ok || rename(tmp.str().c_str(), path.c_str()) != 0) {
+        LOGW("Unable to write decoded texture cache file '" << path << "'");
+        remove(tmp.str().c_str());
+    }
+}
 #endif
 
 static GLenum channelCountToGLFormat(int channelCount) {
@@ -155,42 +262,74 @@ GLuint OpenGLTextureCreator::create(const glm::vec2& size, int channels, void* i
     return result;
 }
 
-InternalTexture OpenGLTextureCreator::loadFromFile(AssetAPI* assetAPI, const std::string& name, glm::vec2& outSize) {
-    InternalTexture result;
-    result.color = result.alpha = 0;
-    int imgChannelCount = 0;
-    result.color = loadSplittedFromFile(assetAPI, name, COLOR, outSize, imgChannelCount);
-    result.alpha = loadSplittedFromFile(assetAPI, name + "_alpha", ALPHA_MASK, outSize, imgChannelCount);
+InternalTexture OpenGLTextureCreator::loadFromFile(AssetAPI* assetAPI, const std::string& name, glm::vec2& outSize, unsigned& outMemorySize) {
+    ImageDesc color = decodeFile(assetAPI, name, COLOR);
+    ImageDesc alpha = decodeFile(assetAPI, name + "_alpha", ALPHA_MASK);
+
+    InternalTexture result = upload(color, alpha, name, outSize, outMemorySize);
 
+    delete[] color.datas;
+    delete[] alpha.datas;
     return result;
 }
-GLuint OpenGLTextureCreator::loadSplittedFromFile(AssetAPI* assetAPI, const std::string& name, Type type, glm::vec2& outSize, int& imgChannelCount) {
-    // Read file content
-    FileBuffer file;
-    bool png = false;
 
+ImageDesc OpenGLTextureCreator::decodeFile(AssetAPI* assetAPI, const std::string& name, Type type) {
+    bool png;
+    const FileBuffer file = readFile(assetAPI, name, png);
+    return decodeBuffer(assetAPI, name, file, png, type);
+}
+
+FileBuffer OpenGLTextureCreator::readFile(AssetAPI* assetAPI, const std::string& name, bool& png) {
     // First, try PVR compression, then PKM (ETC1)
     const char* extension = DefaultFileExtension();
     LOGV(1, "Loading " << name << extension);
-    file = assetAPI->loadAsset(name + extension);
+    FileBuffer file = assetAPI->loadAsset(name + extension);
+    png = false;
 
     if (!file.data) {
         LOGV(1, "Using PNG version - " << name);
         file = assetAPI->loadAsset(name + ".png");
-        if (!file.data) {
-            LOGE("Image not found '" << name << ".png'");
-            return 0;
-        }
         png = true;
     }
+    return file;
+}
+
+ImageDesc OpenGLTextureCreator::decodeBuffer(AssetAPI* assetAPI, const std::string& name, FileBuffer file, bool png, Type type) {
+    if (!file.data) {
+        LOGE("Image not found '" << name << ".png'");
+        ImageDesc missing;
+        missing.datas = 0;
+        return missing;
+    }
+#if !DECODED_CACHE_SUPPORTED
+    (void) assetAPI;
+#endif
+
+#if DECODED_CACHE_SUPPORTED
+    // ETC1 software decoding is slow: reuse a previous result if possible
+    std::string cachePath;
+    if (decodedCacheEnabled && !png && !pvrFormatSupported && !s3tcFormatSupported && !pkmFormatSupported) {
+        cachePath = decodedCachePath(assetAPI, file);
+        ImageDesc cached;
+        if (readDecodedCache(cachePath, cached)) {
+            LOGV(1, "Using decoded texture cache for '" << name << "'");
+            free(file.data);
+            return cached;
+        }
+    }
+#endif
 
     // Parse image
     ImageDesc image = parseImageContent(name, file, png);
     free(file.data);
     if (!image.datas) {
         LOGE("Could not read image, aborting");
-        return 0;
+        return image;
     }
+#if DECODED_CACHE_SUPPORTED
+    if (!cachePath.empty())
+        writeDecodedCache(assetAPI, cachePath, image);
+#endif
     #if SAC_EMSCRIPTEN
     LOGT("Remove this non-sense");
     if (type == ALPHA_MASK && image.channels==4) {
@@ -201,13 +340,25 @@ GLuint OpenGLTextureCreator::loadSplittedFromFile(AssetAPI* assetAPI, const std:
             }
         }
     }
+    #else
+    (void) type;
     #endif
-    imgChannelCount = image.channels;
-
-    GLuint result = loadFromImageDesc(image, name, type, outSize);
+    return image;
+}
 
-    delete[] image.datas;
+InternalTexture OpenGLTextureCreator::upload(const ImageDesc& color, const ImageDesc& alpha, const std::string& name, glm::vec2& outSize, unsigned& outMemorySize) {
+    InternalTexture result;
+    result.color = result.alpha = 0;
+    outMemorySize = 0;
 
+    if (color.datas) {
+        result.color = loadFromImageDesc(color, name, COLOR, outSize);
+        outMemorySize += memorySize(color);
+    }
+    if (alpha.datas) {
+        result.alpha = loadFromImageDesc(alpha, name + "_alpha", ALPHA_MASK, outSize);
+        outMemorySize += memorySize(alpha);
+    }
     return result;
 }
 
@@ -259,6 +410,29 @@ static GLenum imageDescToGLenum(ImageDesc desc) {
     }
 }
 
+static unsigned compressedLevelSize(int width, int height) {
+    if (pvrFormatSupported)
+        return (std::max(width, 8) * std::max(height, 8) * 4 + 7) / 8;
+    else
+        return 8 * ((width + 3) >> 2) * ((height + 3) >> 2);
+}
+
+unsigned OpenGLTextureCreator::memorySize(const ImageDesc& image) {
+    if (image.type == ImageDesc::RAW)
+        return image.width * image.height * image.channels;
+
+    unsigned size = 0;
+    for (int level=0; level<=image.mipmap; level++) {
+        int width = std::max(1, image.width >> level);
+        int height = std::max(1, image.height >> level);
+#if SAC_IOS
+        width = height = glm::max(width, height);
+#endif
+        size += compressedLevelSize(width, height);
+    }
+    return size;
+}
+
 void OpenGLTextureCreator::updateFromImageDesc(const ImageDesc& image, GLuint texture, Type) {
     GL_OPERATION(glBindTexture(GL_TEXTURE_2D, texture))
 
@@ -278,11 +452,7 @@ void OpenGLTextureCreator::updateFromImageDesc(const ImageDesc& image, GLuint te
 #if SAC_IOS
             width = height = glm::max(width, height);
 #endif
-            unsigned imgSize = 0;
-            if (pvrFormatSupported)
-                imgSize =( std::max(width, 8) * std::max(height, 8) * 4 + 7) / 8;
-            else
-                imgSize = 8 * ((width + 3) >> 2) * ((height + 3) >> 2);
+            unsigned imgSize = compressedLevelSize(width, height);
             LOGV(3, "\t- mipmap " << level << " : " << width << 'x' << height);
             GL_OPERATION(glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, imgSize, ptr))
             ptr += imgSize;
@@ -299,6 +469,16 @@ void OpenGLTextureCreator::updateFromImageDesc(const ImageDesc& image, GLuint te
 #endif
 }
 
+void OpenGLTextureCreator::updateRegion(GLuint texture, int x, int y, int width, int height, int channels, const void* pixels) {
+    GLenum format = channelCountToGLFormat(channels);
+
+    GL_OPERATION(glBindTexture(GL_TEXTURE_2D, texture))
+    // rows are tightly packed
+    GL_OPERATION(glPixelStorei(GL_UNPACK_ALIGNMENT, 1))
+    GL_OPERATION(glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, GL_UNSIGNED_BYTE, pixels))
+    GL_OPERATION(glPixelStorei(GL_UNPACK_ALIGNMENT, 4))
+}
+
 GLuint OpenGLTextureCreator::loadFromImageDesc(const ImageDesc& image, const std::string& /*name*/, Type type, glm::vec2& outSize) {
 #if 0
     const bool enableMipMapping =
@@ -24,6 +24,7 @@
 #include "util/ImageLoader.h"
 #include "TextureLibrary.h"
 class AssetAPI;
+struct FileBuffer;
 
 #if SAC_ANDROID || SAC_EMSCRIPTEN
 #include <GLES2/gl2.h>
@@ -49,11 +50,38 @@ class OpenGLTextureCreator {
 
 #if SAC_DESKTOP
     static void forceEtc1Usage();
+    // Keep software decoded ETC1 images in the writable data directory,
+    // so they are only decoded once
+    static void enableDecodedCache();
 #endif
 
     static InternalTexture loadFromFile(AssetAPI* assetAPI,
                                         const std::string& name,
-                                        glm::vec2& outSize);
+                                        glm::vec2& outSize,
+                                        unsigned& outMemorySize);
+
+    // Read and decode an image file. No GL call: can be used from any
+    // thread allowed to use assetAPI. Returned datas is 0 if the file is
+    // missing.
+    static ImageDesc
+    decodeFile(AssetAPI* assetAPI, const std::string& name, Type type);
+
+    // decodeFile, in 2 steps: readFile needs assetAPI (which may be bound to
+    // a thread, e.g. Android JNIEnv), decodeBuffer can run on any thread (it
+    // only uses assetAPI for the desktop decoded cache) and frees 'file'.
+    static FileBuffer readFile(AssetAPI* assetAPI, const std::string& name, bool& png);
+    static ImageDesc decodeBuffer(AssetAPI* assetAPI,
+                                  const std::string& name,
+                                  FileBuffer file,
+                                  bool png,
+                                  Type type);
+
+    // Create textures from decodeFile results (missing images are skipped)
+    static InternalTexture upload(const ImageDesc& color,
+                                  const ImageDesc& alpha,
+                                  const std::string& name,
+                                  glm::vec2& outSize,
+                                  unsigned& outMemorySize);
 
     static GLuint loadFromImageDesc(const ImageDesc& imageDesc,
                                     const std::string& name,
@@ -63,6 +91,13 @@ class OpenGLTextureCreator {
     static void
     updateFromImageDesc(const ImageDesc& imagedesc, GLuint texture, Type type);
 
+    // Replace a rectangle of an uncompressed texture
+    static void updateRegion(GLuint texture, int x, int y, int width, int height,
+                             int channels, const void* pixels);
+
+    // GPU memory used once uploaded (bytes, mipmaps included)
+    static unsigned memorySize(const ImageDesc& imageDesc);
+
     static GLuint
     create(const glm::vec2& size, int channels, void* imageData = 0);
 
@@ -70,9 +105,4 @@ class OpenGLTextureCreator {
     static ImageDesc parseImageContent(const std::string& filename,
                                        const FileBuffer& file,
                                        bool isPng);
-    static GLuint loadSplittedFromFile(AssetAPI* assetAPI,
-                                       const std::string& name,
-                                       Type type,
-                                       glm::vec2& outSize,
-                                       int& imgChannelCount);
 };
@@ -30,6 +30,13 @@
 #include <GL/glew.h>
 #endif
 
+// calling convention of GL entry points fetched at runtime
+#if SAC_DESKTOP
+#define SAC_GL_APIENTRY GLAPIENTRY
+#else
+#define SAC_GL_APIENTRY
+#endif
+
 #if SAC_DEBUG
 #define CHECK_GL_ERROR 1
 #endif
@@ -0,0 +1,114 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StreamingBuffer.h"
+#include "GLState.h"
+#include "base/Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+// keep every allocation suitably aligned for vertex attributes
+#define STREAM_ALIGNMENT 16
+
+StreamingBuffer::StreamingBuffer() : target(GL_ARRAY_BUFFER), buffer(0), glState(0), capacity(0),
+    head(0), frameUsage(0), orphanCount(0), useMapRange(false) {}
+
+void StreamingBuffer::init(GLenum pTarget, GLuint pBuffer, unsigned initialCapacity, GLState* pGLState) {
+    target = pTarget;
+    buffer = pBuffer;
+    glState = pGLState;
+#if SAC_DESKTOP
+    // Unsynchronized mapping is safe here: we never write twice to the same
+    // range of a given storage (storage gets orphaned on wrap)
+    useMapRange = GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range;
+#else
+    useMapRange = false;
+#endif
+    LOGI("Streaming buffer " << buffer << ": " << initialCapacity << " bytes, "
+        << (useMapRange ? "glMapBufferRange" : "glBufferSubData") << " upload");
+    allocate(initialCapacity);
+}
+
+void StreamingBuffer::allocate(unsigned size) {
+    capacity = size;
+    head = 0;
+    glState->buffers.bind(target, buffer);
+    GL_OPERATION(glBufferData(target, capacity, 0, GL_STREAM_DRAW))
+}
+
+void StreamingBuffer::beginFrame() {
+    if (frameUsage > capacity) {
+        unsigned newCapacity = capacity;
+        while (newCapacity < frameUsage)
+            newCapacity *= 2;
+        LOGI("Streaming buffer " << buffer << " resized: " << capacity << " -> " << newCapacity
+            << " bytes (" << orphanCount << " wraps last frame)");
+        allocate(newCapacity);
+    }
+    frameUsage = 0;
+    orphanCount = 0;
+}
+
+unsigned StreamingBuffer::upload(const void* data, unsigned size) {
+    if (size > capacity) {
+        // doesn't fit in the whole ring (e.g: big editor draw list): grow
+        // now instead of waiting for beginFrame
+        unsigned newCapacity = std::max(capacity, (unsigned)STREAM_ALIGNMENT);
+        while (newCapacity < size)
+            newCapacity *= 2;
+        LOGI("Streaming buffer " << buffer << " resized: " << capacity << " -> " << newCapacity
+            << " bytes (" << size << " bytes upload)");
+        allocate(newCapacity);
+    }
+
+    const unsigned offset = (head + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+
+    glState->buffers.bind(target, buffer);
+
+    if (offset + size > capacity) {
+        // ring is full: orphan storage (the driver keeps the previous one
+        // alive until pending draws are done) and restart from the beginning
+        GL_OPERATION(glBufferData(target, capacity, 0, GL_STREAM_DRAW))
+        head = 0;
+        orphanCount++;
+        return upload(data, size);
+    }
+
+#if SAC_DESKTOP
+    if (useMapRange) {
+        void* ptr = GL_OPERATION(glMapBufferRange(target, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT))
+        if (ptr) {
+            memcpy(ptr, data, size);
+            GL_OPERATION(glUnmapBuffer(target))
+        } else {
+            GL_OPERATION(glBufferSubData(target, offset, size, data))
+        }
+    } else
+#endif
+    {
+        GL_OPERATION(glBufferSubData(target, offset, size, data))
+    }
+
+    head = offset + size;
+    frameUsage += size;
+    return offset;
+}
@@ -0,0 +1,63 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "OpenglHelper.h"
+
+struct GLState;
+
+// Ring allocator over a single GL buffer object, used to stream per-batch
+// vertices/indices. Each upload is appended after the previous one; the
+// buffer storage is only orphaned when the ring wraps, instead of once per
+// batch. Capacity follows the peak usage of previous frames.
+struct StreamingBuffer {
+    StreamingBuffer();
+
+    void init(GLenum target,
+              GLuint buffer,
+              unsigned initialCapacity,
+              GLState* glState);
+
+    // Called once per frame, before any upload. Grows the storage if last
+    // frame needed more than 'capacity' bytes.
+    void beginFrame();
+
+    // Copy 'size' bytes to the buffer, and return their offset (in bytes).
+    // Storage grows if 'size' doesn't fit in it.
+    // Note: the buffer is left bound to 'target' (through glState).
+    unsigned upload(const void* data, unsigned size);
+
+    GLenum target;
+    GLuint buffer;
+    GLState* glState;
+    unsigned capacity;
+    // write position (in bytes)
+    unsigned head;
+    // bytes uploaded since beginFrame()
+    unsigned frameUsage;
+    // number of time the storage has been orphaned this frame
+    unsigned orphanCount;
+    // glMapBufferRange(UNSYNCHRONIZED) support
+    bool useMapRange;
+
+    private:
+    void allocate(unsigned size);
+};
@@ -22,6 +22,10 @@
 
 #include "TextureLibrary.h"
 #include "OpenGLTextureCreator.h"
+#include "api/AssetAPI.h"
+#include "util/WorkerPool.h"
+#include "base/Profiler.h"
+#include <algorithm>
 
 InternalTexture InternalTexture::Invalid;
 
@@ -29,9 +33,11 @@ TextureInfo::TextureInfo (const InternalTexture& ref,
         const glm::vec2& posInAtlas, const glm::vec2& sizeInAtlas, bool rot,
         const glm::vec2& atlasSize,
         const glm::vec2& offsetInOriginal, const glm::vec2& pOriginalSize,
-        const glm::vec2& _opaqueStart, const glm::vec2& _opaqueSize,
+        const glm::vec4* opaqueRects, int opaqueRectCount,
         int atlasIdx) {
     glref = ref;
+    memorySize = 0;
+    uploadPending = false;
 
     if (pOriginalSize == glm::vec2(0.0f)) {
         uv[0].x = uv[0].y = 0;
@@ -64,12 +70,15 @@ TextureInfo::TextureInfo (const InternalTexture& ref,
     if (rot) {
         std::swap(_sizeInAtlas.x, _sizeInAtlas.y);
     }
+    opaqueCount = 0;
     if (_sizeInAtlas.y > 0) {
-        opaqueSize = glm::vec2(_opaqueSize.x / _sizeInAtlas.x, _opaqueSize.y / _sizeInAtlas.y);
-        if (0) {//if (0 && rot) {
-            opaqueStart = glm::vec2(_opaqueStart.x / _sizeInAtlas.x, _opaqueStart.y / _sizeInAtlas.y);
-        } else {
-            opaqueStart = glm::vec2(_opaqueStart.x / _sizeInAtlas.x, 1 - (opaqueSize.y + _opaqueStart.y / _sizeInAtlas.y));
+        for (int i=0; i<std::min(opaqueRectCount, (int)MaxOpaqueRects); i++) {
+            const glm::vec4& r = opaqueRects[i];
+            if (r.z <= 0 || r.w <= 0)
+                continue;
+            opaqueSize[opaqueCount] = glm::vec2(r.z / _sizeInAtlas.x, r.w / _sizeInAtlas.y);
+            opaqueStart[opaqueCount] = glm::vec2(r.x / _sizeInAtlas.x, 1 - (opaqueSize[opaqueCount].y + r.y / _sizeInAtlas.y));
+            opaqueCount++;
         }
 
         reduxSize = glm::vec2(_sizeInAtlas.x / originalSize.x, _sizeInAtlas.y / originalSize.y);
@@ -77,13 +86,58 @@ TextureInfo::TextureInfo (const InternalTexture& ref,
     }
 }
 
+TextureLibrary::TextureLibrary() : decodeWorkers(0) {}
+
+TextureLibrary::~TextureLibrary() {
+    delete decodeWorkers;
+    for (auto& job: decodeJobs) {
+        delete[] job.second->color.datas;
+        delete[] job.second->alpha.datas;
+    }
+}
+
+void TextureLibrary::init(AssetAPI* pAssetAPI, bool pUseDeferredLoading) {
+    NamedAssetLibrary<TextureInfo, TextureRef, ImageDesc>::init(pAssetAPI, pUseDeferredLoading);
+    if (pUseDeferredLoading && !decodeWorkers) {
+        // decoding is memory hungry: few threads are enough
+        decodeWorkers = new WorkerPool(2);
+    }
+}
+
 bool TextureLibrary::doLoad(const char* assetName, TextureInfo& out, const TextureRef& ref) {
     LOGF_IF(assetAPI == 0,"Unitialized assetAPI member");
 
+    out.uploadPending = false;
     std::map<TextureRef, ImageDesc>::iterator it = dataSource.find(ref);
     if (it == dataSource.end()) {
-        LOGV(1, "loadTexture: '" << assetName << "' from file");
-        out.glref = OpenGLTextureCreator::loadFromFile(assetAPI, assetName, out.originalSize);
+        std::shared_ptr<DecodeJob> job;
+        if (decodeWorkers) {
+            std::unique_lock<std::mutex> lock(decodeMutex);
+            job = startDecode(assetName, ref);
+            if (job->done) {
+                decodeJobs.erase(ref);
+            } else {
+                job.reset();
+            }
+        }
+
+        if (!decodeWorkers) {
+            LOGV(1, "loadTexture: '" << assetName << "' from file");
+            out.glref = OpenGLTextureCreator::loadFromFile(assetAPI, assetName, out.originalSize, out.memorySize);
+        } else if (job) {
+            LOGV(1, "loadTexture: '" << assetName << "' from decoded file");
+            out.glref = OpenGLTextureCreator::upload(job->color, job->alpha, assetName, out.originalSize, out.memorySize);
+            delete[] job->color.datas;
+            delete[] job->alpha.datas;
+        } else {
+            LOGV(1, "loadTexture: '" << assetName << "' still decoding, upload postponed");
+            out.glref = InternalTexture::Invalid;
+            out.originalSize = glm::vec2(0.0f);
+            out.memorySize = 0;
+            out.uploadPending = true;
+            if (std::find(pendingUploads.begin(), pendingUploads.end(), ref) == pendingUploads.end())
+                pendingUploads.push_back(ref);
+        }
         #if SAC_LINUX && SAC_DESKTOP
         registerNewAsset(std::string(assetName) + "_alpha");
         #endif
@@ -94,7 +148,7 @@ bool TextureLibrary::doLoad(const char* assetName, TextureInfo& out, const Textu
             out.glref.alpha =
                 OpenGLTextureCreator::loadFromImageDesc(imageDesc, assetName, OpenGLTextureCreator::COLOR_ALPHA, out.originalSize);
         out.reduxSize = glm::vec2(1.0f,1.0f);
-        out.opaqueSize = glm::vec2(0.0f);
+        out.memorySize = OpenGLTextureCreator::memorySize(imageDesc);
     }
 
     out.rotateUV = false;
@@ -102,7 +156,8 @@ bool TextureLibrary::doLoad(const char* assetName, TextureInfo& out, const Textu
     out.uv[0] = glm::vec2(0.0f);
     out.uv[1] = glm::vec2(1.0f);
     out.reduxSize = glm::vec2(1.0f);
-    out.reduxStart = out.opaqueStart = out.opaqueSize = glm::vec2(0.0f);
+    out.reduxStart = glm::vec2(0.0f);
+    out.opaqueCount = 0;
     return true;
 }
 
@@ -121,10 +176,197 @@ void TextureLibrary::doUnload(const TextureInfo& in) {
 void TextureLibrary::doReload(const char* name, const TextureRef& ref) {
     TextureInfo& info = assets[ref2Index(ref)];
     if (info.atlasIndex == -1) {
+        // release previous GL texture(s) before creating new one(s)
+        doUnload(info);
         doLoad(name, info, ref);
     }
 }
 
+unsigned TextureLibrary::memoryUsage() {
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned total = 0;
+    for (const auto& ri: ref2indexv) {
+        total += assets[ri.index].memorySize;
+    }
+    return total;
+}
+
+std::shared_ptr<TextureLibrary::DecodeJob> TextureLibrary::startDecode(const std::string& name, const TextureRef& ref) {
+    auto it = decodeJobs.find(ref);
+    if (it != decodeJobs.end())
+        return it->second;
+
+    std::shared_ptr<DecodeJob> job(new DecodeJob);
+    job->name = name;
+    job->color.datas = job->alpha.datas = 0;
+    job->done = false;
+    decodeJobs.insert(std::make_pair(ref, job));
+
+    LOGV(1, "Decode '" << name << "' in background");
+#if SAC_ANDROID
+    // AssetAPI uses the calling thread's JNIEnv: read the files here and
+    // only decode the buffers in the background
+    bool colorPng, alphaPng;
+    const FileBuffer colorFile = OpenGLTextureCreator::readFile(assetAPI, name, colorPng);
+    const FileBuffer alphaFile = OpenGLTextureCreator::readFile(assetAPI, name + "_alpha", alphaPng);
+    decodeWorkers->submit([this, job, colorFile, colorPng, alphaFile, alphaPng] () -> void {
+        PROFILE("Texture", "decode-" + job->name, BeginEvent);
+        ImageDesc color = OpenGLTextureCreator::decodeBuffer(assetAPI, job->name, colorFile, colorPng, OpenGLTextureCreator::COLOR);
+        ImageDesc alpha = OpenGLTextureCreator::decodeBuffer(assetAPI, job->name + "_alpha", alphaFile, alphaPng, OpenGLTextureCreator::ALPHA_MASK);
+        PROFILE("Texture", "decode-" + job->name, EndEvent);
+#else
+    decodeWorkers->submit([this, job] () -> void {
+        PROFILE("Texture", "decode-" + job->name, BeginEvent);
+        ImageDesc color = OpenGLTextureCreator::decodeFile(assetAPI, job->name, OpenGLTextureCreator::COLOR);
+        ImageDesc alpha = OpenGLTextureCreator::decodeFile(assetAPI, job->name + "_alpha", OpenGLTextureCreator::ALPHA_MASK);
+        PROFILE("Texture", "decode-" + job->name, EndEvent);
+#endif
+
+        decodeMutex.lock();
+        job->color = color;
+        job->alpha = alpha;
+        job->done = true;
+        decodeMutex.unlock();
+        decodeDone.notify_all();
+    });
+    return job;
+}
+
+void TextureLibrary::prefetch(const std::string& name) {
+#if SAC_ANDROID
+    // Called from the game thread, but files can only be read from the
+    // render thread (see startDecode)
+    return;
+#endif
+    if (!decodeWorkers)
+        return;
+    const TextureRef ref = Murmur::RuntimeHash(name.c_str());
+
+    mutex.lock();
+    const bool skip = (dataSource.find(ref) != dataSource.end()) ||
+        (ref2Index(ref, false) >= 0);
+    mutex.unlock();
+    if (skip)
+        return;
+
+    std::unique_lock<std::mutex> lock(decodeMutex);
+    startDecode(name, ref);
+}
+
+void TextureLibrary::uploadDecoded() {
+    if (pendingUploads.empty())
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (unsigned i=0; i<pendingUploads.size(); ) {
+        const TextureRef ref = pendingUploads[i];
+
+        std::shared_ptr<DecodeJob> job;
+        decodeMutex.lock();
+        auto it = decodeJobs.find(ref);
+        if (it != decodeJobs.end()) {
+            job = it->second;
+            if (job->done)
+                decodeJobs.erase(it);
+        }
+        decodeMutex.unlock();
+
+        if (job && !job->done) {
+            i++;
+            continue;
+        }
+        pendingUploads.erase(pendingUploads.begin() + i);
+        if (!job)
+            continue;
+
+        // texture may have been unloaded meanwhile
+        int idx = ref2Index(ref, false);
+        if (idx >= 0 && assets[idx].uploadPending) {
+            TextureInfo& info = assets[idx];
+            LOGV(1, "Upload decoded texture '" << job->name << "'");
+            PROFILE("Texture", "upload-" + job->name, InstantEvent);
+            info.glref = OpenGLTextureCreator::upload(job->color, job->alpha, job->name, info.originalSize, info.memorySize);
+            info.uploadPending = false;
+        }
+        delete[] job->color.datas;
+        delete[] job->alpha.datas;
+    }
+}
+
+glm::vec2 TextureLibrary::waitDecodedSize(const TextureRef& ref) {
+    std::unique_lock<std::mutex> lock(decodeMutex);
+    auto it = decodeJobs.find(ref);
+    if (it == decodeJobs.end())
+        return glm::vec2(0.0f);
+    std::shared_ptr<DecodeJob> job = it->second;
+    while (!job->done)
+        decodeDone.wait(lock);
+    if (!job->color.datas)
+        return glm::vec2(0.0f);
+    return glm::vec2(job->color.width, job->color.height);
+}
+
+void TextureLibrary::updateRegion(const TextureRef& ref, int x, int y, int width, int height) {
+    auto it = dataSource.find(ref);
+    if (it == dataSource.end()) {
+        LOGW("Can't update a region of texture " << ref << ": no ImageDesc registered");
+        return;
+    }
+    const ImageDesc& image = it->second;
+    LOGF_IF(image.type != ImageDesc::RAW, "Only uncompressed textures can be partially updated");
+
+    x = glm::max(0, x);
+    y = glm::max(0, y);
+    width = glm::min(width, image.width - x);
+    height = glm::min(height, image.height - y);
+    if (width <= 0 || height <= 0)
+        return;
+
+    Region region;
+    region.ref = ref;
+    region.x = x;
+    region.y = y;
+    region.width = width;
+    region.height = height;
+    region.channels = image.channels;
+    const int rowSize = width * image.channels;
+    region.pixels.resize(rowSize * height);
+    for (int row = 0; row < height; row++) {
+        memcpy(&region.pixels[row * rowSize],
+            image.datas + ((y + row) * image.width + x) * image.channels,
+            rowSize);
+    }
+
+    if (!useDeferredLoading) {
+        doUploadRegion(region);
+        return;
+    }
+    mutex.lock();
+    regions.push_back(std::move(region));
+    mutex.unlock();
+}
+
+void TextureLibrary::uploadRegions() {
+    mutex.lock();
+    std::vector<Region> pending;
+    pending.swap(regions);
+    mutex.unlock();
+
+    for (const auto& region: pending) {
+        doUploadRegion(region);
+    }
+}
+
+void TextureLibrary::doUploadRegion(const Region& region) {
+    int idx = ref2Index(region.ref, false);
+    // texture not loaded (yet): its first load will read the whole ImageDesc
+    if (idx < 0)
+        return;
+    OpenGLTextureCreator::updateRegion(assets[idx].glref.color,
+        region.x, region.y, region.width, region.height, region.channels,
+        region.pixels.data());
+}
+
 const char* TextureLibrary::asset2FileSuffix() const {
     static char t[128];
     strcpy(t, OpenGLTextureCreator::DefaultFileExtension());
@@ -24,6 +24,12 @@
 #include <glm/glm.hpp>
 #include "OpenglHelper.h"
 #include "util/ImageLoader.h"
+#include "util/CompiledAssets.h"
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+class WorkerPool;
 
 struct InternalTexture {
     GLuint color;
@@ -53,8 +59,15 @@ struct TextureInfo {
     glm::vec2 originalSize;
     // texture redux offset/size
     glm::vec2 reduxStart, reduxSize;
-    // coordinates of opaque region in alpha-enabled texture (optional)
-    glm::vec2 opaqueStart, opaqueSize;
+    // coordinates of disjoint opaque regions in alpha-enabled texture
+    // (optional), biggest first
+    static const int MaxOpaqueRects = CompiledAtlas::MaxOpaqueRects;
+    glm::vec2 opaqueStart[MaxOpaqueRects], opaqueSize[MaxOpaqueRects];
+    int opaqueCount;
+    // GPU memory used by glref, in bytes (0 for images of an atlas)
+    unsigned memorySize;
+    // image file still being decoded: glref is not valid yet
+    bool uploadPending;
     TextureInfo(const InternalTexture& glref = InternalTexture::Invalid,
                 const glm::vec2& posInAtlas = glm::vec2(0),
                 const glm::vec2& sizeInAtlas = glm::vec2(0.0f),
@@ -62,8 +75,9 @@ struct TextureInfo {
                 const glm::vec2& atlasSize = glm::vec2(0),
                 const glm::vec2& offsetInOriginal = glm::vec2(0),
                 const glm::vec2& originalSize = glm::vec2(0.0f),
-                const glm::vec2& opaqueStart = glm::vec2(0),
-                const glm::vec2& opaqueSize = glm::vec2(0.0f),
+                // x, y, width, height in pixels, from top left corner
+                const glm::vec4* opaqueRects = 0,
+                int opaqueRectCount = 0,
                 int atlasIdx = -1);
 };
 
@@ -72,6 +86,14 @@ typedef hash_t TextureRef;
 
 class TextureLibrary
     : public NamedAssetLibrary<TextureInfo, TextureRef, ImageDesc> {
+    public:
+    TextureLibrary();
+    ~TextureLibrary();
+
+    // With deferred loading, image files are read and decoded by worker
+    // threads: only GL uploads are done by update() / uploadDecoded().
+    void init(AssetAPI* pAssetAPI, bool pUseDeferredLoading = true);
+
     protected:
     bool doLoad(const char* name, TextureInfo& out, const TextureRef& ref);
 
@@ -82,4 +104,47 @@ class TextureLibrary
     public:
     const char* asset2FilePrefix() const { return ""; }
     const char* asset2FileSuffix() const;
+
+    // Update a rectangle (in pixels) of a texture loaded from a registered
+    // ImageDesc. Pixels are copied now and sent by uploadRegions, without
+    // recreating the whole texture.
+    void updateRegion(const TextureRef& ref, int x, int y, int width, int height);
+    // Must be called from the GL thread, after update()
+    void uploadRegions();
+
+    // GPU memory used by loaded textures, in bytes
+    unsigned memoryUsage();
+
+    // Start decoding an image file before it's needed (any thread).
+    // Does nothing if already loaded or decoding.
+    void prefetch(const std::string& name);
+    // Upload textures whose decoding ended after they were loaded. Must be
+    // called from the GL thread, after update()
+    void uploadDecoded();
+    // Size of an uploadPending texture (waits for its decoding)
+    glm::vec2 waitDecodedSize(const TextureRef& ref);
+
+    private:
+    struct DecodeJob {
+        std::string name;
+        ImageDesc color, alpha;
+        bool done;
+    };
+    // decodeMutex must be held
+    std::shared_ptr<DecodeJob> startDecode(const std::string& name, const TextureRef& ref);
+
+    WorkerPool* decodeWorkers;
+    std::mutex decodeMutex;
+    std::condition_variable decodeDone;
+    std::map<TextureRef, std::shared_ptr<DecodeJob> > decodeJobs;
+    // loaded textures waiting for their decoding (GL thread only)
+    std::vector<TextureRef> pendingUploads;
+
+    struct Region {
+        TextureRef ref;
+        int x, y, width, height, channels;
+        std::vector<char> pixels;
+    };
+    std::vector<Region> regions;
+    void doUploadRegion(const Region& region);
 };
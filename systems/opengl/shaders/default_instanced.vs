@@ -0,0 +1,27 @@
+// unit quad corner, in [-0.5, 0.5]
+attribute vec2 aPosition;
+// per instance attributes
+attribute vec3 aInstancePosition;   // x, y, z
+attribute vec4 aInstanceTransform;  // half-size, rotation, rotateUV
+attribute vec4 aInstanceUV;         // uv0, uv1
+attribute vec4 aInstanceColor;
+
+uniform mat4 uMvp;
+varying vec2 uvVarying;
+varying vec4 vColor;
+
+void main()
+{
+    vec2 scaled = aPosition * 2.0 * aInstanceTransform.xy;
+    float c = cos(aInstanceTransform.z);
+    float s = sin(aInstanceTransform.z);
+    vec2 p = aInstancePosition.xy + vec2(c * scaled.x - s * scaled.y, s * scaled.x + c * scaled.y);
+    gl_Position = uMvp * vec4(p, aInstancePosition.z, 1.0);
+
+    // same uv mapping as addRenderCommandToBatch (rotated atlas images
+    // are mapped with a quarter turn)
+    vec2 t = aPosition + 0.5;
+    t = mix(t, vec2(t.y, 1.0 - t.x), aInstanceTransform.w);
+    uvVarying = vec2(mix(aInstanceUV.x, aInstanceUV.z, t.x), 1.0 - mix(aInstanceUV.y, aInstanceUV.w, t.y));
+    vColor = aInstanceColor;
+}
@@ -3,7 +3,11 @@ precision lowp float;
 #endif
 uniform sampler2D tex0;
 uniform sampler2D tex1;
+#ifdef SAC_INSTANCED
+varying vec4 vColor;
+#else
 uniform vec4 vColor;
+#endif
 
 varying vec2 uvVarying;
 
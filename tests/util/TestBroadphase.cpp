@@ -0,0 +1,134 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include <UnitTest++.h>
+
+#include "util/Broadphase.h"
+
+static AABB Box(float l, float r, float b, float t) {
+    AABB a;
+    a.left = l; a.right = r; a.bottom = b; a.top = t;
+    return a;
+}
+
+static bool InCell(const Broadphase& bp, int x, int y, Entity e, Broadphase::Layer l) {
+    for (auto o: bp.cell(x, y).entities[l])
+        if (o == e) return true;
+    return false;
+}
+
+TEST (TestBroadphaseInsert)
+{
+    Broadphase bp;
+    bp.setGrid(glm::vec2(8, 8), 2);
+    CHECK_EQUAL(4, bp.width());
+    CHECK_EQUAL(4, bp.height());
+
+    int p = bp.update(-1, 1, Box(-1, 1, -1, 1), Broadphase::Colliding, 2);
+    CHECK(p >= 0);
+    CHECK_EQUAL(1u, bp.count());
+    CHECK_EQUAL(4u, bp.occupiedCells().size());
+    CHECK(InCell(bp, 1, 1, 1, Broadphase::Colliding));
+    CHECK(InCell(bp, 2, 2, 1, Broadphase::Colliding));
+    CHECK(!InCell(bp, 0, 0, 1, Broadphase::Colliding));
+    CHECK_EQUAL(2, bp.cell(1, 1).groups[Broadphase::Colliding]);
+    CHECK_EQUAL(0, bp.cell(1, 1).groups[Broadphase::Collider]);
+}
+
+TEST (TestBroadphaseMove)
+{
+    Broadphase bp;
+    bp.setGrid(glm::vec2(8, 8), 2);
+    int p = bp.update(-1, 3, Box(0.5, 1, 0.5, 1), Broadphase::Collider, 1);
+    bp.resetStats();
+
+    // same cells: nothing to do
+    CHECK_EQUAL(p, bp.update(p, 3, Box(0.2, 1.5, 0.2, 1.5), Broadphase::Collider, 1));
+    CHECK_EQUAL(0u, bp.moves());
+
+    CHECK_EQUAL(p, bp.update(p, 3, Box(-3, -2.5, 2.5, 3), Broadphase::Collider, 1));
+    CHECK_EQUAL(2u, bp.moves());
+    CHECK(!InCell(bp, 2, 2, 3, Broadphase::Collider));
+    CHECK(InCell(bp, 0, 3, 3, Broadphase::Collider));
+    CHECK_EQUAL(1u, bp.occupiedCells().size());
+    CHECK_EQUAL(0, bp.cell(2, 2).groups[Broadphase::Collider]);
+}
+
+TEST (TestBroadphaseRemove)
+{
+    Broadphase bp;
+    bp.setGrid(glm::vec2(8, 8), 2);
+    int p1 = bp.update(-1, 1, Box(0.5, 1, 0.5, 1), Broadphase::Colliding, 2);
+    int p2 = bp.update(-1, 2, Box(0.5, 1, 0.5, 1), Broadphase::Colliding, 4);
+    CHECK_EQUAL(6, bp.cell(2, 2).groups[Broadphase::Colliding]);
+
+    // wrong entity: ignored
+    bp.remove(p1, 2);
+    CHECK_EQUAL(2u, bp.count());
+
+    bp.remove(p1, 1);
+    CHECK_EQUAL(1u, bp.count());
+    CHECK(!InCell(bp, 2, 2, 1, Broadphase::Colliding));
+    CHECK_EQUAL(1u, bp.occupiedCells().size());
+
+    bp.remove(p2, 2);
+    CHECK_EQUAL(0u, bp.count());
+    CHECK_EQUAL(0u, bp.occupiedCells().size());
+    CHECK_EQUAL(0, bp.cell(2, 2).groups[Broadphase::Colliding]);
+
+    // freed proxy is reused
+    CHECK_EQUAL(p2, bp.update(-1, 5, Box(0, 1, 0, 1), Broadphase::Colliding, 2));
+    // a stale proxy belonging to another entity is an insertion
+    CHECK(bp.update(p2, 6, Box(0, 1, 0, 1), Broadphase::Colliding, 2) != p2);
+    CHECK_EQUAL(2u, bp.count());
+}
+
+TEST (TestBroadphaseClamp)
+{
+    Broadphase bp;
+    bp.setGrid(glm::vec2(8, 8), 2);
+    int x0, y0, x1, y1;
+    bp.cellRange(Box(-100, 100, -50, -10), x0, y0, x1, y1);
+    CHECK_EQUAL(0, x0);
+    CHECK_EQUAL(3, x1);
+    CHECK_EQUAL(0, y0);
+    CHECK_EQUAL(0, y1);
+
+    bp.update(-1, 1, Box(0, 1, 0, 1), Broadphase::Colliding, 2);
+    // grid change drops everything
+    bp.setGrid(glm::vec2(8, 8), 1);
+    CHECK_EQUAL(0u, bp.count());
+    CHECK_EQUAL(8, bp.width());
+    CHECK_EQUAL(0u, bp.occupiedCells().size());
+}
+
+TEST (TestBroadphasePairCell)
+{
+    Broadphase bp;
+    bp.setGrid(glm::vec2(8, 8), 2);
+    // a covers cells (0..2, 1..2), b covers (1..3, 0..1)
+    int a = bp.update(-1, 1, Box(-3, 1, -1, 1), Broadphase::Colliding, 2);
+    int b = bp.update(-1, 2, Box(-1, 3, -3, -1), Broadphase::Colliding, 2);
+    CHECK_EQUAL(1 + 1 * 4, bp.pairCell(a, b));
+    CHECK_EQUAL(bp.pairCell(b, a), bp.pairCell(a, b));
+}
@@ -0,0 +1,122 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include <UnitTest++.h>
+
+#include "util/CompiledAssets.h"
+#include "api/AssetAPI.h"
+#include <cstring>
+
+static FileBuffer FB(const char* str) {
+    FileBuffer fb;
+    fb.data = (uint8_t*) str;
+    fb.size = strlen(str);
+    return fb;
+}
+
+static FileBuffer FB(std::vector<uint8_t>& v) {
+    FileBuffer fb;
+    fb.data = &v[0];
+    fb.size = v.size();
+    return fb;
+}
+
+TEST (TestCompiledAtlas)
+{
+    const char* text =
+        "atlas_size=256,128\n"
+        "[image0]\n"
+        "name=plop\n"
+        "original_size=40,20\n"
+        "position_in_atlas=1,2\n"
+        "size_in_atlas=30,10\n"
+        "crop_offset=5,6\n"
+        "rotated=1\n"
+        "opaque_rect=1,2,3,4,5,6,7,8\n"
+        "[image1]\n"
+        "name=other\n"
+        "original_size=8,8\n"
+        "position_in_atlas=40,2\n"
+        "size_in_atlas=8,8\n"
+        "crop_offset=0,0\n"
+        "rotated=0\n";
+    std::vector<uint8_t> out;
+    CHECK(CompiledAtlas::compile(FB(text), __FUNCTION__, out));
+
+    const CompiledAtlas::Header* h = CompiledAtlas::validate(FB(out));
+    CHECK(h != 0);
+    CHECK_EQUAL(256.0f, h->atlasSize[0]);
+    CHECK_EQUAL(128.0f, h->atlasSize[1]);
+    CHECK_EQUAL(2u, h->imageCount);
+
+    const CompiledAtlas::Image* images = CompiledAtlas::images(h);
+    CHECK_EQUAL(std::string("plop"), CompiledAtlas::name(h, images[0]));
+    CHECK_EQUAL(Murmur::RuntimeHash("plop"), images[0].nameHash);
+    CHECK_EQUAL(30.0f, images[0].sizeInAtlas[0]);
+    CHECK_EQUAL(6.0f, images[0].cropOffset[1]);
+    CHECK_EQUAL(1u, images[0].rotated);
+    CHECK_EQUAL(2u, images[0].opaqueCount);
+    CHECK_EQUAL(8.0f, images[0].opaqueRects[1][3]);
+
+    CHECK_EQUAL(std::string("other"), CompiledAtlas::name(h, images[1]));
+    CHECK_EQUAL(0u, images[1].opaqueCount);
+}
+
+TEST (TestCompiledAtlasTruncated)
+{
+    const char* text =
+        "atlas_size=16,16\n"
+        "[image0]\n"
+        "name=a\n"
+        "original_size=1,1\n"
+        "position_in_atlas=0,0\n"
+        "size_in_atlas=1,1\n"
+        "crop_offset=0,0\n"
+        "rotated=0\n";
+    std::vector<uint8_t> out;
+    CHECK(CompiledAtlas::compile(FB(text), __FUNCTION__, out));
+    out.resize(out.size() - 8);
+    CHECK(CompiledAtlas::validate(FB(out)) == 0);
+}
+
+TEST (TestCompiledFont)
+{
+    // glyphs are sorted by unicode
+    const char* text =
+        "78=10,10\n"
+        "41=5,10\n"
+        "e9=4,2\n";
+    std::vector<uint8_t> out;
+    CHECK(CompiledFont::compile(FB(text), __FUNCTION__, out));
+
+    const CompiledFont::Header* h = CompiledFont::validate(FB(out));
+    CHECK(h != 0);
+    CHECK_EQUAL(3u, h->glyphCount);
+    const CompiledFont::Glyph* glyphs = CompiledFont::glyphs(h);
+    CHECK_EQUAL((uint32_t)'A', glyphs[0].unicode);
+    CHECK_EQUAL(0.5f, glyphs[0].h2wRatio);
+    CHECK_EQUAL((uint32_t)'x', glyphs[1].unicode);
+    CHECK_EQUAL(1.0f, glyphs[1].h2wRatio);
+    CHECK_EQUAL(0xe9u, glyphs[2].unicode);
+    CHECK_EQUAL(2.0f, glyphs[2].h2wRatio);
+}
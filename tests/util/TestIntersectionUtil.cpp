@@ -24,6 +24,8 @@
 
 #include "util/IntersectionUtil.h"
 #include "systems/TransformationSystem.h"
+#include "util/Random.h"
+#include <cfloat>
 
 TEST(parallelLinesCollision)
 {
@@ -135,3 +137,155 @@ TEST(lineRectangleSimple3)
     TransformationSystem::DestroyInstance();
 }
 
+// random rectangles, and their TransformationComponent version
+static void randomRectangles(std::mt19937& generator, int count, RectangleBatch& batch, std::vector<TransformationComponent>& tcs) {
+    for (int i=0; i<count; i++) {
+        TransformationComponent tc;
+        tc.position = glm::vec2(Random::Float(generator, -5, 5), Random::Float(generator, -5, 5));
+        tc.size = glm::vec2(Random::Float(generator, 0.1, 3), Random::Float(generator, 0.1, 3));
+        tc.rotation = Random::Float(generator, -3, 3);
+        batch.add(tc.position, tc.size, tc.rotation);
+        tcs.push_back(tc);
+    }
+}
+
+TEST(rectangleRectanglesBatch)
+{
+    std::mt19937 generator(42);
+    RectangleBatch batch;
+    std::vector<TransformationComponent> tcs;
+    // not a multiple of 4, to use the scalar path too
+    randomRectangles(generator, 203, batch, tcs);
+
+    for (int a=0; a<10; a++) {
+        const auto& ta = tcs[a];
+        std::vector<uint8_t> result(batch.count);
+        IntersectionUtil::rectangleRectangles(ta.position, ta.size, ta.rotation, batch, &result[0]);
+        for (unsigned i=0; i<batch.count; i++) {
+            CHECK_EQUAL(IntersectionUtil::rectangleRectangle(
+                ta.position, ta.size, ta.rotation,
+                tcs[i].position, tcs[i].size, tcs[i].rotation), (bool)result[i]);
+        }
+    }
+}
+
+TEST(rectanglesAABBBatch)
+{
+    std::mt19937 generator(43);
+    RectangleBatch batch;
+    std::vector<TransformationComponent> tcs;
+    randomRectangles(generator, 203, batch, tcs);
+
+    const AABB area = { -2, 1, 3, -1 };
+    std::vector<uint8_t> result(batch.count);
+    IntersectionUtil::rectanglesAABB(area, batch, &result[0]);
+    for (unsigned i=0; i<batch.count; i++) {
+        AABB aabb;
+        IntersectionUtil::computeAABB(&tcs[i], aabb);
+        CHECK_EQUAL(IntersectionUtil::rectangleRectangleAABB(area, aabb), (bool)result[i]);
+    }
+}
+
+TEST(lineRectanglesBatch)
+{
+    TransformationSystem::CreateInstance();
+
+    std::mt19937 generator(44);
+    RectangleBatch batch;
+    std::vector<TransformationComponent> tcs;
+    randomRectangles(generator, 203, batch, tcs);
+
+    for (int l=0; l<10; l++) {
+        const glm::vec2 l1(Random::Float(generator, -6, 6), Random::Float(generator, -6, 6));
+        const glm::vec2 l2(Random::Float(generator, -6, 6), Random::Float(generator, -6, 6));
+        std::vector<float> result(batch.count);
+        IntersectionUtil::lineRectangles(l1, l2, batch, &result[0]);
+
+        for (unsigned i=0; i<batch.count; i++) {
+            glm::vec2 intersections[4];
+            int count = IntersectionUtil::lineRectangle(l1, l2,
+                tcs[i].position, tcs[i].size, tcs[i].rotation, intersections);
+            CHECK_EQUAL(count > 0, result[i] != FLT_MAX);
+            if (count > 0 && result[i] != FLT_MAX) {
+                float nearest = FLT_MAX;
+                for (int j=0; j<count; j++)
+                    nearest = glm::min(nearest, glm::length(intersections[j] - l1));
+                CHECK_CLOSE(nearest, result[i] * glm::length(l2 - l1), 0.001);
+            }
+        }
+    }
+
+    // axis aligned segment, starting inside
+    RectangleBatch one;
+    one.add(glm::vec2(0.0f), glm::vec2(2.0f), 0);
+    float t;
+    IntersectionUtil::lineRectangles(glm::vec2(0.0f), glm::vec2(4, 0), one, &t);
+    CHECK_CLOSE(0.25f, t, 0.0001);
+
+    TransformationSystem::DestroyInstance();
+}
+
+TEST(rectangleRectangleTimeOfImpactTranslation)
+{
+    const glm::vec2 a[] = { glm::vec2(0.0f), glm::vec2(0.0f) };
+    const float noRotation[] = { 0, 0 };
+    const glm::vec2 size(1.0f);
+
+    // head-on: touch when B center reaches x=1
+    const glm::vec2 b[] = { glm::vec2(3, 0), glm::vec2(-3, 0) };
+    CHECK_CLOSE(1.0f / 3, IntersectionUtil::rectangleRectangleTimeOfImpact(
+        a, size, noRotation, b, size, noRotation, 0.0001f), 0.0001);
+    // stops 'tolerance' before
+    CHECK_CLOSE((3 - 1.1f) / 6, IntersectionUtil::rectangleRectangleTimeOfImpact(
+        a, size, noRotation, b, size, noRotation, 0.1f), 0.0001);
+
+    // miss
+    const glm::vec2 c[] = { glm::vec2(3, 2), glm::vec2(-3, 2) };
+    CHECK_EQUAL(FLT_MAX, IntersectionUtil::rectangleRectangleTimeOfImpact(
+        a, size, noRotation, c, size, noRotation, 0.0001f));
+
+    // already intersecting
+    const glm::vec2 d[] = { glm::vec2(0.5, 0.5), glm::vec2(3, 0) };
+    CHECK_EQUAL(0.0f, IntersectionUtil::rectangleRectangleTimeOfImpact(
+        a, size, noRotation, d, size, noRotation, 0.0001f));
+
+    // tunnelling: B goes through A during the frame
+    const glm::vec2 e[] = { glm::vec2(-10, 0), glm::vec2(10, 0) };
+    CHECK_CLOSE(0.45f, IntersectionUtil::rectangleRectangleTimeOfImpact(
+        a, size, noRotation, e, size, noRotation, 0.0001f), 0.0001);
+}
+
+TEST(rectangleRectangleTimeOfImpactRotation)
+{
+    const glm::vec2 a[] = { glm::vec2(0.0f), glm::vec2(0.0f) };
+    const float aRotation[] = { 0, 0 };
+    const glm::vec2 b[] = { glm::vec2(4, 0.3), glm::vec2(-2, 0.3) };
+    const float bRotation[] = { 0, 1.5 };
+    const glm::vec2 size(2, 0.5);
+    const float tolerance = 0.001f;
+
+    const float t = IntersectionUtil::rectangleRectangleTimeOfImpact(
+        a, size, aRotation, b, size, bRotation, tolerance);
+    CHECK(t > 0 && t < 1);
+
+    // apart at t, intersecting a bit later
+    const glm::vec2 bAtT = glm::mix(b[0], b[1], t);
+    CHECK(!IntersectionUtil::rectangleRectangle(a[0], size, 0,
+        bAtT, size, glm::mix(bRotation[0], bRotation[1], t)));
+    const float later = t + 0.01f;
+    CHECK(IntersectionUtil::rectangleRectangle(a[0], size, 0,
+        glm::mix(b[0], b[1], later), size, glm::mix(bRotation[0], bRotation[1], later)));
+}
+
+TEST(rectangleRectangleTimeOfImpactSlowConvergence)
+{
+    // fast spin, slow approach: conservative advancement alone doesn't
+    // converge
+    const glm::vec2 a[] = { glm::vec2(0.0f), glm::vec2(0.3f, 0.0f) };
+    const float aRotation[] = { 0, 3.14159265f };
+    const glm::vec2 b[] = { glm::vec2(0.84f, 0.0f), glm::vec2(0.84f, 0.0f) };
+    const float bRotation[] = { 0, 0 };
+
+    CHECK_CLOSE(0.655f, IntersectionUtil::rectangleRectangleTimeOfImpact(
+        a, glm::vec2(1.0f), aRotation, b, glm::vec2(0.1f), bRotation, 0.001f), 0.001f);
+}
@@ -0,0 +1,68 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include <UnitTest++.h>
+
+#include "util/OcclusionBuffer.h"
+
+TEST(OcclusionHiddenBehindNearerOccluder)
+{
+    OcclusionBuffer buffer;
+    buffer.reset(glm::vec2(0.0f), glm::vec2(10.0f), 0);
+    CHECK(buffer.addOccluder(glm::vec2(0.0f), glm::vec2(5.0f), 0, 0.5f));
+    CHECK(buffer.isOccluded(glm::vec2(1.0f, 1.0f), glm::vec2(1.0f), 0.3f, 0.4f));
+    // nearer
+    CHECK(!buffer.isOccluded(glm::vec2(1.0f, 1.0f), glm::vec2(1.0f), 0.3f, 0.6f));
+    // same depth: not hidden (occluder must not cull itself)
+    CHECK(!buffer.isOccluded(glm::vec2(0.0f), glm::vec2(5.0f), 0, 0.5f));
+}
+
+TEST(OcclusionPartialCoverage)
+{
+    OcclusionBuffer buffer;
+    buffer.reset(glm::vec2(0.0f), glm::vec2(10.0f), 0);
+    // left half of the screen
+    CHECK(buffer.addOccluder(glm::vec2(-2.5f, 0.0f), glm::vec2(2.5f, 5.0f), 0, 0.5f));
+    CHECK(buffer.isOccluded(glm::vec2(-2.5f, 0.0f), glm::vec2(1.0f), 0, 0.1f));
+    // straddles the occluder edge
+    CHECK(!buffer.isOccluded(glm::vec2(0.0f), glm::vec2(1.0f), 0, 0.1f));
+}
+
+TEST(OcclusionRotatedOccluderIgnored)
+{
+    OcclusionBuffer buffer;
+    buffer.reset(glm::vec2(0.0f), glm::vec2(10.0f), 0);
+    CHECK(!buffer.addOccluder(glm::vec2(0.0f), glm::vec2(4.0f), 0.3f, 0.5f));
+    CHECK(!buffer.isOccluded(glm::vec2(0.0f), glm::vec2(0.5f), 0, 0.1f));
+    // quarter turn is still aligned
+    CHECK(buffer.addOccluder(glm::vec2(0.0f), glm::vec2(4.0f, 2.0f), 1.5707963f, 0.5f));
+    CHECK(buffer.isOccluded(glm::vec2(0.0f, 3.0f), glm::vec2(0.5f), 0, 0.1f));
+}
+
+TEST(OcclusionRotatedCamera)
+{
+    OcclusionBuffer buffer;
+    buffer.reset(glm::vec2(10.0f, 0.0f), glm::vec2(10.0f), 0.7f);
+    CHECK(buffer.addOccluder(glm::vec2(10.0f, 0.0f), glm::vec2(3.0f), 0.7f, 0.5f));
+    CHECK(buffer.isOccluded(glm::vec2(10.0f, 0.0f), glm::vec2(1.0f), 0.7f, 0.2f));
+}
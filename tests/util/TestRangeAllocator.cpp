@@ -0,0 +1,90 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include <UnitTest++.h>
+
+#include "util/RangeAllocator.h"
+
+TEST(RangeAllocatorFirstFit)
+{
+    RangeAllocator alloc(16);
+    unsigned a, b;
+    CHECK(alloc.allocate(4, &a));
+    CHECK(alloc.allocate(8, &b));
+    CHECK_EQUAL(0u, a);
+    CHECK_EQUAL(4u, b);
+    CHECK_EQUAL(12u, alloc.used());
+    CHECK_EQUAL(16u, alloc.capacity());
+}
+
+TEST(RangeAllocatorReuseReleased)
+{
+    RangeAllocator alloc(16);
+    unsigned a, b, c;
+    alloc.allocate(4, &a);
+    alloc.allocate(4, &b);
+    alloc.release(a, 4);
+    CHECK(alloc.allocate(2, &c));
+    CHECK_EQUAL(a, c);
+    CHECK_EQUAL(6u, alloc.used());
+}
+
+TEST(RangeAllocatorMergeOnRelease)
+{
+    RangeAllocator alloc(12);
+    unsigned a, b, c, d;
+    alloc.allocate(4, &a);
+    alloc.allocate(4, &b);
+    alloc.allocate(4, &c);
+    alloc.release(a, 4);
+    alloc.release(c, 4);
+    CHECK_EQUAL(2u, alloc.freeRangeCount());
+    alloc.release(b, 4);
+    CHECK_EQUAL(1u, alloc.freeRangeCount());
+    CHECK_EQUAL(0u, alloc.used());
+    CHECK(alloc.allocate(12, &d));
+    CHECK_EQUAL(0u, d);
+    CHECK_EQUAL(12u, alloc.capacity());
+}
+
+TEST(RangeAllocatorGrow)
+{
+    RangeAllocator alloc(8, 32);
+    unsigned a, b;
+    alloc.allocate(6, &a);
+    CHECK(alloc.allocate(6, &b));
+    CHECK_EQUAL(6u, b);
+    CHECK_EQUAL(16u, alloc.capacity());
+    // free tail and grown space are merged
+    CHECK_EQUAL(1u, alloc.freeRangeCount());
+}
+
+TEST(RangeAllocatorFull)
+{
+    RangeAllocator alloc(8, 16);
+    unsigned a, b;
+    CHECK(alloc.allocate(12, &a));
+    CHECK(!alloc.allocate(8, &b));
+    CHECK(alloc.allocate(4, &b));
+    CHECK_EQUAL(16u, alloc.capacity());
+}
@@ -0,0 +1,85 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include <UnitTest++.h>
+
+#include "util/WorkerPool.h"
+#include <atomic>
+#include <vector>
+
+TEST(WorkerPoolRunsAllJobs)
+{
+    WorkerPool pool(3);
+    CHECK_EQUAL(3u, pool.threadCount());
+
+    std::atomic<int> sum(0);
+    for (int i=1; i<=100; i++) {
+        pool.submit([&sum, i] () -> void { sum += i; });
+    }
+    pool.waitAll();
+    CHECK_EQUAL(5050, sum.load());
+}
+
+TEST(WorkerPoolWaitAllWithoutJobs)
+{
+    WorkerPool pool(1);
+    pool.waitAll();
+    CHECK_EQUAL(1u, pool.threadCount());
+}
+
+TEST(WorkerPoolDestructorWaitsForJobs)
+{
+    std::atomic<int> done(0);
+    {
+        WorkerPool pool(2);
+        for (int i=0; i<10; i++) {
+            pool.submit([&done] () -> void { done++; });
+        }
+    }
+    CHECK_EQUAL(10, done.load());
+}
+
+TEST(WorkerPoolParallelForCoversEachIndexOnce)
+{
+    WorkerPool pool(3);
+    std::vector<int> hits(1000, 0);
+    pool.parallelFor(hits.size(), 7, [&hits] (unsigned begin, unsigned end) -> void {
+        for (unsigned i=begin; i<end; i++) hits[i]++;
+    });
+    for (unsigned i=0; i<hits.size(); i++) {
+        CHECK_EQUAL(1, hits[i]);
+    }
+}
+
+TEST(WorkerPoolParallelForFromWorker)
+{
+    WorkerPool pool(2);
+    std::atomic<int> sum(0);
+    pool.submit([&pool, &sum] () -> void {
+        pool.parallelFor(100, 1, [&sum] (unsigned begin, unsigned end) -> void {
+            for (unsigned i=begin; i<end; i++) sum += i + 1;
+        });
+    });
+    pool.waitAll();
+    CHECK_EQUAL(5050, sum.load());
+}
@@ -0,0 +1,149 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include <UnitTest++.h>
+
+#include "util/WorldQuery.h"
+#include "util/Random.h"
+#include <algorithm>
+
+TEST (TestWorldQueryRaycast)
+{
+    WorldQuery wq;
+    wq.update(-1, 1, glm::vec2(5, 0), glm::vec2(1, 1), 0, 1);
+    wq.update(-1, 2, glm::vec2(10, 0), glm::vec2(1, 1), 0, 2);
+    CHECK_EQUAL(2u, wq.count());
+
+    WorldQuery::Hit hit = wq.raycast(WorldQuery::Ray(glm::vec2(0, 0), glm::vec2(20, 0)));
+    CHECK_EQUAL(1, (int)hit.entity);
+    CHECK_CLOSE(4.5f / 20, hit.t, 0.0001f);
+    CHECK_CLOSE(4.5f, hit.point.x, 0.0001f);
+
+    // mask and ignored entity
+    CHECK_EQUAL(2, (int)wq.raycast(WorldQuery::Ray(glm::vec2(0, 0), glm::vec2(20, 0), 2)).entity);
+    CHECK_EQUAL(2, (int)wq.raycast(WorldQuery::Ray(glm::vec2(0, 0), glm::vec2(20, 0), ~0, 1)).entity);
+    // too short, or outside of the grid
+    CHECK_EQUAL(0, (int)wq.raycast(WorldQuery::Ray(glm::vec2(0, 0), glm::vec2(4, 0))).entity);
+    CHECK_EQUAL(0, (int)wq.raycast(WorldQuery::Ray(glm::vec2(0, 50), glm::vec2(20, 50))).entity);
+
+    std::vector<WorldQuery::Hit> hits;
+    wq.raycastAll(WorldQuery::Ray(glm::vec2(20, 0), glm::vec2(0, 0)), hits);
+    CHECK_EQUAL(2u, hits.size());
+    CHECK_EQUAL(2, (int)hits[0].entity);
+    CHECK_EQUAL(1, (int)hits[1].entity);
+}
+
+TEST (TestWorldQueryMoveAndRemove)
+{
+    WorldQuery wq;
+    int p = wq.update(-1, 1, glm::vec2(0, 0), glm::vec2(1, 1), 0, 1);
+    wq.update(-1, 2, glm::vec2(3, 3), glm::vec2(1, 1), 0, 1);
+
+    // far away: the grid follows
+    CHECK_EQUAL(p, wq.update(p, 1, glm::vec2(100, 0), glm::vec2(1, 1), 0, 1));
+    CHECK_EQUAL(1, (int)wq.raycast(WorldQuery::Ray(glm::vec2(90, 0), glm::vec2(110, 0))).entity);
+    CHECK_EQUAL(0, (int)wq.raycast(WorldQuery::Ray(glm::vec2(-10, 0), glm::vec2(1, 0))).entity);
+
+    wq.remove(p, 1);
+    CHECK_EQUAL(1u, wq.count());
+    CHECK_EQUAL(0, (int)wq.raycast(WorldQuery::Ray(glm::vec2(90, 0), glm::vec2(110, 0))).entity);
+    // proxy is reused
+    CHECK_EQUAL(p, wq.update(-1, 3, glm::vec2(0, 0), glm::vec2(1, 1), 0, 1));
+}
+
+TEST (TestWorldQuerySparseWorldNoRebuild)
+{
+    // cells can't be as small as the rectangles: the grid would be too big
+    WorldQuery wq;
+    int p = wq.update(-1, 1, glm::vec2(0, 0), glm::vec2(1, 1), 0, 1);
+    wq.update(-1, 2, glm::vec2(10000, 0), glm::vec2(1, 1), 0, 1);
+
+    const unsigned rebuilds = wq.rebuilds();
+    for (int i=0; i<100; i++) {
+        wq.update(p, 1, glm::vec2(i * 0.1f, 0), glm::vec2(1, 1), 0, 1);
+    }
+    CHECK_EQUAL(rebuilds, wq.rebuilds());
+    CHECK_EQUAL(1, (int)wq.raycast(WorldQuery::Ray(glm::vec2(9.9f, -5), glm::vec2(9.9f, 5))).entity);
+}
+
+TEST (TestWorldQueryMatchesBruteForce)
+{
+    std::mt19937 generator(42);
+    WorldQuery wq;
+    RectangleBatch all;
+    std::vector<Entity> entities;
+    for (int i=0; i<300; i++) {
+        const glm::vec2 pos(Random::Float(generator, -50, 50), Random::Float(generator, -50, 50));
+        const glm::vec2 size(Random::Float(generator, 0.2, 4), Random::Float(generator, 0.2, 4));
+        const float rot = Random::Float(generator, -3, 3);
+        wq.update(-1, i + 1, pos, size, rot, 1);
+        all.add(pos, size, rot);
+        entities.push_back(i + 1);
+    }
+
+    std::vector<WorldQuery::Ray> rays;
+    for (int i=0; i<200; i++) {
+        rays.push_back(WorldQuery::Ray(
+            glm::vec2(Random::Float(generator, -70, 70), Random::Float(generator, -70, 70)),
+            glm::vec2(Random::Float(generator, -70, 70), Random::Float(generator, -70, 70))));
+    }
+    std::vector<WorldQuery::Hit> nearest(rays.size());
+    wq.raycast(&rays[0], rays.size(), &nearest[0]);
+
+    std::vector<float> expected(all.count);
+    std::vector<WorldQuery::Hit> hits;
+    for (unsigned r=0; r<rays.size(); r++) {
+        IntersectionUtil::lineRectangles(rays[r].from, rays[r].to, all, &expected[0]);
+        const unsigned count = std::count_if(expected.begin(), expected.end(),
+            [] (float t) -> bool { return t != FLT_MAX; });
+        const float t = *std::min_element(expected.begin(), expected.end());
+
+        CHECK_CLOSE(t, nearest[r].t, 0.0001f);
+        if (t != FLT_MAX)
+            CHECK_EQUAL(t, expected[nearest[r].entity - 1]);
+
+        wq.raycastAll(rays[r], hits);
+        CHECK_EQUAL(count, hits.size());
+        for (unsigned i=1; i<hits.size(); i++)
+            CHECK(hits[i - 1].t <= hits[i].t);
+    }
+
+    // overlaps
+    std::vector<uint8_t> overlaps(all.count);
+    std::vector<Entity> found;
+    for (int i=0; i<50; i++) {
+        AABB aabb;
+        aabb.left = Random::Float(generator, -60, 50);
+        aabb.right = aabb.left + Random::Float(generator, 0, 20);
+        aabb.bottom = Random::Float(generator, -60, 50);
+        aabb.top = aabb.bottom + Random::Float(generator, 0, 20);
+        IntersectionUtil::rectangleRectangles(
+            glm::vec2((aabb.left + aabb.right) * 0.5f, (aabb.bottom + aabb.top) * 0.5f),
+            glm::vec2(aabb.right - aabb.left, aabb.top - aabb.bottom), 0,
+            all, &overlaps[0]);
+
+        wq.overlapAABB(aabb, 1, found);
+        CHECK_EQUAL((long)std::count(overlaps.begin(), overlaps.end(), 1), (long)found.size());
+        for (auto e: found)
+            CHECK(overlaps[e - 1]);
+    }
+}
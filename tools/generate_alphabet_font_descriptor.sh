@@ -37,7 +37,8 @@ export SAC_EXAMPLE="$0 $(cd $rootPath && pwd)/unprepared_assets/alphabet typo"
 
 ######### 1 : Process. #########
 output=$rootPath/assets/typo.font
-rm -f $output
+# a stale binary version would be used instead of the new text one
+rm -f $output $rootPath/assets/typo.cfont
 
 function write {
     echo $@ >> $output
@@ -56,5 +57,13 @@ for i in $(ls *_typo.png); do
 	height=$(echo $size | cut -dx -f2)
 	write "$c=$width,$height"
 done
+
+# binary version, used in priority by the engine
+if check_package texture_packer "sac binary! (build/ directory)" DONT_EXIT; then
+    info "Compiling font descriptor.."
+    texture_packer --compile $output || error_and_quit "Font descriptor compilation failed"
+else
+    info "texture_packer missing: assets/typo.cfont not generated" $orange
+fi
 info "Do not forget to generate the atlas too!" $orange
 info "Done!"
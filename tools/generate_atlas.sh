@@ -16,7 +16,8 @@ source $whereAmI/cool_stuff.sh
 export SAC_USAGE="$0 image_folder1 image_folder2 image..."
 export SAC_OPTIONS="\
 --q|--quality (hdpi / mdpi / ldpi): atlas to build.
-\tNote: you can use * for listing directories."
+\tNote: you can use * for listing directories.
+--j|--jobs count: worker threads (default: one per core)"
 export SAC_EXAMPLE="${green}$0 unprepared_assets/logo --a \"hdpi mdpi\""
 
 if [ $# = 0 ]; then
@@ -26,27 +27,9 @@ fi
 ############# STEP 0: verify env and args
 check_package_in_PATH "texture_packer" "sac binary! (build/ directory)"
 
-if ! $(python -c "import PIL" &> /dev/null); then
-    check_package "python-pil"
-fi
-
-hasetc1tool=false
-if check_package_in_PATH etc1tool '$ANDROID_HOME/tools/' DONT_EXIT; then
-    dpis="hdpi mdpi ldpi"
-    hasetc1tool=true
-else
-    info "Warning: etc1tool not found -> compressed format won't be created" $orange
-    dpis="hdpi"
-fi
-# check if etc1tool works (32bit available)
-if ((hasetc1tool == true )); then
-    etc1tool --help 2>/dev/null
-    if (($? == 127 )); then
-        info "Warning: etc1tool does'nt work. Check if multiarch is installed (and libc6:i386, libz1:i386 and libstdc++6:i386 too)" $orange
-        dpis="hdpi"
-        hasetc1tool=false
-    fi
-fi
+# ETC1 encoding is done by texture_packer itself
+dpis="hdpi mdpi ldpi"
+jobs=0
 
 hasNVTool=false
 if check_package nvcompress 'https://code.google.com/p/nvidia-texture-tools/ then $BUILD/src/nvtt/tools/' DONT_EXIT; then
@@ -62,6 +45,10 @@ while [ "$1" != "" ]; do
             shift
             dpis="$1"
             ;;
+        "--j" | "--jobs")
+            shift
+            jobs="$1"
+            ;;
         *)
             directories+=($1)
     esac
@@ -71,13 +58,15 @@ done
 info "Setup #0 done: will build '${dpis}' atlas."
 
 ############# STEP 1: process
+# texture_packer keeps its processed images there, so unchanged images
+# are not processed again by the next run
+WORK_FOLDER=${TMPDIR:-/tmp}/sac_atlas_$(id -u)
 current=0
 tcount=${#directories[@]}
 for directory_path in "${directories[@]}"; do
     dir=$(basename $directory_path)
     current=$(expr $current + 1)
     info "Treating atlas $dir at path $directory_path... ($current / $tcount - $(expr $current \* 100 / $tcount )%)"
-    TEMP_FOLDER=$(mktemp)
 
     if [ ! -d "$directory_path" ]; then
         error_and_quit "Directory $directory_path does not exist!"
@@ -88,105 +77,48 @@ for directory_path in "${directories[@]}"; do
 
     divide_by=1
 
-    TMP_FILEDIR=$(mktemp)
     for quality in ${dpis}; do
         info "Generate $quality atlas"
+        work=$WORK_FOLDER/$quality
+        mkdir -p $work $outPath/assets/$quality
+
+        ############# SUBSTEP 1: trim, pack, compose, premultiply, split alpha and encode ETC1
+        # optional groups.txt: images drawn together, one group per line
+        info "Substep #1: build atlas (in $work)"
+        groups=""
+        if [ -f "$directory_path/groups.txt" ]; then
+            groups="--groups $directory_path/groups.txt"
+        fi
+        if ! texture_packer --atlas $dir --output $work --divide-by $divide_by \
+            --etc1 --incremental --jobs $jobs $groups $directory_path/*.png; then
+            error_and_quit "texture_packer failed on $dir! Aborting"
+        fi
 
-        ############# SUBSTEP 1: preparation
-        info "Substep #1: prepare temp folder ($TEMP_FOLDER)"
-        rm -rf $TEMP_FOLDER 2>/dev/null
-        mkdir $TEMP_FOLDER
-
-        rm -rf $TMP_FILEDIR 2>/dev/null
-        mkdir $TMP_FILEDIR/$quality -p
-        mkdir $TMP_FILEDIR/tmp -p
-
-        mkdir $outPath/assets/$quality -p
-
-        find $outPath/assets/${quality}/ -name "${dir}*" -exec rm {} \;
         find $outPath/assets/${quality}/ -name "${dir}*" -exec rm {} \;
-
-        ############# SUBSTEP 2: create an optimized copy of each image
-        info "Substep #2: create optimized image"
-        for file in $(cd $directory_path && ls *.png); do
-            width=$(identify -format "%w" $directory_path/$file)
-            scale=$(($width/$divide_by))
-            convert $directory_path/$file -scale $scale PNG32:$TMP_FILEDIR/$file
-        done
-        for file in $(cd $TMP_FILEDIR && ls *.png); do
-            info "\tOptimizing $file..." $blue
-            used_rect=$($whereAmI/texture_packer/tiniest_rectangle.py $TMP_FILEDIR/${file})
-
-            if [ $? != 0 ]; then
-                error_and_quit "Script encountered an error with file $file! Aborting"
+        # one atlas per page: $dir, ${dir}_page1, ...
+        for page in $work/$dir.atlas $work/${dir}_page[0-9]*.atlas; do
+            if [ ! -f "$page" ]; then
+                continue
             fi
-
-            ww=$(echo $used_rect | cut -d, -f1)
-            hh=$(echo $used_rect | cut -d, -f2)
-            xx=$(echo $used_rect | cut -d, -f3)
-            yy=$(echo $used_rect | cut -d, -f4)
-
-            if (! convert -crop ${ww}x${hh}+${xx}+${yy} +repage $TMP_FILEDIR/$file PNG32:$TEMP_FOLDER/${file}); then
-                error_and_quit "Error when converting $file!"
+            page=$(basename $page .atlas)
+            # .catlas: binary version of .atlas, used in priority by the engine
+            cp $work/$page.atlas $work/$page.catlas $work/$page.pkm.* $work/${page}_alpha.pkm.* $outPath/assets/$quality/
+
+            if $hasNVTool ; then
+                info "Substep #2a: create DDS version of $page color texture"
+                nvcompress -bc1 -color -nomips -silent $work/${page}.png $work/$page.dds
+                # PVRTexToolCL ignore name extension
+                split -d -b 1024K $work/$page.dds $outPath/assets/$quality/$page.dds.
+
+                info "Substep #2b: create DDS version of $page alpha texture"
+                nvcompress -bc1 -color -nomips -silent $work/${page}_alpha.png $work/${page}_alpha.dds
+                # PVRTexToolCL ignore name extension
+                split -d -b 1024K $work/${page}_alpha.dds $outPath/assets/$quality/${page}_alpha.dds.
             fi
-
         done
 
-        ############# SUBSTEP 3: fit all image in one texture
-        # Remark: we feed texture_packer with optimized (cropped) images
-        info "Substep #3: compute atlas placement"
-        optimized_image_list=$(echo $TEMP_FOLDER/*png)
-
-        ############# SUBSTEP 4: place image in atlas
-        # Remark: we first cd into original image folder
-        info "Substep #4: compose atlas using individual images coords"
-        cd $TMP_FILEDIR
-        texture_packer $optimized_image_list | $whereAmI/texture_packer/texture_packer.sh $dir
-        cd - 1>/dev/null
-
-        ############# SUBSTEP 5: create png version of the atlas
-        info "Substep #5: create png version"
-        # Pre-multiplied alpha version
-        convert /tmp/$dir.png \( +clone -alpha Extract \) -channel RGB -compose Multiply -composite /tmp/$dir.png
-        # Alpha only image
-        convert /tmp/$dir.png -alpha extract PNG24:/tmp/${dir}_alpha.png
-        # Color only image
-        convert /tmp/$dir.png -background white -alpha off -type TrueColor PNG24:/tmp/$dir.png
-
-
-        if $hasetc1tool ; then
-            info "Substep #6a: create ETC version of color texture"
-            etc1tool --encode /tmp/$dir.png -o ${TMP_FILEDIR}/tmp/$dir-$quality.pkm
-            # PVRTexToolCL ignore name extension
-            split -d -b 1024K ${TMP_FILEDIR}/tmp/$dir-$quality.pkm ${TMP_FILEDIR}/$quality/$dir.pkm.
-
-            info "Substep #6b: create ETC version of alpha texture"
-            etc1tool --encode /tmp/${dir}_alpha.png -o ${TMP_FILEDIR}/tmp/${dir}_alpha-$quality.pkm
-            # PVRTexToolCL ignore name extension
-            split -d -b 1024K ${TMP_FILEDIR}/tmp/${dir}_alpha-$quality.pkm ${TMP_FILEDIR}/$quality/${dir}_alpha.pkm.
-        fi
-
-        if $hasNVTool ; then
-            info "Substep #7a: create DDS version of color texture"
-            nvcompress -bc1 -color -nomips -silent /tmp/${dir}.png ${TMP_FILEDIR}/tmp/$dir-$quality.dds
-            # PVRTexToolCL ignore name extension
-            split -d -b 1024K ${TMP_FILEDIR}/tmp/$dir-$quality.dds ${TMP_FILEDIR}/$quality/$dir.dds.
-
-            info "Substep #7b: create DDS version of alpha texture"
-            nvcompress -bc1 -color -nomips -silent /tmp/${dir}_alpha.png ${TMP_FILEDIR}/tmp/${dir}_alpha-$quality.dds
-            # PVRTexToolCL ignore name extension
-            split -d -b 1024K ${TMP_FILEDIR}/tmp/${dir}_alpha-$quality.dds ${TMP_FILEDIR}/$quality/${dir}_alpha.dds.
-        fi
-
-        cp -rv ${TMP_FILEDIR}/$quality $outPath/assets
-        cp /tmp/$dir.atlas $outPath/assets/$quality/
-
-        rm -r $TEMP_FOLDER/*
         divide_by=$(($divide_by * 2))
     done
 done
 
-rm -r $TEMP_FOLDER
-
 info "Cya!"
-
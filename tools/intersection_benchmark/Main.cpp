@@ -0,0 +1,172 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+// Micro-benchmark of the batched IntersectionUtil tests (rectangleRectangles,
+// rectanglesAABB, lineRectangles) against the equivalent loop of scalar
+// tests, for several batch sizes. Prints the results as JSON on stdout.
+//
+// Usage: intersection_benchmark [tests per measure (millions)]
+
+#include "base/Log.h"
+#include "base/TimeUtil.h"
+
+#include "systems/TransformationSystem.h"
+#include "util/IntersectionUtil.h"
+#include "util/Random.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+struct Result {
+    const char* test;
+    unsigned batchSize;
+    // million of tests per second
+    float scalar, batched;
+};
+
+struct Scene {
+    std::vector<TransformationComponent> rects;
+    RectangleBatch batch;
+    std::vector<uint8_t> hits;
+    std::vector<float> t;
+};
+
+static void createScene(Scene& scene, unsigned count) {
+    std::mt19937 generator(count);
+    for (unsigned i=0; i<count; i++) {
+        TransformationComponent tc;
+        tc.position = glm::vec2(Random::Float(generator, -10, 10), Random::Float(generator, -10, 10));
+        tc.size = glm::vec2(Random::Float(generator, 0.2, 2), Random::Float(generator, 0.2, 2));
+        tc.rotation = Random::Float(generator, -3, 3);
+        scene.rects.push_back(tc);
+        scene.batch.add(tc.position, tc.size, tc.rotation);
+    }
+    scene.hits.resize(count);
+    scene.t.resize(count);
+}
+
+// runs 'f' (testing the whole scene) until 'testCount' tests are done and
+// returns the throughput in millions of tests per second
+template <class F>
+static float measure(const Scene& scene, unsigned testCount, int* checksum, F f) {
+    const unsigned iterations = glm::max(1u, testCount / (unsigned)scene.rects.size());
+    const float before = TimeUtil::GetTime();
+    for (unsigned i=0; i<iterations; i++) {
+        *checksum += f(i);
+    }
+    const float duration = TimeUtil::GetTime() - before;
+    return (iterations * scene.rects.size()) / (duration * 1000000);
+}
+
+static void run(std::vector<Result>& results, unsigned count, unsigned testCount, int* checksum) {
+    Scene scene;
+    createScene(scene, count);
+
+    const glm::vec2 aPos(1, -2), aSize(3, 2);
+    const float aRot = 0.3f;
+    const AABB area = { -5, 5, 4, -4 };
+
+    Result r;
+    r.batchSize = count;
+
+    r.test = "rectangle_rectangles";
+    r.scalar = measure(scene, testCount, checksum, [&] (unsigned) -> int {
+        int hits = 0;
+        for (const auto& tc: scene.rects) {
+            hits += IntersectionUtil::rectangleRectangle(aPos, aSize, aRot, tc.position, tc.size, tc.rotation);
+        }
+        return hits;
+    });
+    r.batched = measure(scene, testCount, checksum, [&] (unsigned) -> int {
+        IntersectionUtil::rectangleRectangles(aPos, aSize, aRot, scene.batch, const_cast<uint8_t*>(&scene.hits[0]));
+        return scene.hits[0];
+    });
+    results.push_back(r);
+
+    r.test = "rectangles_aabb";
+    r.scalar = measure(scene, testCount, checksum, [&] (unsigned) -> int {
+        int hits = 0;
+        for (const auto& tc: scene.rects) {
+            AABB aabb;
+            IntersectionUtil::computeAABB(&tc, aabb);
+            hits += IntersectionUtil::rectangleRectangleAABB(area, aabb);
+        }
+        return hits;
+    });
+    r.batched = measure(scene, testCount, checksum, [&] (unsigned) -> int {
+        IntersectionUtil::rectanglesAABB(area, scene.batch, const_cast<uint8_t*>(&scene.hits[0]));
+        return scene.hits[0];
+    });
+    results.push_back(r);
+
+    r.test = "line_rectangles";
+    r.scalar = measure(scene, testCount, checksum, [&] (unsigned i) -> int {
+        const glm::vec2 p2(10 * glm::cos(i * 0.1f), 10 * glm::sin(i * 0.1f));
+        // a segment through a corner crosses 2 edges there
+        glm::vec2 intersections[4];
+        int hits = 0;
+        for (const auto& tc: scene.rects) {
+            hits += IntersectionUtil::lineRectangle(glm::vec2(0.0f), p2, tc.position, tc.size, tc.rotation, intersections);
+        }
+        return hits;
+    });
+    r.batched = measure(scene, testCount, checksum, [&] (unsigned i) -> int {
+        const glm::vec2 p2(10 * glm::cos(i * 0.1f), 10 * glm::sin(i * 0.1f));
+        IntersectionUtil::lineRectangles(glm::vec2(0.0f), p2, scene.batch, const_cast<float*>(&scene.t[0]));
+        return scene.t[0] < 1;
+    });
+    results.push_back(r);
+}
+
+int main(int argc, char** argv) {
+    TimeUtil::Init();
+#if SAC_ENABLE_LOG
+    logLevel = LogVerbosity::ERROR;
+#endif
+    // lineRectangle uses the square shape
+    TransformationSystem::CreateInstance();
+
+    const unsigned testCount = ((argc > 1) ? glm::max(1, atoi(argv[1])) : 4) * 1000000;
+    const unsigned sizes[] = { 16, 256, 4096 };
+
+    std::vector<Result> results;
+    // prevents the tests from being optimized away
+    int checksum = 0;
+    for (unsigned size: sizes) {
+        run(results, size, testCount, &checksum);
+    }
+
+    printf("{\n  \"checksum\": %d,\n  \"results\": [\n", checksum);
+    for (unsigned i=0; i<results.size(); i++) {
+        const Result& r = results[i];
+        printf("    {\"test\": \"%s\", \"batch_size\": %u, "
+            "\"mtests_per_s\": {\"scalar\": %.2f, \"batched\": %.2f}, \"speedup\": %.2f}%s\n",
+            r.test, r.batchSize, r.scalar, r.batched, r.batched / r.scalar,
+            (i + 1 < results.size()) ? "," : "");
+    }
+    printf("  ]\n}\n");
+
+    TransformationSystem::DestroyInstance();
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+// Headless benchmark of emitter-heavy scenes: 0 to 3 particule emitters,
+// at several emission rates. Measures ParticuleSystem, PhysicsSystem and
+// RenderingSystem update duration, entity churn and heap allocations per
+// frame and prints the results as JSON on stdout.
+//
+// Usage: particule_benchmark [frame count]
+
+#include "base/EntityManager.h"
+#include "base/Log.h"
+#include "base/TimeUtil.h"
+
+#include "systems/CameraSystem.h"
+#include "systems/ParticuleSystem.h"
+#include "systems/PhysicsSystem.h"
+#include "systems/RenderingSystem.h"
+#include "systems/TransformationSystem.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// count every heap allocation done by the process
+static unsigned long allocationCount = 0;
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+static const float FrameDuration = 1.0f / 60;
+// enough frames to reach the steady state (lifetime is at most 2s)
+static const int WarmupFrameCount = 150;
+
+struct Result {
+    int emitters;
+    float emissionRate;
+    int frames;
+    float particules;
+    float entities;
+    float churn;
+    float allocations;
+    float particuleMs, physicsMs, renderingMs;
+};
+
+static void createSystems() {
+    TransformationSystem::CreateInstance();
+    CameraSystem::CreateInstance();
+    PhysicsSystem::CreateInstance();
+    ParticuleSystem::CreateInstance();
+    RenderingSystem::CreateInstance();
+    // no GL context: don't use setWindowSize
+    theRenderingSystem.windowW = 800;
+    theRenderingSystem.windowH = 600;
+    theRenderingSystem.screenW = 20;
+    theRenderingSystem.screenH = 15;
+}
+
+static void destroySystems() {
+    theEntityManager.deleteAllEntities();
+    RenderingSystem::DestroyInstance();
+    ParticuleSystem::DestroyInstance();
+    PhysicsSystem::DestroyInstance();
+    CameraSystem::DestroyInstance();
+    TransformationSystem::DestroyInstance();
+}
+
+// returns the update duration of the system (in ms)
+static float timedUpdate(ComponentSystem& system) {
+    const float before = TimeUtil::GetTime();
+    system.Update(FrameDuration);
+    return (TimeUtil::GetTime() - before) * 1000;
+}
+
+static void step(Result* r = 0) {
+    const float particuleMs = timedUpdate(theParticuleSystem);
+    const float physicsMs = timedUpdate(thePhysicsSystem);
+    theTransformationSystem.Update(FrameDuration);
+    theCameraSystem.Update(FrameDuration);
+    const float renderingMs = timedUpdate(theRenderingSystem);
+
+    if (r) {
+        r->particuleMs += particuleMs;
+        r->physicsMs += physicsMs;
+        r->renderingMs += renderingMs;
+    }
+}
+
+static Result run(int emitterCount, float emissionRate, int frameCount) {
+    createSystems();
+
+    Entity camera = theEntityManager.CreateEntity(HASH("benchmark/camera", 0x80eb9a1a));
+    ADD_COMPONENT(camera, Transformation);
+    ADD_COMPONENT(camera, Camera);
+    TRANSFORM(camera)->size = glm::vec2(20, 15);
+    CAMERA(camera)->enable = true;
+
+    for (int i=0; i<emitterCount; i++) {
+        Entity e = theEntityManager.CreateEntity(HASH("benchmark/emitter", 0xefca72fd));
+        ADD_COMPONENT(e, Transformation);
+        ADD_COMPONENT(e, Particule);
+        TRANSFORM(e)->position = glm::vec2(-5.0f + 5.0f * i, 0);
+        TRANSFORM(e)->size = glm::vec2(1.0f);
+        ParticuleComponent* pc = PARTICULE(e);
+        pc->emissionRate = emissionRate;
+        pc->duration = -1;
+        pc->lifetime = Interval<float>(1, 2);
+        pc->initialColor = Interval<Color>(Color(1, 1, 1, 1), Color(1, 0.5, 0, 1));
+        pc->finalColor = Interval<Color>(Color(1, 0, 0, 0));
+        pc->initialSize = Interval<float>(0.2f, 0.4f);
+        pc->finalSize = Interval<float>(0.05f);
+        pc->forceDirection = Interval<float>(0, 3.14f);
+        pc->forceAmplitude = Interval<float>(50, 100);
+        pc->moment = Interval<float>(-1, 1);
+        pc->mass = 1;
+        pc->gravity = glm::vec2(0, -10);
+        pc->renderingFlags = RenderingFlags::NonOpaque;
+    }
+
+    for (int i=0; i<WarmupFrameCount; i++) {
+        step();
+    }
+
+    Result r;
+    r.emitters = emitterCount;
+    r.emissionRate = emissionRate;
+    r.frames = frameCount;
+    r.particules = r.entities = 0;
+    r.particuleMs = r.physicsMs = r.renderingMs = 0;
+
+    const unsigned churnBefore = theEntityManager.createdEntityCount + theEntityManager.deletedEntityCount;
+    const unsigned long allocationsBefore = allocationCount;
+    for (int i=0; i<frameCount; i++) {
+        step(&r);
+        r.particules += theParticuleSystem.particuleCount();
+        r.entities += theEntityManager.getNumberofEntity();
+    }
+    const float invFrameCount = 1.0f / frameCount;
+    r.allocations = (allocationCount - allocationsBefore) * invFrameCount;
+    r.churn = (theEntityManager.createdEntityCount + theEntityManager.deletedEntityCount - churnBefore) * invFrameCount;
+    r.particules *= invFrameCount;
+    r.entities *= invFrameCount;
+    r.particuleMs *= invFrameCount;
+    r.physicsMs *= invFrameCount;
+    r.renderingMs *= invFrameCount;
+
+    destroySystems();
+    return r;
+}
+
+int main(int argc, char** argv) {
+    TimeUtil::Init();
+    EntityManager::CreateInstance();
+#if SAC_ENABLE_LOG
+    logLevel = LogVerbosity::ERROR;
+#endif
+
+    const int frameCount = (argc > 1) ? glm::max(1, atoi(argv[1])) : 600;
+    const float rates[] = { 50, 200, 1000 };
+
+    std::vector<Result> results;
+    results.push_back(run(0, 0, frameCount));
+    for (int emitters=1; emitters<=3; emitters++) {
+        for (float rate: rates) {
+            results.push_back(run(emitters, rate, frameCount));
+        }
+    }
+
+    printf("{\n  \"frame_duration\": %f,\n  \"scenarios\": [\n", FrameDuration);
+    for (unsigned i=0; i<results.size(); i++) {
+        const Result& r = results[i];
+        printf("    {\"emitters\": %d, \"emission_rate\": %.0f, \"frames\": %d, "
+            "\"particules\": %.1f, \"entities\": %.1f, "
+            "\"entity_churn_per_frame\": %.2f, \"allocations_per_frame\": %.2f, "
+            "\"update_ms\": {\"particule\": %.4f, \"physics\": %.4f, \"rendering\": %.4f}}%s\n",
+            r.emitters, r.emissionRate, r.frames,
+            r.particules, r.entities,
+            r.churn, r.allocations,
+            r.particuleMs, r.physicsMs, r.renderingMs,
+            (i + 1 < results.size()) ? "," : "");
+    }
+    printf("  ]\n}\n");
+
+    EntityManager::DestroyInstance();
+    return 0;
+}
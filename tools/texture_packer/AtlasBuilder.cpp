@@ -0,0 +1,608 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "AtlasBuilder.h"
+#include "PngIO.h"
+#include "MaxRectsPacker.h"
+#include "DescriptorCompiler.h"
+
+#include <base/Log.h>
+#include <base/TimeUtil.h>
+#include <util/WorkerPool.h>
+#include <util/CompiledAssets.h>
+#include <rg_etc1.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+struct Rect {
+    Rect(int px = 0, int py = 0, int pw = 0, int ph = 0) : x(px), y(py), w(pw), h(ph) {}
+    int x, y, w, h;
+};
+
+// Extra opaque rects must cover this part of the sprite, and this many
+// pixels: each one costs a draw command at runtime
+static const float MinExtraOpaqueRatio = 0.05f;
+static const int MinExtraOpaqueArea = 64;
+
+struct Sprite {
+    std::string path, name;
+    // source file stamp, used by incremental builds
+    int64_t sourceSize, sourceMtime;
+    // size after downscaling, before cropping
+    int originalWidth, originalHeight;
+    // used area of the downscaled image
+    Rect crop;
+    // disjoint fully opaque rectangles, biggest first, in cropped image coordinates
+    Rect opaque[CompiledAtlas::MaxOpaqueRects];
+    int opaqueCount;
+    // cropped pixels
+    Image image;
+    // group index in the groups file, -1 if none
+    int group;
+    // placement in atlas page (w/h are swapped if rotated)
+    int page;
+    Rect placement;
+    bool rotated;
+    bool fromCache;
+};
+
+// Processed sprite cache file content: header followed by the RGBA pixels
+struct SpriteCacheHeader {
+    char magic[4];
+    uint32_t version;
+    int64_t sourceSize, sourceMtime;
+    int32_t divideBy, originalWidth, originalHeight;
+    Rect crop, opaque[CompiledAtlas::MaxOpaqueRects];
+    int32_t opaqueCount;
+};
+static const uint32_t SpriteCacheVersion = 2;
+
+static std::string baseName(const std::string& path) {
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    const size_t ext = name.rfind(".png");
+    return (ext == std::string::npos) ? name : name.substr(0, ext);
+}
+
+static bool fileExists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static bool createDirectories(const std::string& path) {
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+        const std::string dir = path.substr(0, pos);
+        if (!fileExists(dir) && mkdir(dir.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) != 0) {
+            LOGE("Can't create directory " << dir);
+            return false;
+        }
+        if (pos == std::string::npos)
+            return true;
+    }
+}
+
+// Box filter, weighting colors by alpha to avoid dark fringes
+static Image downscale(const Image& src, int factor) {
+    if (factor <= 1)
+        return src;
+    Image dst(std::max(1, src.width / factor), std::max(1, src.height / factor), 4);
+    for (int y = 0; y < dst.height; y++) {
+        for (int x = 0; x < dst.width; x++) {
+            unsigned rgb[3] = { 0, 0, 0 }, alpha = 0, count = 0;
+            for (int j = y * factor; j < std::min(src.height, (y + 1) * factor); j++) {
+                for (int i = x * factor; i < std::min(src.width, (x + 1) * factor); i++) {
+                    const uint8_t* p = src.pixel(i, j);
+                    for (int c = 0; c < 3; c++)
+                        rgb[c] += p[c] * p[3];
+                    alpha += p[3];
+                    count++;
+                }
+            }
+            uint8_t* p = dst.pixel(x, y);
+            for (int c = 0; c < 3; c++)
+                p[c] = alpha ? (rgb[c] + alpha / 2) / alpha : 0;
+            p[3] = (alpha + count / 2) / count;
+        }
+    }
+    return dst;
+}
+
+// Smallest rectangle containing every non transparent pixel
+static Rect usedRect(const Image& image) {
+    int minX = image.width, minY = image.height, maxX = -1, maxY = -1;
+    for (int y = 0; y < image.height; y++) {
+        for (int x = 0; x < image.width; x++) {
+            if (image.pixel(x, y)[3]) {
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+            }
+        }
+    }
+    // fully transparent image: keep a single pixel
+    if (maxX < 0)
+        return Rect(0, 0, 1, 1);
+    return Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+}
+
+static Image crop(const Image& src, const Rect& r) {
+    Image dst(r.w, r.h, src.channels);
+    for (int y = 0; y < r.h; y++)
+        memcpy(dst.pixel(0, y), src.pixel(r.x, r.y + y), r.w * src.channels);
+    return dst;
+}
+
+// Largest rectangle of non zero mask values: for each row, solve
+// 'largest rectangle in histogram' on the column heights
+static Rect largestRect(const std::vector<uint8_t>& mask, int width, int height) {
+    Rect best;
+    std::vector<int> heights(width + 1, 0);
+    std::vector<int> stack;
+    for (int y = 0; y < height; y++) {
+        // branchless: vectorized by the compiler
+        const uint8_t* row = &mask[y * width];
+        for (int x = 0; x < width; x++)
+            heights[x] = (heights[x] + 1) * row[x];
+
+        stack.clear();
+        for (int x = 0; x <= width; x++) {
+            while (!stack.empty() && heights[stack.back()] >= heights[x]) {
+                const int h = heights[stack.back()];
+                stack.pop_back();
+                const int left = stack.empty() ? 0 : stack.back() + 1;
+                if (h * (x - left) > best.w * best.h)
+                    best = Rect(left, y - h + 1, x - left, h);
+            }
+            stack.push_back(x);
+        }
+    }
+    return best;
+}
+
+// Greedily pick the largest opaque rectangle, then the largest one among
+// the remaining opaque pixels, and so on: rects are disjoint
+static int findOpaqueRects(const Image& image, Rect* out) {
+    std::vector<uint8_t> mask(image.width * image.height);
+    for (int i = 0; i < image.width * image.height; i++)
+        mask[i] = (image.pixels[i * 4 + 3] == 255);
+
+    const int minArea = std::max(MinExtraOpaqueArea, (int)(MinExtraOpaqueRatio * image.width * image.height));
+    int count = 0;
+    while (count < CompiledAtlas::MaxOpaqueRects) {
+        const Rect r = largestRect(mask, image.width, image.height);
+        if (r.w * r.h == 0 || (count > 0 && r.w * r.h < minArea))
+            break;
+        out[count++] = r;
+        for (int y = r.y; y < r.y + r.h; y++)
+            memset(&mask[y * image.width + r.x], 0, r.w);
+    }
+    return count;
+}
+
+static std::string cacheDirectory(const AtlasBuilder::Options& options) {
+    return options.outputDir + "/.texture_packer/" + options.name;
+}
+
+static bool loadCachedSprite(const std::string& path, int divideBy, Sprite& sprite) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    SpriteCacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+        !memcmp(header.magic, "SACS", 4) &&
+        header.version == SpriteCacheVersion &&
+        header.sourceSize == sprite.sourceSize &&
+        header.sourceMtime == sprite.sourceMtime &&
+        header.divideBy == divideBy;
+    if (valid) {
+        sprite.originalWidth = header.originalWidth;
+        sprite.originalHeight = header.originalHeight;
+        sprite.crop = header.crop;
+        sprite.opaqueCount = std::min((int)header.opaqueCount, CompiledAtlas::MaxOpaqueRects);
+        std::copy(header.opaque, header.opaque + CompiledAtlas::MaxOpaqueRects, sprite.opaque);
+        sprite.image = Image(header.crop.w, header.crop.h, 4);
+        valid = fread(&sprite.image.pixels[0], sprite.image.pixels.size(), 1, file) == 1;
+    }
+    fclose(file);
+    return valid;
+}
+
+static void saveCachedSprite(const std::string& path, int divideBy, const Sprite& sprite) {
+    SpriteCacheHeader header;
+    memcpy(header.magic, "SACS", 4);
+    header.version = SpriteCacheVersion;
+    header.sourceSize = sprite.sourceSize;
+    header.sourceMtime = sprite.sourceMtime;
+    header.divideBy = divideBy;
+    header.originalWidth = sprite.originalWidth;
+    header.originalHeight = sprite.originalHeight;
+    header.crop = sprite.crop;
+    std::copy(sprite.opaque, sprite.opaque + CompiledAtlas::MaxOpaqueRects, header.opaque);
+    header.opaqueCount = sprite.opaqueCount;
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file ||
+        fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(&sprite.image.pixels[0], sprite.image.pixels.size(), 1, file) != 1) {
+        LOGW("Can't write sprite cache " << path);
+    }
+    if (file)
+        fclose(file);
+}
+
+static bool processSprite(const AtlasBuilder::Options& options, Sprite& sprite) {
+    struct stat st;
+    if (stat(sprite.path.c_str(), &st) != 0) {
+        LOGE(sprite.path << " not found");
+        return false;
+    }
+    sprite.sourceSize = st.st_size;
+    sprite.sourceMtime = st.st_mtime;
+
+    const std::string cachePath = cacheDirectory(options) + "/" + sprite.name + ".sprite";
+    if (options.incremental && loadCachedSprite(cachePath, options.divideBy, sprite)) {
+        sprite.fromCache = true;
+        return true;
+    }
+
+    Image source;
+    if (!PngIO::load(sprite.path, source))
+        return false;
+    source = downscale(source, options.divideBy);
+    sprite.originalWidth = source.width;
+    sprite.originalHeight = source.height;
+    sprite.crop = usedRect(source);
+    sprite.image = crop(source, sprite.crop);
+    sprite.opaqueCount = findOpaqueRects(sprite.image, sprite.opaque);
+
+    if (options.incremental)
+        saveCachedSprite(cachePath, options.divideBy, sprite);
+    return true;
+}
+
+// Returns the pages, empty if an image doesn't fit
+static std::vector<MaxRectsPacker::Page> pack(std::vector<Sprite>& sprites, int maxSize) {
+    std::vector<MaxRectsPacker::Input> inputs(sprites.size());
+    for (unsigned i = 0; i < sprites.size(); i++) {
+        inputs[i].width = sprites[i].crop.w;
+        inputs[i].height = sprites[i].crop.h;
+        inputs[i].group = sprites[i].group;
+    }
+    // 1 pixel padding for the border added by blit()
+    MaxRectsPacker packer(maxSize, 1);
+    if (!packer.pack(inputs))
+        return std::vector<MaxRectsPacker::Page>();
+
+    for (unsigned i = 0; i < sprites.size(); i++) {
+        const MaxRectsPacker::Placement& p = packer.placements()[i];
+        sprites[i].page = p.page;
+        sprites[i].placement = Rect(p.x, p.y, p.width, p.height);
+        sprites[i].rotated = p.rotated;
+    }
+    return packer.pages();
+}
+
+// Groups file: one group per line, made of space separated image names
+// (without extension). Images of a group are drawn together, so they
+// are put in the same page when possible.
+static bool readGroups(const std::string& path, std::vector<Sprite>& sprites, std::string& content) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        LOGE("Can't read groups file " << path);
+        return false;
+    }
+    std::string line;
+    for (int group = 0; std::getline(in, line); group++) {
+        content += line + '\n';
+        std::stringstream ss(line);
+        std::string name;
+        while (ss >> name) {
+            for (auto& s : sprites) {
+                if (s.name == name)
+                    s.group = group;
+            }
+        }
+    }
+    return true;
+}
+
+static std::string pageName(const AtlasBuilder::Options& options, unsigned page) {
+    std::stringstream ss;
+    ss << options.outputDir << '/' << options.name;
+    if (page > 0)
+        ss << "_page" << page;
+    return ss.str();
+}
+
+// Copy the sprite and a 1 pixel border made of its edge pixels,
+// so bilinear filtering doesn't blend with neighbours. Borders of
+// different sprites never overlap (see pack() padding)
+static void blit(Image& atlas, const Sprite& sprite) {
+    const Rect& r = sprite.placement;
+    const Image& src = sprite.image;
+    for (int dy = -1; dy <= r.h; dy++) {
+        const int ay = r.y + dy;
+        if (ay < 0 || ay >= atlas.height)
+            continue;
+        const int ty = std::min(std::max(dy, 0), r.h - 1);
+        for (int dx = -1; dx <= r.w; dx++) {
+            const int ax = r.x + dx;
+            if (ax < 0 || ax >= atlas.width)
+                continue;
+            const int tx = std::min(std::max(dx, 0), r.w - 1);
+            // rotated sprites are turned 90 degrees clockwise
+            const uint8_t* p = sprite.rotated ? src.pixel(ty, src.height - 1 - tx) : src.pixel(tx, ty);
+            memcpy(atlas.pixel(ax, ay), p, 4);
+        }
+    }
+}
+
+static void writeBE16(uint8_t* out, unsigned value) {
+    out[0] = (value >> 8) & 0xff;
+    out[1] = value & 0xff;
+}
+
+// PKM file content, blocks encoded in parallel
+static std::vector<uint8_t> encodeEtc1(const Image& image, WorkerPool& pool) {
+    const int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+    std::vector<uint8_t> pkm(16 + blocksX * blocksY * 8);
+    memcpy(&pkm[0], "PKM 10", 6);
+    // format: ETC1_RGB_NO_MIPMAPS
+    writeBE16(&pkm[6], 0);
+    writeBE16(&pkm[8], blocksX * 4);
+    writeBE16(&pkm[10], blocksY * 4);
+    writeBE16(&pkm[12], image.width);
+    writeBE16(&pkm[14], image.height);
+
+    pool.parallelFor(blocksY, 1, [&image, &pkm, blocksX] (unsigned begin, unsigned end) -> void {
+        rg_etc1::etc1_pack_params params;
+        params.m_quality = rg_etc1::cMediumQuality;
+        unsigned int block[16];
+        for (unsigned by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                for (int i = 0; i < 16; i++) {
+                    // partial blocks repeat the last row/column
+                    const uint8_t* p = image.pixel(
+                        std::min(bx * 4 + (i % 4), image.width - 1),
+                        std::min((int)by * 4 + (i / 4), image.height - 1));
+                    uint8_t* rgba = (uint8_t*) &block[i];
+                    rgba[0] = p[0];
+                    rgba[1] = p[1];
+                    rgba[2] = p[2];
+                    rgba[3] = 255;
+                }
+                rg_etc1::pack_etc1_block(&pkm[16 + (by * blocksX + bx) * 8], block, params);
+            }
+        }
+    });
+    return pkm;
+}
+
+// Written as 1MB chunks: name.00, name.01, ... (see AssetAPI::loadFile)
+static bool writeSplitted(const std::string& path, const std::vector<uint8_t>& content) {
+    const size_t ChunkSize = 1024 * 1024;
+    char suffix[8];
+    unsigned chunk = 0;
+    for (size_t offset = 0; offset < content.size(); offset += ChunkSize, chunk++) {
+        snprintf(suffix, sizeof(suffix), ".%02u", chunk);
+        FILE* file = fopen((path + suffix).c_str(), "wb");
+        const size_t size = std::min(ChunkSize, content.size() - offset);
+        if (!file || fwrite(&content[offset], size, 1, file) != 1) {
+            LOGE("Can't write " << path << suffix);
+            if (file)
+                fclose(file);
+            return false;
+        }
+        fclose(file);
+    }
+    // remove chunks of a previous, larger, version
+    do {
+        snprintf(suffix, sizeof(suffix), ".%02u", chunk++);
+    } while (remove((path + suffix).c_str()) == 0);
+    return true;
+}
+
+// Remove the outputs of pages a previous build had in excess
+static void removeStalePages(const AtlasBuilder::Options& options, unsigned pageCount) {
+    for (unsigned page = pageCount; ; page++) {
+        const std::string name = pageName(options, page);
+        if (remove((name + ".atlas").c_str()) != 0)
+            return;
+        remove((name + CompiledAtlas::Extension).c_str());
+        remove((name + ".png").c_str());
+        remove((name + "_alpha.png").c_str());
+        writeSplitted(name + ".pkm", std::vector<uint8_t>());
+        writeSplitted(name + "_alpha.pkm", std::vector<uint8_t>());
+    }
+}
+
+static bool writeDescription(const std::string& path, const std::vector<Sprite>& sprites, unsigned page, int width, int height) {
+    std::ofstream out(path.c_str());
+    out << "atlas_size=" << width << ',' << height << '\n';
+    unsigned index = 0;
+    for (const auto& s : sprites) {
+        if (s.page != (int)page)
+            continue;
+        out << "[image" << index++ << "]\n"
+            << "name=" << s.name << '\n'
+            << "original_size=" << s.originalWidth << ',' << s.originalHeight << '\n'
+            << "position_in_atlas=" << s.placement.x << ',' << s.placement.y << '\n'
+            << "size_in_atlas=" << s.placement.w << ',' << s.placement.h << '\n'
+            << "crop_offset=" << s.crop.x << ',' << s.crop.y << '\n'
+            << "rotated=" << (int)s.rotated << '\n';
+        // x,y,w,h of each rect
+        for (int r = 0; r < s.opaqueCount; r++) {
+            out << (r ? "," : "opaque_rect=")
+                << s.opaque[r].x << ',' << s.opaque[r].y << ',' << s.opaque[r].w << ',' << s.opaque[r].h;
+        }
+        if (s.opaqueCount)
+            out << '\n';
+    }
+    out.close();
+    if (!out) {
+        LOGE("Can't write " << path);
+        return false;
+    }
+    return true;
+}
+
+// Inputs and options of a build: if unchanged, outputs are up to date
+static std::string manifest(const AtlasBuilder::Options& options, const std::vector<Sprite>& sprites, const std::string& groups) {
+    std::stringstream ss;
+    ss << "divide_by=" << options.divideBy << " max_size=" << options.maxSize << " etc1=" << options.etc1 << '\n';
+    ss << groups;
+    for (const auto& s : sprites)
+        ss << s.path << ' ' << s.sourceSize << ' ' << s.sourceMtime << '\n';
+    return ss.str();
+}
+
+static std::string readFile(const std::string& path) {
+    std::ifstream in(path.c_str());
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+bool AtlasBuilder::build(const Options& options, std::vector<std::string> files) {
+    const float start = TimeUtil::GetTime();
+    const std::string output = pageName(options, 0);
+
+    if (files.empty()) {
+        LOGE("No image for atlas '" << options.name << "'");
+        return false;
+    }
+    if (!createDirectories(options.outputDir) ||
+        (options.incremental && !createDirectories(cacheDirectory(options))))
+        return false;
+
+    // same image order whatever the command line order
+    std::sort(files.begin(), files.end());
+    std::vector<Sprite> sprites(files.size());
+    for (unsigned i = 0; i < files.size(); i++) {
+        sprites[i].path = files[i];
+        sprites[i].name = baseName(files[i]);
+        sprites[i].fromCache = false;
+        sprites[i].group = -1;
+    }
+    std::string groups;
+    if (!options.groupsFile.empty() && !readGroups(options.groupsFile, sprites, groups))
+        return false;
+
+    WorkerPool pool(options.jobs);
+
+    // Step 1: load, downscale, trim and find opaque areas of every image
+    std::atomic<bool> failed(false);
+    pool.parallelFor(sprites.size(), 1, [&options, &sprites, &failed] (unsigned begin, unsigned end) -> void {
+        for (unsigned i = begin; i < end; i++) {
+            if (!processSprite(options, sprites[i]))
+                failed = true;
+        }
+    });
+    if (failed)
+        return false;
+
+    const unsigned cachedCount = std::count_if(sprites.begin(), sprites.end(),
+        [] (const Sprite& s) -> bool { return s.fromCache; });
+    const std::string manifestPath = cacheDirectory(options) + "/manifest";
+    const std::string currentManifest = manifest(options, sprites, groups);
+    if (options.incremental &&
+        cachedCount == sprites.size() &&
+        readFile(manifestPath) == currentManifest &&
+        fileExists(output + ".atlas") &&
+        fileExists(output + CompiledAtlas::Extension) &&
+        (!options.etc1 || fileExists(output + ".pkm.00"))) {
+        std::cout << options.name << ": up to date" << std::endl;
+        return true;
+    }
+
+    // Step 2: placement
+    const std::vector<MaxRectsPacker::Page> pages = pack(sprites, options.maxSize);
+    if (pages.empty())
+        return false;
+
+    if (options.etc1)
+        rg_etc1::pack_etc1_block_init();
+    for (unsigned page = 0; page < pages.size(); page++) {
+        const int width = pages[page].width, height = pages[page].height;
+        const std::string name = pageName(options, page);
+
+        // Step 3: compose
+        Image atlas(width, height, 4);
+        pool.parallelFor(sprites.size(), 4, [&atlas, &sprites, page] (unsigned begin, unsigned end) -> void {
+            for (unsigned i = begin; i < end; i++) {
+                if (sprites[i].page == (int)page)
+                    blit(atlas, sprites[i]);
+            }
+        });
+
+        // Step 4: premultiplied color image and alpha only image
+        Image color(width, height, 3), alpha(width, height, 3);
+        pool.parallelFor(height, 32, [&atlas, &color, &alpha] (unsigned begin, unsigned end) -> void {
+            for (unsigned y = begin; y < end; y++) {
+                for (int x = 0; x < atlas.width; x++) {
+                    const uint8_t* p = atlas.pixel(x, y);
+                    uint8_t* c = color.pixel(x, y);
+                    uint8_t* a = alpha.pixel(x, y);
+                    for (int i = 0; i < 3; i++) {
+                        c[i] = (p[i] * p[3] + 127) / 255;
+                        a[i] = p[3];
+                    }
+                }
+            }
+        });
+
+        if (!writeDescription(name + ".atlas", sprites, page, width, height) ||
+            !DescriptorCompiler::compile(name + ".atlas") ||
+            !PngIO::save(name + ".png", color) ||
+            !PngIO::save(name + "_alpha.png", alpha))
+            return false;
+
+        // Step 5: compressed versions
+        if (options.etc1) {
+            if (!writeSplitted(name + ".pkm", encodeEtc1(color, pool)) ||
+                !writeSplitted(name + "_alpha.pkm", encodeEtc1(alpha, pool)))
+                return false;
+        }
+
+        std::cout << name << ": " << width << "x" << height << ", "
+            << std::count_if(sprites.begin(), sprites.end(), [page] (const Sprite& s) -> bool { return s.page == (int)page; })
+            << " images, " << (int)(100 * pages[page].efficiency()) << "% used" << std::endl;
+    }
+    removeStalePages(options, pages.size());
+
+    if (options.incremental) {
+        std::ofstream out(manifestPath.c_str());
+        out << currentManifest;
+    }
+
+    std::cout << options.name << ": " << sprites.size() << " images (" << cachedCount << " unchanged) in "
+        << pages.size() << " page(s), built in " << TimeUtil::GetTime() - start << " s" << std::endl;
+    return true;
+}
@@ -0,0 +1,52 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// In-process replacement of the convert/python based atlas generation:
+// load, scale, trim, find opaque area, pack, premultiply alpha,
+// split color/alpha and optionally encode both as ETC1.
+namespace AtlasBuilder {
+    struct Options {
+        Options() : divideBy(1), maxSize(2048), etc1(false), incremental(false), jobs(0) {}
+
+        // atlas name: output files are <outputDir>/<name>{.atlas,.catlas,.png,_alpha.png,.pkm.NN,_alpha.pkm.NN}
+        // Extra pages are named <name>_page1, <name>_page2, ...
+        std::string name;
+        std::string outputDir;
+        // optional: images drawn together, see readGroups()
+        std::string groupsFile;
+        // source images are downscaled by this factor (1: hdpi, 2: mdpi, ...)
+        int divideBy;
+        // maximal page width and height
+        int maxSize;
+        bool etc1;
+        // reuse the processed sprites of unchanged source files
+        bool incremental;
+        // 0: one thread per core
+        unsigned jobs;
+    };
+
+    bool build(const Options& options, std::vector<std::string> files);
+}
@@ -0,0 +1,78 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "DescriptorCompiler.h"
+
+#include <api/AssetAPI.h>
+#include <base/Log.h>
+#include <util/CompiledAssets.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool DescriptorCompiler::compile(const std::string& path) {
+    const bool atlas = endsWith(path, ".atlas");
+    if (!atlas && !endsWith(path, ".font")) {
+        LOGE("Don't know how to compile '" << path << "'");
+        return false;
+    }
+
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::vector<uint8_t> content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!in.eof() && !in) {
+        LOGE("Can't read " << path);
+        return false;
+    }
+    // DataFileParser expects a '\0' terminated buffer, like AssetAPI ones
+    content.push_back(0);
+    FileBuffer text;
+    text.data = &content[0];
+    text.size = content.size() - 1;
+
+    std::vector<uint8_t> compiled;
+    const bool valid = atlas ?
+        CompiledAtlas::compile(text, path, compiled) :
+        CompiledFont::compile(text, path, compiled);
+    if (!valid)
+        return false;
+
+    const std::string output = path.substr(0, path.rfind('.')) +
+        (atlas ? CompiledAtlas::Extension : CompiledFont::Extension);
+    // write then rename: a running game never sees half a file
+    const std::string tmp = output + ".tmp";
+    std::ofstream out(tmp.c_str(), std::ios::binary);
+    out.write((const char*)&compiled[0], compiled.size());
+    out.close();
+    if (!out || rename(tmp.c_str(), output.c_str()) != 0) {
+        LOGE("Can't write " << output);
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
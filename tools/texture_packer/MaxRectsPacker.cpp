@@ -0,0 +1,287 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "MaxRectsPacker.h"
+
+#include <base/Log.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <map>
+
+MaxRectsPacker::Bin::Bin(int width, int height) {
+    Rect r = { 0, 0, width, height };
+    freeRects.push_back(r);
+}
+
+bool MaxRectsPacker::Bin::insert(int w, int h, Rect& out, bool& rotated) {
+    int bestShort = INT_MAX, bestLong = INT_MAX;
+    for (const auto& r : freeRects) {
+        for (int rotate = 0; rotate < (w == h ? 1 : 2); rotate++) {
+            const int rw = rotate ? h : w, rh = rotate ? w : h;
+            if (r.w < rw || r.h < rh)
+                continue;
+            const int shortSide = std::min(r.w - rw, r.h - rh);
+            const int longSide = std::max(r.w - rw, r.h - rh);
+            if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+                bestShort = shortSide;
+                bestLong = longSide;
+                out.x = r.x;
+                out.y = r.y;
+                out.w = rw;
+                out.h = rh;
+                rotated = rotate;
+            }
+        }
+    }
+    if (bestShort == INT_MAX)
+        return false;
+
+    split(out);
+    prune();
+    return true;
+}
+
+// Replace every free rect overlapping 'used' by its (up to 4) maximal
+// non overlapping parts
+void MaxRectsPacker::Bin::split(const Rect& used) {
+    std::vector<Rect> next;
+    next.reserve(freeRects.size() + 4);
+    for (const auto& r : freeRects) {
+        if (used.x >= r.x + r.w || used.x + used.w <= r.x ||
+            used.y >= r.y + r.h || used.y + used.h <= r.y) {
+            next.push_back(r);
+            continue;
+        }
+        if (used.x > r.x) {
+            Rect left = { r.x, r.y, used.x - r.x, r.h };
+            next.push_back(left);
+        }
+        if (used.x + used.w < r.x + r.w) {
+            Rect right = { used.x + used.w, r.y, r.x + r.w - (used.x + used.w), r.h };
+            next.push_back(right);
+        }
+        if (used.y > r.y) {
+            Rect top = { r.x, r.y, r.w, used.y - r.y };
+            next.push_back(top);
+        }
+        if (used.y + used.h < r.y + r.h) {
+            Rect bottom = { r.x, used.y + used.h, r.w, r.y + r.h - (used.y + used.h) };
+            next.push_back(bottom);
+        }
+    }
+    freeRects.swap(next);
+}
+
+static bool contains(int ax, int ay, int aw, int ah, int bx, int by, int bw, int bh) {
+    return bx >= ax && by >= ay && bx + bw <= ax + aw && by + bh <= ay + ah;
+}
+
+// Remove free rects contained in another one
+void MaxRectsPacker::Bin::prune() {
+    std::vector<bool> removed(freeRects.size(), false);
+    for (unsigned i = 0; i < freeRects.size(); i++) {
+        const Rect& a = freeRects[i];
+        for (unsigned j = 0; j < freeRects.size(); j++) {
+            const Rect& b = freeRects[j];
+            if (i != j && !removed[j] && contains(b.x, b.y, b.w, b.h, a.x, a.y, a.w, a.h)) {
+                removed[i] = true;
+                break;
+            }
+        }
+    }
+    unsigned kept = 0;
+    for (unsigned i = 0; i < freeRects.size(); i++) {
+        if (!removed[i])
+            freeRects[kept++] = freeRects[i];
+    }
+    freeRects.resize(kept);
+}
+
+MaxRectsPacker::MaxRectsPacker(int pMaxSize, int pPadding) : maxSize(pMaxSize), padding(pPadding) {}
+
+bool MaxRectsPacker::packPage(const std::vector<unsigned>& indexes, int width, int height, std::vector<Placement>& out) const {
+    Bin bin(width, height);
+    for (unsigned i : indexes) {
+        Rect r;
+        bool rotated;
+        if (!bin.insert(inputs[i].width + 2 * padding, inputs[i].height + 2 * padding, r, rotated))
+            return false;
+        Placement& p = out[i];
+        p.x = r.x + padding;
+        p.y = r.y + padding;
+        p.width = r.w - 2 * padding;
+        p.height = r.h - 2 * padding;
+        p.rotated = rotated;
+    }
+    return true;
+}
+
+// Repack the page content in the smallest power of two page possible
+void MaxRectsPacker::shrinkPage(unsigned page, const std::vector<unsigned>& indexes) {
+    unsigned paddedArea = 0;
+    for (unsigned i : indexes)
+        paddedArea += (inputs[i].width + 2 * padding) * (inputs[i].height + 2 * padding);
+
+    std::vector<std::pair<int, int> > sizes;
+    for (int w = 1; w <= maxSize; w *= 2) {
+        for (int h = 1; h <= maxSize; h *= 2) {
+            if ((unsigned)(w * h) >= paddedArea)
+                sizes.push_back(std::make_pair(w, h));
+        }
+    }
+    // smallest area first, then the squarest
+    std::sort(sizes.begin(), sizes.end(), [] (const std::pair<int, int>& a, const std::pair<int, int>& b) -> bool {
+        if (a.first * a.second != b.first * b.second)
+            return a.first * a.second < b.first * b.second;
+        return std::abs(a.first - a.second) < std::abs(b.first - b.second);
+    });
+
+    for (const auto& s : sizes) {
+        std::vector<Placement> candidate(result);
+        if (packPage(indexes, s.first, s.second, candidate)) {
+            result.swap(candidate);
+            pageList[page].width = s.first;
+            pageList[page].height = s.second;
+            return;
+        }
+    }
+    // keep the full size page
+}
+
+// Biggest first, using the longest side then area
+static void sortForInsertion(std::vector<unsigned>& indexes, const std::vector<MaxRectsPacker::Input>& inputs) {
+    std::sort(indexes.begin(), indexes.end(), [&inputs] (unsigned a, unsigned b) -> bool {
+        const int sideA = std::max(inputs[a].width, inputs[a].height);
+        const int sideB = std::max(inputs[b].width, inputs[b].height);
+        if (sideA != sideB)
+            return sideA > sideB;
+        if (inputs[a].width * inputs[a].height != inputs[b].width * inputs[b].height)
+            return inputs[a].width * inputs[a].height > inputs[b].width * inputs[b].height;
+        return a < b;
+    });
+}
+
+bool MaxRectsPacker::pack(const std::vector<Input>& pInputs) {
+    inputs = pInputs;
+    result.assign(inputs.size(), Placement());
+    pageList.clear();
+
+    // Build units: whole groups, or single ungrouped rects
+    std::map<int, std::vector<unsigned> > groups;
+    std::vector<std::vector<unsigned> > units;
+    for (unsigned i = 0; i < inputs.size(); i++) {
+        if (inputs[i].group < 0)
+            units.push_back(std::vector<unsigned>(1, i));
+        else
+            groups[inputs[i].group].push_back(i);
+    }
+    for (auto& g : groups)
+        units.push_back(g.second);
+
+    std::vector<unsigned> unitAreas(units.size(), 0);
+    for (unsigned u = 0; u < units.size(); u++) {
+        sortForInsertion(units[u], inputs);
+        for (unsigned i : units[u])
+            unitAreas[u] += inputs[i].width * inputs[i].height;
+    }
+    std::vector<unsigned> order(units.size());
+    for (unsigned u = 0; u < units.size(); u++)
+        order[u] = u;
+    std::stable_sort(order.begin(), order.end(), [&unitAreas] (unsigned a, unsigned b) -> bool {
+        return unitAreas[a] > unitAreas[b];
+    });
+
+    // Fill pages, first fit
+    std::vector<Bin> bins;
+    std::vector<std::vector<unsigned> > pageContent;
+    for (unsigned u : order) {
+        std::vector<std::vector<unsigned> > parts(1, units[u]);
+        for (unsigned attempt = 0; attempt < 2; attempt++) {
+            bool placed = true;
+            for (const auto& part : parts) {
+                bool partPlaced = false;
+                for (unsigned page = 0; page <= bins.size() && !partPlaced; page++) {
+                    Bin bin = (page < bins.size()) ? bins[page] : Bin(maxSize, maxSize);
+                    std::vector<Placement> placements(result);
+                    bool fits = true;
+                    for (unsigned i : part) {
+                        Rect r;
+                        bool rotated;
+                        if (!bin.insert(inputs[i].width + 2 * padding, inputs[i].height + 2 * padding, r, rotated)) {
+                            fits = false;
+                            break;
+                        }
+                        placements[i].page = page;
+                        placements[i].x = r.x + padding;
+                        placements[i].y = r.y + padding;
+                        placements[i].width = r.w - 2 * padding;
+                        placements[i].height = r.h - 2 * padding;
+                        placements[i].rotated = rotated;
+                    }
+                    if (!fits)
+                        continue;
+                    if (page == bins.size()) {
+                        bins.push_back(bin);
+                        pageContent.push_back(std::vector<unsigned>());
+                    } else {
+                        bins[page] = bin;
+                    }
+                    pageContent[page].insert(pageContent[page].end(), part.begin(), part.end());
+                    result.swap(placements);
+                    partPlaced = true;
+                }
+                if (!partPlaced) {
+                    placed = false;
+                    break;
+                }
+            }
+            if (placed)
+                break;
+            if (parts.size() > 1 || units[u].size() == 1) {
+                LOG_USAGE_ONLY(const Input& in = inputs[units[u][0]];)
+                LOGE("Image " << units[u][0] << " (" << in.width << "x" << in.height << ") doesn't fit in a " << maxSize << "x" << maxSize << " page");
+                return false;
+            }
+            // group larger than a page: place its rects independently
+            LOGW("Group " << inputs[units[u][0]].group << " doesn't fit in a single page, splitting it");
+            parts.clear();
+            for (unsigned i : units[u])
+                parts.push_back(std::vector<unsigned>(1, i));
+        }
+    }
+
+    for (unsigned page = 0; page < pageContent.size(); page++) {
+        Page p;
+        p.width = p.height = maxSize;
+        p.usedArea = 0;
+        for (unsigned i : pageContent[page])
+            p.usedArea += inputs[i].width * inputs[i].height;
+        pageList.push_back(p);
+
+        sortForInsertion(pageContent[page], inputs);
+        shrinkPage(page, pageContent[page]);
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <vector>
+
+// MaxRects bin packer (best short side fit, 90 degrees rotation allowed),
+// spilling into as many pages as needed. Rects sharing a group are kept
+// on the same page when they fit in one.
+// See "A Thousand Ways to Pack the Bin", Jukka Jylanki.
+class MaxRectsPacker {
+    public:
+    struct Input {
+        int width, height;
+        // -1: no group
+        int group;
+    };
+
+    struct Placement {
+        int page;
+        // position of the rect itself (excluding padding)
+        int x, y, width, height;
+        bool rotated;
+    };
+
+    struct Page {
+        int width, height;
+        // area used by rects (excluding padding)
+        unsigned usedArea;
+        float efficiency() const { return usedArea / (float)(width * height); }
+    };
+
+    // padding: empty pixels kept on each side of every rect
+    MaxRectsPacker(int maxSize, int padding);
+
+    // Fails if a rect doesn't fit in an empty page
+    bool pack(const std::vector<Input>& inputs);
+
+    const std::vector<Placement>& placements() const { return result; }
+    const std::vector<Page>& pages() const { return pageList; }
+
+    private:
+    struct Rect {
+        int x, y, w, h;
+    };
+
+    class Bin {
+        public:
+        Bin(int width, int height);
+        // padded size, false if it doesn't fit
+        bool insert(int w, int h, Rect& out, bool& rotated);
+
+        private:
+        void split(const Rect& used);
+        void prune();
+
+        std::vector<Rect> freeRects;
+    };
+
+    bool packPage(const std::vector<unsigned>& indexes, int width, int height, std::vector<Placement>& out) const;
+    void shrinkPage(unsigned page, const std::vector<unsigned>& indexes);
+
+    int maxSize, padding;
+    std::vector<Input> inputs;
+    std::vector<Placement> result;
+    std::vector<Page> pageList;
+};
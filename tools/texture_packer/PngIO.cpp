@@ -0,0 +1,130 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "PngIO.h"
+#include <png.h>
+#include <cstdio>
+
+#include <base/Log.h>
+
+bool PngIO::load(const std::string& path, Image& out) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        LOGE(path << " not found");
+        return false;
+    }
+
+    png_byte header[8];
+    if (fread(header, 1, 8, file) != 8 || png_sig_cmp(header, 0, 8) != 0) {
+        LOGE(path << " is not a PNG");
+        fclose(file);
+        return false;
+    }
+
+    png_structp reader = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = reader ? png_create_info_struct(reader) : NULL;
+    if (!info) {
+        LOGE("Can't start reading " << path);
+        png_destroy_read_struct(&reader, NULL, NULL);
+        fclose(file);
+        return false;
+    }
+
+    std::vector<png_byte*> rows;
+    if (setjmp(png_jmpbuf(reader))) {
+        LOGE("Can't load " << path);
+        png_destroy_read_struct(&reader, &info, NULL);
+        fclose(file);
+        return false;
+    }
+
+    png_init_io(reader, file);
+    png_set_sig_bytes(reader, 8);
+    png_read_info(reader, info);
+
+    const int colorType = png_get_color_type(reader, info);
+    const int bitDepth = png_get_bit_depth(reader, info);
+
+    if (colorType == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(reader);
+    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8)
+        png_set_expand_gray_1_2_4_to_8(reader);
+    if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+        png_set_gray_to_rgb(reader);
+    if (png_get_valid(reader, info, PNG_INFO_tRNS))
+        png_set_tRNS_to_alpha(reader);
+    else
+        png_set_filler(reader, 0xff, PNG_FILLER_AFTER);
+    if (bitDepth == 16)
+        png_set_strip_16(reader);
+    png_read_update_info(reader, info);
+
+    out = Image(png_get_image_width(reader, info), png_get_image_height(reader, info), 4);
+    rows.resize(out.height);
+    for (int y = 0; y < out.height; y++)
+        rows[y] = out.pixel(0, y);
+    png_read_image(reader, &rows[0]);
+
+    png_destroy_read_struct(&reader, &info, NULL);
+    fclose(file);
+    return true;
+}
+
+bool PngIO::save(const std::string& path, const Image& image) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        LOGE("Can't create " << path);
+        return false;
+    }
+
+    png_structp writer = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = writer ? png_create_info_struct(writer) : NULL;
+    if (!info) {
+        LOGE("Can't start writing " << path);
+        png_destroy_write_struct(&writer, NULL);
+        fclose(file);
+        return false;
+    }
+
+    std::vector<png_byte*> rows(image.height);
+    if (setjmp(png_jmpbuf(writer))) {
+        LOGE("Can't write " << path);
+        png_destroy_write_struct(&writer, &info);
+        fclose(file);
+        return false;
+    }
+
+    png_init_io(writer, file);
+    png_set_IHDR(writer, info, image.width, image.height, 8,
+        image.channels == 4 ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+        PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(writer, info);
+    for (int y = 0; y < image.height; y++)
+        rows[y] = (png_byte*) image.pixel(0, y);
+    png_write_image(writer, &rows[0]);
+    png_write_end(writer, NULL);
+
+    png_destroy_write_struct(&writer, &info);
+    fclose(file);
+    return true;
+}
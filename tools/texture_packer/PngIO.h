@@ -0,0 +1,45 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 8 bits per channel image, rows stored top to bottom
+struct Image {
+    Image() : width(0), height(0), channels(4) {}
+    Image(int w, int h, int c) : width(w), height(h), channels(c), pixels(w * h * c, 0) {}
+
+    uint8_t* pixel(int x, int y) { return &pixels[(y * width + x) * channels]; }
+    const uint8_t* pixel(int x, int y) const { return &pixels[(y * width + x) * channels]; }
+
+    int width, height, channels;
+    std::vector<uint8_t> pixels;
+};
+
+namespace PngIO {
+    // Always returns a RGBA image
+    bool load(const std::string& path, Image& out);
+    // Writes RGB or RGBA images
+    bool save(const std::string& path, const Image& image);
+}
@@ -26,7 +26,7 @@ with open(sys.argv[1], 'r') as i:
 		
 		o.write(TEMP1.format(filename) + '{\n')
 
-		for i in range (0, (int)(len(hexList)/12)+1):
+		for i in range (0, (int)((len(hexList) + 11)/12)):
 			o.write(', '.join(hexList[i*12:i*12+12])+',\n')
 		o.write('0x00 };\n')
 		o.write(TEMP2.format(filename, len(hexList)))
@@ -0,0 +1,144 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "Broadphase.h"
+
+#include <algorithm>
+
+Broadphase::Broadphase() : world(0.0f), size(0), invSize(0), w(0), h(0), moveCount(0) {}
+
+void Broadphase::setGrid(const glm::vec2& worldSize, float cellSize) {
+    if (worldSize == world && cellSize == size)
+        return;
+    world = worldSize;
+    size = cellSize;
+    invSize = 1.0f / cellSize;
+    w = glm::max(1, (int)glm::ceil(worldSize.x * invSize));
+    h = glm::max(1, (int)glm::ceil(worldSize.y * invSize));
+    clear();
+    cells.resize(w * h);
+    occupiedIndex.assign(w * h, -1);
+}
+
+void Broadphase::clear() {
+    for (auto& c: cells) {
+        for (int l=0; l<LayerCount; l++) {
+            c.entities[l].clear();
+            c.groups[l] = 0;
+        }
+    }
+    occupiedIndex.assign(cells.size(), -1);
+    occupied.clear();
+    proxies.clear();
+    freeProxies.clear();
+}
+
+void Broadphase::cellCoord(const glm::vec2& p, int& x, int& y) const {
+    x = glm::clamp((int)glm::floor((p.x + world.x * 0.5f) * invSize), 0, w - 1);
+    y = glm::clamp((int)glm::floor((p.y + world.y * 0.5f) * invSize), 0, h - 1);
+}
+
+void Broadphase::cellRange(const AABB& bounds, int& x0, int& y0, int& x1, int& y1) const {
+    cellCoord(glm::vec2(bounds.left, bounds.bottom), x0, y0);
+    cellCoord(glm::vec2(bounds.right, bounds.top), x1, y1);
+}
+
+int Broadphase::update(int proxy, Entity e, const AABB& bounds, Layer layer, int group) {
+    int x0, y0, x1, y1;
+    cellRange(bounds, x0, y0, x1, y1);
+
+    // proxy may come from a copied component: check it's ours
+    if (proxy >= 0 && proxy < (int)proxies.size() && proxies[proxy].entity == e) {
+        Proxy& p = proxies[proxy];
+        if (p.x0 == x0 && p.y0 == y0 && p.x1 == x1 && p.y1 == y1 &&
+            p.layer == layer && p.group == group)
+            return proxy;
+        removeFromCells(p);
+    } else {
+        if (freeProxies.empty()) {
+            proxy = proxies.size();
+            proxies.push_back(Proxy());
+        } else {
+            proxy = freeProxies.back();
+            freeProxies.pop_back();
+        }
+    }
+    Proxy& p = proxies[proxy];
+    p.entity = e;
+    p.x0 = x0; p.y0 = y0; p.x1 = x1; p.y1 = y1;
+    p.layer = layer;
+    p.group = group;
+    insertInCells(p);
+    return proxy;
+}
+
+void Broadphase::remove(int proxy, Entity e) {
+    if (proxy < 0 || proxy >= (int)proxies.size() || proxies[proxy].entity != e)
+        return;
+    removeFromCells(proxies[proxy]);
+    proxies[proxy].entity = 0;
+    freeProxies.push_back(proxy);
+}
+
+void Broadphase::insertInCells(const Proxy& p) {
+    for (int y = p.y0; y <= p.y1; y++) {
+        for (int x = p.x0; x <= p.x1; x++) {
+            const int index = x + y * w;
+            Cell& c = cells[index];
+            c.entities[p.layer].push_back(p.entity);
+            c.groups[p.layer] |= p.group;
+            if (occupiedIndex[index] < 0) {
+                occupiedIndex[index] = occupied.size();
+                occupied.push_back(index);
+            }
+            moveCount++;
+        }
+    }
+}
+
+void Broadphase::removeFromCells(const Proxy& p) {
+    for (int y = p.y0; y <= p.y1; y++) {
+        for (int x = p.x0; x <= p.x1; x++) {
+            const int index = x + y * w;
+            Cell& c = cells[index];
+            std::vector<Entity>& v = c.entities[p.layer];
+            auto it = std::find(v.begin(), v.end(), p.entity);
+            if (it == v.end())
+                continue;
+            *it = v.back();
+            v.pop_back();
+            if (v.empty())
+                c.groups[p.layer] = 0;
+            moveCount++;
+
+            if (c.entities[Colliding].empty() && c.entities[Collider].empty()) {
+                // swap with last occupied cell
+                const int pos = occupiedIndex[index];
+                occupied[pos] = occupied.back();
+                occupiedIndex[occupied[pos]] = pos;
+                occupied.pop_back();
+                occupiedIndex[index] = -1;
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "base/Entity.h"
+#include "util/IntersectionUtil.h"
+
+// Persistent uniform grid over a bounded world ([-worldSize/2, worldSize/2],
+// outside bounds are clamped to the border cells).
+// Entities are only re-bucketed when the cells they cover change, and all
+// storage is reused: once every entity and cell has been seen, updates don't
+// allocate.
+class Broadphase {
+    public:
+    enum Layer { Colliding = 0, Collider, LayerCount };
+
+    struct Cell {
+        Cell() { groups[0] = groups[1] = 0; }
+        std::vector<Entity> entities[LayerCount];
+        // groups of entities in this cell (may be a superset after removals,
+        // reset when the layer is empty)
+        int groups[LayerCount];
+    };
+
+    Broadphase();
+
+    // Everything is removed if the grid changes
+    void setGrid(const glm::vec2& worldSize, float cellSize);
+
+    // Insert (proxy < 0) or move an entity. Returns its proxy, to give back
+    // on next calls.
+    int update(int proxy, Entity e, const AABB& bounds, Layer layer, int group);
+    void remove(int proxy, Entity e);
+    void clear();
+
+    // cells covered by 'bounds', clamped to the grid
+    void cellRange(const AABB& bounds, int& x0, int& y0, int& x1, int& y1) const;
+    void cellCoord(const glm::vec2& p, int& x, int& y) const;
+
+    // first cell (index) covered by both proxies. Testing a pair only there
+    // avoids testing it once per shared cell.
+    int pairCell(int proxyA, int proxyB) const {
+        const Proxy& a = proxies[proxyA];
+        const Proxy& b = proxies[proxyB];
+        return glm::max(a.x0, b.x0) + glm::max(a.y0, b.y0) * w;
+    }
+
+    const Cell& cell(int index) const { return cells[index]; }
+    const Cell& cell(int x, int y) const { return cells[x + y * w]; }
+    // indices of non-empty cells, unordered
+    const std::vector<int>& occupiedCells() const { return occupied; }
+
+    int width() const { return w; }
+    int height() const { return h; }
+    float cellSize() const { return size; }
+    // number of entities
+    unsigned count() const { return proxies.size() - freeProxies.size(); }
+    // cell insertions/removals done by the last updates (see resetStats)
+    unsigned moves() const { return moveCount; }
+    void resetStats() { moveCount = 0; }
+
+    private:
+    struct Proxy {
+        Entity entity;
+        int x0, y0, x1, y1;
+        Layer layer;
+        int group;
+    };
+
+    void insertInCells(const Proxy& p);
+    void removeFromCells(const Proxy& p);
+
+    glm::vec2 world;
+    float size, invSize;
+    int w, h;
+    std::vector<Cell> cells;
+    // position of each cell in 'occupied' (-1: empty cell)
+    std::vector<int> occupiedIndex;
+    std::vector<int> occupied;
+    std::vector<Proxy> proxies;
+    std::vector<int> freeProxies;
+    unsigned moveCount;
+};
@@ -0,0 +1,210 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+#include "CompiledAssets.h"
+
+#include "api/AssetAPI.h"
+#include "base/Log.h"
+#include "util/DataFileParser.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char AtlasMagic[4] = { 'S', 'A', 'C', 'A' };
+static const char FontMagic[4] = { 'S', 'A', 'C', 'F' };
+static const uint32_t AtlasVersion = 1;
+static const uint32_t FontVersion = 1;
+
+const char* CompiledAtlas::Extension = ".catlas";
+const char* CompiledFont::Extension = ".cfont";
+
+template <class T>
+static void append(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+bool CompiledAtlas::compile(const FileBuffer& text, const std::string& context, std::vector<uint8_t>& out) {
+    DataFileParser dfp;
+    if (!dfp.load(text, context)) {
+        LOGE("Unable to parse '" << context << "'");
+        return false;
+    }
+
+    Header header;
+    memcpy(header.magic, AtlasMagic, 4);
+    header.version = AtlasVersion;
+    if (!dfp.get(DataFileParser::GlobalSection, "atlas_size", header.atlasSize, 2)) {
+        LOGE("Missing 'atlas_size' attribute in '" << context << "'");
+        return false;
+    }
+
+    std::vector<Image> images;
+    std::string names;
+    // images parsed before an error are kept, like the text loader always did
+    for (unsigned count = 0; ; count++) {
+        char sectionName[32];
+        snprintf(sectionName, sizeof(sectionName), "image%u", count);
+        const hash_t section = Murmur::RuntimeHash(sectionName);
+
+        if (!dfp.hasSection(section))
+            break;
+
+        Image image;
+        memset(&image, 0, sizeof(image));
+        std::string assetName;
+        if (!dfp.get(section, "name", &assetName, 1)) {
+            LOGE(context << ": missing 'name' in section '" << sectionName << "'");
+            break;
+        }
+        int rotate;
+        if (!dfp.get(section, "original_size", image.originalSize, 2) ||
+            !dfp.get(section, "position_in_atlas", image.positionInAtlas, 2) ||
+            !dfp.get(section, "size_in_atlas", image.sizeInAtlas, 2) ||
+            !dfp.get(section, "crop_offset", image.cropOffset, 2) ||
+            !dfp.get(section, "rotated", &rotate, 1)) {
+            LOGE(context << '/' << assetName << ": incomplete section '" << sectionName << "'");
+            break;
+        }
+        image.rotated = rotate;
+        // opaque_rect: x,y,w,h of each opaque rectangle
+        int opaqueValues = std::min(dfp.getSubStringCount(section, "opaque_rect"), MaxOpaqueRects * 4);
+        if (opaqueValues < 4 || !dfp.get(section, "opaque_rect", &image.opaqueRects[0][0], opaqueValues - opaqueValues % 4, false)) {
+            LOGV(1, "No 'opaque_rect' in section '" << sectionName << "' for image " << assetName);
+            opaqueValues = 0;
+        }
+        image.opaqueCount = opaqueValues / 4;
+
+        image.nameHash = Murmur::RuntimeHash(assetName.c_str());
+        image.nameOffset = names.size();
+        names.append(assetName.c_str(), assetName.size() + 1);
+        images.push_back(image);
+    }
+    // keep the whole file 4 bytes aligned
+    names.resize((names.size() + 3) & ~3u, '\0');
+
+    header.imageCount = images.size();
+    header.namesSize = names.size();
+
+    out.clear();
+    out.reserve(sizeof(Header) + images.size() * sizeof(Image) + names.size());
+    append(out, header);
+    for (const auto& image: images)
+        append(out, image);
+    out.insert(out.end(), names.begin(), names.end());
+    return true;
+}
+
+const CompiledAtlas::Header* CompiledAtlas::validate(const FileBuffer& fb) {
+    if (!fb.data || fb.size < (int)sizeof(Header))
+        return 0;
+    const Header* h = reinterpret_cast<const Header*>(fb.data);
+    if (memcmp(h->magic, AtlasMagic, 4) || h->version != AtlasVersion) {
+        LOGW("Compiled atlas: unsupported format/version");
+        return 0;
+    }
+    if ((uint64_t)sizeof(Header) + (uint64_t)h->imageCount * sizeof(Image) + h->namesSize > (uint64_t)fb.size) {
+        LOGW("Compiled atlas: truncated file");
+        return 0;
+    }
+    const Image* img = images(h);
+    for (unsigned i=0; i<h->imageCount; i++) {
+        if (img[i].nameOffset >= h->namesSize || img[i].opaqueCount > (uint32_t)MaxOpaqueRects) {
+            LOGW("Compiled atlas: invalid image #" << i);
+            return 0;
+        }
+    }
+    // names must be terminated
+    const char* names = reinterpret_cast<const char*>(img + h->imageCount);
+    if (h->namesSize && names[h->namesSize - 1] != '\0') {
+        LOGW("Compiled atlas: invalid name table");
+        return 0;
+    }
+    return h;
+}
+
+bool CompiledFont::compile(const FileBuffer& text, const std::string& context, std::vector<uint8_t>& out) {
+    DataFileParser dfp;
+    if (!dfp.load(text, context)) {
+        LOGE("Invalid font description file: " << context);
+        return false;
+    }
+
+    const unsigned defCount = dfp.sectionSize(DataFileParser::GlobalSection);
+    LOGW_IF(defCount == 0, "Font definition '" << context << "' has no entry");
+    std::vector<Glyph> glyphs;
+    glyphs.reserve(defCount);
+    std::string charUnicode;
+    for (unsigned i=0; i<defCount; i++) {
+        int w_h[2];
+        if (!dfp.get(DataFileParser::GlobalSection, i, charUnicode, w_h, 2) || w_h[1] == 0) {
+            LOGE("Unable to parse entry #" << i << " of " << context);
+            continue;
+        }
+        Glyph g;
+        g.unicode = strtoul(charUnicode.c_str(), 0, 16);
+        g.h2wRatio = (float)w_h[0] / w_h[1];
+        glyphs.push_back(g);
+    }
+    // sorted, last definition of a character wins
+    std::stable_sort(glyphs.begin(), glyphs.end(), [] (const Glyph& a, const Glyph& b) -> bool {
+        return a.unicode < b.unicode;
+    });
+    std::vector<Glyph> unique;
+    unique.reserve(glyphs.size());
+    for (const auto& g: glyphs) {
+        if (!unique.empty() && unique.back().unicode == g.unicode)
+            unique.back() = g;
+        else
+            unique.push_back(g);
+    }
+
+    Header header;
+    memcpy(header.magic, FontMagic, 4);
+    header.version = FontVersion;
+    header.glyphCount = unique.size();
+
+    out.clear();
+    out.reserve(sizeof(Header) + unique.size() * sizeof(Glyph));
+    append(out, header);
+    for (const auto& g: unique)
+        append(out, g);
+    return true;
+}
+
+const CompiledFont::Header* CompiledFont::validate(const FileBuffer& fb) {
+    if (!fb.data || fb.size < (int)sizeof(Header))
+        return 0;
+    const Header* h = reinterpret_cast<const Header*>(fb.data);
+    if (memcmp(h->magic, FontMagic, 4) || h->version != FontVersion) {
+        LOGW("Compiled font: unsupported format/version");
+        return 0;
+    }
+    if ((uint64_t)sizeof(Header) + (uint64_t)h->glyphCount * sizeof(Glyph) > (uint64_t)fb.size) {
+        LOGW("Compiled font: truncated file");
+        return 0;
+    }
+    return h;
+}
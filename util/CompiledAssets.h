@@ -0,0 +1,104 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "util/MurmurHash.h"
+
+struct FileBuffer;
+
+// Binary versions of the .atlas and .font text descriptions, produced at
+// build time (texture_packer --compile) so they can be used in place at
+// runtime (see AssetAPI::mapAsset) instead of being parsed.
+// Little-endian, all fields 4 bytes aligned.
+namespace CompiledAtlas {
+    // file extension, next to the text one
+    extern const char* Extension;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        float atlasSize[2];
+        uint32_t imageCount;
+        // size of the name table, after the images
+        uint32_t namesSize;
+    };
+
+    // opaque rectangles stored per image
+    const int MaxOpaqueRects = 4;
+
+    struct Image {
+        // Murmur::RuntimeHash of the name
+        hash_t nameHash;
+        // offset of the '\0' terminated name in the name table
+        uint32_t nameOffset;
+        float originalSize[2];
+        float positionInAtlas[2];
+        float sizeInAtlas[2];
+        float cropOffset[2];
+        // x, y, width, height in pixels, from top left corner
+        float opaqueRects[MaxOpaqueRects][4];
+        uint32_t opaqueCount;
+        uint32_t rotated;
+    };
+
+    // Parse text description into its binary version
+    bool compile(const FileBuffer& text, const std::string& context, std::vector<uint8_t>& out);
+
+    // Checks 'fb' is a complete compiled atlas: returns its header, 0 otherwise
+    const Header* validate(const FileBuffer& fb);
+
+    inline const Image* images(const Header* h) {
+        return reinterpret_cast<const Image*>(h + 1);
+    }
+    inline const char* name(const Header* h, const Image& image) {
+        return reinterpret_cast<const char*>(images(h) + h->imageCount) + image.nameOffset;
+    }
+}
+
+namespace CompiledFont {
+    extern const char* Extension;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t glyphCount;
+    };
+
+    struct Glyph {
+        uint32_t unicode;
+        // see TextSystem::CharInfo
+        float h2wRatio;
+    };
+
+    // Parse text description into its binary version (glyphs sorted by unicode)
+    bool compile(const FileBuffer& text, const std::string& context, std::vector<uint8_t>& out);
+
+    const Header* validate(const FileBuffer& fb);
+
+    inline const Glyph* glyphs(const Header* h) {
+        return reinterpret_cast<const Glyph*>(h + 1);
+    }
+}
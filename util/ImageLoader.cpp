@@ -41,6 +41,7 @@
 
 #if SAC_DESKTOP
 #include "rg_etc1.h"
+#include "WorkerPool.h"
 #endif
 
 struct FileBufferOffset {
@@ -102,24 +103,31 @@ ImageDesc ImageLoader::loadEtc1(const std::string& LOG_USAGE_ONLY(context), cons
         #if SAC_DESKTOP
         unsigned int* pixels = new unsigned int[result.width * result.height];
         result.datas = (char*) pixels;
-        memset(pixels, 255, result.width * result.height * 4);
+        // pixels outside of complete blocks are not decoded
+        if ((result.width % 4) || (result.height % 4))
+            memset(pixels, 255, result.width * result.height * 4);
         // 64bits -> 4x4 pixels
-        LOG_USAGE_ONLY(int blockCount = (result.width * result.height) / (4 * 4);)
-        int blockIndex = 0;
-
-        unsigned int decodedBlock[4 * 4];
-
-        for (int i=0; i<result.height/4; i++) {
-            for (int j=0; j<result.width/4; j++) {
-                bool r = rg_etc1::unpack_etc1_block(&file.data[offset + 8 * blockIndex], decodedBlock);
-
-                for (int k=0; k<4; k++) {
-                    memcpy(&pixels[(4 * i + k) * result.width + 4 * j], &decodedBlock[4 * k], 4 * sizeof(int));
+        const int blocksPerRow = result.width / 4;
+        LOG_USAGE_ONLY(const int blockCount = blocksPerRow * (result.height / 4);)
+        const uint8_t* blocks = &file.data[offset];
+        const int width = result.width;
+
+        // rows of blocks are independent: decode them in parallel
+        WorkerPool::shared().parallelFor(result.height / 4, 8,
+            [=] (unsigned firstRow, unsigned endRow) -> void {
+            unsigned int decodedBlock[4 * 4];
+            for (int i=firstRow; i<(int)endRow; i++) {
+                for (int j=0; j<blocksPerRow; j++) {
+                    const int blockIndex = i * blocksPerRow + j;
+                    bool r = rg_etc1::unpack_etc1_block(&blocks[8 * blockIndex], decodedBlock);
+
+                    for (int k=0; k<4; k++) {
+                        memcpy(&pixels[(4 * i + k) * width + 4 * j], &decodedBlock[4 * k], 4 * sizeof(int));
+                    }
+                    LOGF_IF(!r, "unpack_etc1_block failed. Block: " << blockIndex << '/' << blockCount);
                 }
-                LOGF_IF(!r, "unpack_etc1_block failed. Block: " << blockIndex << '/' << blockCount);
-                blockIndex++;
             }
-        }
+        });
 
         result.channels = 4;
         result.type = ImageDesc::RAW;
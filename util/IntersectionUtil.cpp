@@ -26,6 +26,15 @@
 #include <glm/gtx/rotate_vector.hpp>
 #include "../systems/TransformationSystem.h"
 #include <cmath>
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
 
 //never trust floats, they're evils
 const float eps = 0.0001f;
@@ -382,3 +391,359 @@ int IntersectionUtil::rectangleRectangle(const TransformationComponent* tc1,
     }
     return count;
 }
+
+// Separating axes of 2 rectangles (A and B sides), and their radius along
+// each axis
+struct SeparatingAxes {
+    glm::vec2 axis[4];
+    float radius[4];
+
+    SeparatingAxes(const glm::vec2& halfA, float rotA, const glm::vec2& halfB, float rotB) {
+        const glm::vec2 uA(glm::cos(rotA), glm::sin(rotA)), vA(-uA.y, uA.x);
+        const glm::vec2 uB(glm::cos(rotB), glm::sin(rotB)), vB(-uB.y, uB.x);
+        axis[0] = uA;
+        axis[1] = vA;
+        axis[2] = uB;
+        axis[3] = vB;
+        for (int i=0; i<4; i++) {
+            radius[i] =
+                halfA.x * glm::abs(glm::dot(uA, axis[i])) + halfA.y * glm::abs(glm::dot(vA, axis[i])) +
+                halfB.x * glm::abs(glm::dot(uB, axis[i])) + halfB.y * glm::abs(glm::dot(vB, axis[i]));
+        }
+    }
+
+    // largest gap between the rectangles along the axes (< 0 if they
+    // intersect). Never more than their actual distance.
+    float separation(const glm::vec2& delta) const {
+        float gap = -FLT_MAX;
+        for (int i=0; i<4; i++) {
+            gap = glm::max(gap, glm::abs(glm::dot(delta, axis[i])) - radius[i]);
+        }
+        return gap;
+    }
+};
+
+float IntersectionUtil::rectangleRectangleTimeOfImpact(
+    const glm::vec2 rectAPos[2], const glm::vec2& rectASize, const float rectARot[2],
+    const glm::vec2 rectBPos[2], const glm::vec2& rectBSize, const float rectBRot[2],
+    float tolerance) {
+    const glm::vec2 halfA = rectASize * 0.5f, halfB = rectBSize * 0.5f;
+    // B move relative to A
+    const glm::vec2 delta0 = rectBPos[0] - rectAPos[0];
+    const glm::vec2 velocity = (rectBPos[1] - rectBPos[0]) - (rectAPos[1] - rectAPos[0]);
+
+    if (rectARot[0] == rectARot[1] && rectBRot[0] == rectBRot[1]) {
+        // Translations only: the axes don't change, so intersect the time
+        // ranges where they're less than 'tolerance' apart along each of them
+        const SeparatingAxes sat(halfA, rectARot[0], halfB, rectBRot[0]);
+        float tEnter = 0, tExit = 1;
+        for (int i=0; i<4; i++) {
+            const float radius = sat.radius[i] + tolerance;
+            const float s = glm::dot(delta0, sat.axis[i]);
+            const float ds = glm::dot(velocity, sat.axis[i]);
+            if (ds == 0) {
+                if (glm::abs(s) > radius)
+                    return FLT_MAX;
+                continue;
+            }
+            const float t1 = (-radius - s) / ds;
+            const float t2 = (radius - s) / ds;
+            tEnter = glm::max(tEnter, glm::min(t1, t2));
+            tExit = glm::min(tExit, glm::max(t1, t2));
+            if (tEnter > tExit)
+                return FLT_MAX;
+        }
+        return tEnter;
+    }
+
+    // Conservative advancement: no point of B gets closer to A faster than
+    // maxSpeed, so advancing by (gap - tolerance / 2) / maxSpeed keeps them
+    // apart, and stops when they're between tolerance / 2 and tolerance apart.
+    const float maxSpeed = glm::length(velocity) +
+        glm::abs(rectARot[1] - rectARot[0]) * glm::length(halfA) +
+        glm::abs(rectBRot[1] - rectBRot[0]) * glm::length(halfB);
+    auto gapAt = [&] (float t) -> float {
+        const SeparatingAxes sat(halfA, glm::mix(rectARot[0], rectARot[1], t),
+            halfB, glm::mix(rectBRot[0], rectBRot[1], t));
+        return sat.separation(delta0 + velocity * t);
+    };
+    float t = 0;
+    for (int i=0; i<32; i++) {
+        const float gap = gapAt(t);
+        if (gap <= tolerance)
+            return t;
+        // steps get tiny when maxSpeed is far above the actual approach
+        // speed: finish below
+        t += (gap - tolerance * 0.5f) / maxSpeed;
+        if (t > 1)
+            return FLT_MAX;
+    }
+
+    // Not converged: look for the first sample within tolerance in what's
+    // left of the move, then bisect between it and the previous one.
+    #define TOI_SAMPLES 32
+    #define TOI_BISECTIONS 20
+    float lo = t, hi = FLT_MAX;
+    for (int i=1; i<=TOI_SAMPLES; i++) {
+        const float ti = glm::mix(t, 1.0f, i / (float)TOI_SAMPLES);
+        if (gapAt(ti) <= tolerance) {
+            hi = ti;
+            break;
+        }
+        lo = ti;
+    }
+    if (hi == FLT_MAX)
+        return FLT_MAX;
+    for (int i=0; i<TOI_BISECTIONS; i++) {
+        const float mid = (lo + hi) * 0.5f;
+        if (gapAt(mid) <= tolerance)
+            hi = mid;
+        else
+            lo = mid;
+    }
+    return hi;
+}
+
+void RectangleBatch::add(const glm::vec2& position, const glm::vec2& size, float rotation) {
+    if (count == x.size()) {
+        const unsigned capacity = glm::max(16u, count * 2);
+        for (auto* v: { &x, &y, &halfWidth, &halfHeight, &cos, &sin }) {
+            v->resize(capacity);
+        }
+    }
+    x[count] = position.x;
+    y[count] = position.y;
+    halfWidth[count] = size.x * 0.5f;
+    halfHeight[count] = size.y * 0.5f;
+    cos[count] = glm::cos(rotation);
+    sin[count] = glm::sin(rotation);
+    count++;
+}
+
+// Batched kernels are written once against a 'lane' type: ScalarLane handles
+// 1 rectangle at a time, SimdLane 4 of them (when SSE or NEON is available).
+struct ScalarLane {
+    typedef float F;
+    typedef bool M;
+    static const unsigned Width = 1;
+
+    static F set(float v) { return v; }
+    static F load(const std::vector<float>& v, unsigned i) { return v[i]; }
+    static void store(float* out, F v) { *out = v; }
+    static void store(uint8_t* out, M m) { *out = m; }
+
+    static F add(F a, F b) { return a + b; }
+    static F sub(F a, F b) { return a - b; }
+    static F mul(F a, F b) { return a * b; }
+    static F div(F a, F b) { return a / b; }
+    static F abs(F a) { return glm::abs(a); }
+    static F min(F a, F b) { return glm::min(a, b); }
+    static F max(F a, F b) { return glm::max(a, b); }
+    static M le(F a, F b) { return a <= b; }
+    static M both(M a, M b) { return a && b; }
+    static F select(M m, F a, F b) { return m ? a : b; }
+};
+
+#if SIMD_SSE
+struct SimdLane {
+    typedef __m128 F;
+    typedef __m128 M;
+    static const unsigned Width = 4;
+
+    static F set(float v) { return _mm_set1_ps(v); }
+    static F load(const std::vector<float>& v, unsigned i) { return _mm_loadu_ps(&v[i]); }
+    static void store(float* out, F v) { _mm_storeu_ps(out, v); }
+    static void store(uint8_t* out, M m) {
+        const int bits = _mm_movemask_ps(m);
+        for (int i=0; i<4; i++) out[i] = (bits >> i) & 1;
+    }
+
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm_div_ps(a, b); }
+    static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static F min(F a, F b) { return _mm_min_ps(a, b); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); }
+    static M le(F a, F b) { return _mm_cmple_ps(a, b); }
+    static M both(M a, M b) { return _mm_and_ps(a, b); }
+    static F select(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+};
+#elif SIMD_NEON
+struct SimdLane {
+    typedef float32x4_t F;
+    typedef uint32x4_t M;
+    static const unsigned Width = 4;
+
+    static F set(float v) { return vdupq_n_f32(v); }
+    static F load(const std::vector<float>& v, unsigned i) { return vld1q_f32(&v[i]); }
+    static void store(float* out, F v) { vst1q_f32(out, v); }
+    static void store(uint8_t* out, M m) {
+        uint32_t bits[4];
+        vst1q_u32(bits, m);
+        for (int i=0; i<4; i++) out[i] = bits[i] & 1;
+    }
+
+    static F add(F a, F b) { return vaddq_f32(a, b); }
+    static F sub(F a, F b) { return vsubq_f32(a, b); }
+    static F mul(F a, F b) { return vmulq_f32(a, b); }
+    static F div(F a, F b) {
+        // no division on armv7: refine the estimated reciprocal twice
+        F r = vrecpeq_f32(b);
+        r = vmulq_f32(vrecpsq_f32(b, r), r);
+        r = vmulq_f32(vrecpsq_f32(b, r), r);
+        return vmulq_f32(a, r);
+    }
+    static F abs(F a) { return vabsq_f32(a); }
+    static F min(F a, F b) { return vminq_f32(a, b); }
+    static F max(F a, F b) { return vmaxq_f32(a, b); }
+    static M le(F a, F b) { return vcleq_f32(a, b); }
+    static M both(M a, M b) { return vandq_u32(a, b); }
+    static F select(M m, F a, F b) { return vbslq_f32(m, a, b); }
+};
+#endif
+
+// Separating axis test, with A and B axes (4 axes in total)
+template <class L>
+static unsigned rectangleRectanglesKernel(unsigned begin, unsigned end,
+    const glm::vec2& posA, const glm::vec2& halfA, float cosA, float sinA,
+    const RectangleBatch& batch, uint8_t* result) {
+    const typename L::F ax = L::set(posA.x), ay = L::set(posA.y);
+    const typename L::F hwA = L::set(halfA.x), hhA = L::set(halfA.y);
+    const typename L::F cA = L::set(cosA), sA = L::set(sinA);
+
+    unsigned i = begin;
+    for (; i + L::Width <= end; i += L::Width) {
+        const typename L::F tx = L::sub(L::load(batch.x, i), ax);
+        const typename L::F ty = L::sub(L::load(batch.y, i), ay);
+        const typename L::F hw = L::load(batch.halfWidth, i);
+        const typename L::F hh = L::load(batch.halfHeight, i);
+        const typename L::F c = L::load(batch.cos, i);
+        const typename L::F s = L::load(batch.sin, i);
+
+        // |cos| and |sin| of the rotation between A and B
+        const typename L::F dc = L::abs(L::add(L::mul(c, cA), L::mul(s, sA)));
+        const typename L::F ds = L::abs(L::sub(L::mul(s, cA), L::mul(c, sA)));
+
+        // A axes
+        typename L::M overlap = L::le(
+            L::abs(L::add(L::mul(tx, cA), L::mul(ty, sA))),
+            L::add(hwA, L::add(L::mul(hw, dc), L::mul(hh, ds))));
+        overlap = L::both(overlap, L::le(
+            L::abs(L::sub(L::mul(ty, cA), L::mul(tx, sA))),
+            L::add(hhA, L::add(L::mul(hw, ds), L::mul(hh, dc)))));
+        // B axes
+        overlap = L::both(overlap, L::le(
+            L::abs(L::add(L::mul(tx, c), L::mul(ty, s))),
+            L::add(hw, L::add(L::mul(hwA, dc), L::mul(hhA, ds)))));
+        overlap = L::both(overlap, L::le(
+            L::abs(L::sub(L::mul(ty, c), L::mul(tx, s))),
+            L::add(hh, L::add(L::mul(hwA, ds), L::mul(hhA, dc)))));
+
+        L::store(&result[i], overlap);
+    }
+    return i;
+}
+
+template <class L>
+static unsigned rectanglesAABBKernel(unsigned begin, unsigned end,
+    const AABB& aabb, const RectangleBatch& batch, uint8_t* result) {
+    const typename L::F left = L::set(aabb.left), right = L::set(aabb.right);
+    const typename L::F bottom = L::set(aabb.bottom), top = L::set(aabb.top);
+
+    unsigned i = begin;
+    for (; i + L::Width <= end; i += L::Width) {
+        const typename L::F x = L::load(batch.x, i);
+        const typename L::F y = L::load(batch.y, i);
+        const typename L::F hw = L::load(batch.halfWidth, i);
+        const typename L::F hh = L::load(batch.halfHeight, i);
+        const typename L::F c = L::abs(L::load(batch.cos, i));
+        const typename L::F s = L::abs(L::load(batch.sin, i));
+
+        // half size of the rotated rectangle AABB
+        const typename L::F ex = L::add(L::mul(c, hw), L::mul(s, hh));
+        const typename L::F ey = L::add(L::mul(s, hw), L::mul(c, hh));
+
+        typename L::M overlap = L::le(left, L::add(x, ex));
+        overlap = L::both(overlap, L::le(L::sub(x, ex), right));
+        overlap = L::both(overlap, L::le(bottom, L::add(y, ey)));
+        overlap = L::both(overlap, L::le(L::sub(y, ey), top));
+
+        L::store(&result[i], overlap);
+    }
+    return i;
+}
+
+// Slab test in each rectangle base
+template <class L>
+static unsigned lineRectanglesKernel(unsigned begin, unsigned end,
+    const glm::vec2& pA1, const glm::vec2& pA2,
+    const RectangleBatch& batch, float* result) {
+    const typename L::F px = L::set(pA1.x), py = L::set(pA1.y);
+    const typename L::F dx = L::set(pA2.x - pA1.x), dy = L::set(pA2.y - pA1.y);
+    const typename L::F zero = L::set(0.0f), one = L::set(1.0f);
+    const typename L::F tiny = L::set(1e-20f), none = L::set(FLT_MAX);
+
+    unsigned i = begin;
+    for (; i + L::Width <= end; i += L::Width) {
+        const typename L::F hw = L::load(batch.halfWidth, i);
+        const typename L::F hh = L::load(batch.halfHeight, i);
+        const typename L::F c = L::load(batch.cos, i);
+        const typename L::F s = L::load(batch.sin, i);
+        const typename L::F ox = L::sub(px, L::load(batch.x, i));
+        const typename L::F oy = L::sub(py, L::load(batch.y, i));
+
+        // segment in rectangle base
+        const typename L::F lox = L::add(L::mul(ox, c), L::mul(oy, s));
+        const typename L::F loy = L::sub(L::mul(oy, c), L::mul(ox, s));
+        typename L::F ldx = L::add(L::mul(dx, c), L::mul(dy, s));
+        typename L::F ldy = L::sub(L::mul(dy, c), L::mul(dx, s));
+        // avoid 0/0 for axis aligned segments
+        ldx = L::select(L::le(L::abs(ldx), tiny), tiny, ldx);
+        ldy = L::select(L::le(L::abs(ldy), tiny), tiny, ldy);
+
+        const typename L::F tx1 = L::div(L::sub(L::sub(zero, hw), lox), ldx);
+        const typename L::F tx2 = L::div(L::sub(hw, lox), ldx);
+        const typename L::F ty1 = L::div(L::sub(L::sub(zero, hh), loy), ldy);
+        const typename L::F ty2 = L::div(L::sub(hh, loy), ldy);
+
+        const typename L::F tEnter = L::max(L::min(tx1, tx2), L::min(ty1, ty2));
+        const typename L::F tExit = L::min(L::max(tx1, tx2), L::max(ty1, ty2));
+        // starting inside the rectangle: the first border point is the exit
+        const typename L::F t = L::select(L::le(zero, tEnter), tEnter, tExit);
+
+        typename L::M hit = L::le(tEnter, tExit);
+        hit = L::both(hit, L::le(zero, tExit));
+        hit = L::both(hit, L::le(t, one));
+
+        L::store(&result[i], L::select(hit, t, none));
+    }
+    return i;
+}
+
+void IntersectionUtil::rectangleRectangles(const glm::vec2& rectAPos, const glm::vec2& rectASize, float rectARot,
+    const RectangleBatch& batch, uint8_t* result) {
+    const float cosA = glm::cos(rectARot), sinA = glm::sin(rectARot);
+    unsigned done = 0;
+#if SIMD_SSE || SIMD_NEON
+    done = rectangleRectanglesKernel<SimdLane>(0, batch.count, rectAPos, rectASize * 0.5f, cosA, sinA, batch, result);
+#endif
+    rectangleRectanglesKernel<ScalarLane>(done, batch.count, rectAPos, rectASize * 0.5f, cosA, sinA, batch, result);
+}
+
+void IntersectionUtil::rectanglesAABB(const AABB& aabb, const RectangleBatch& batch, uint8_t* result) {
+    unsigned done = 0;
+#if SIMD_SSE || SIMD_NEON
+    done = rectanglesAABBKernel<SimdLane>(0, batch.count, aabb, batch, result);
+#endif
+    rectanglesAABBKernel<ScalarLane>(done, batch.count, aabb, batch, result);
+}
+
+void IntersectionUtil::lineRectangles(const glm::vec2& pA1, const glm::vec2& pA2,
+    const RectangleBatch& batch, float* result) {
+    unsigned done = 0;
+#if SIMD_SSE || SIMD_NEON
+    done = lineRectanglesKernel<SimdLane>(0, batch.count, pA1, pA2, batch, result);
+#endif
+    lineRectanglesKernel<ScalarLane>(done, batch.count, pA1, pA2, batch, result);
+}
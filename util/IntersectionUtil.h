@@ -21,6 +21,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <tuple>
 #include <vector>
 
@@ -31,6 +32,19 @@ struct AABB {
     float left, right, top, bottom;
 };
 
+// Rectangles stored as a structure of arrays, for the batched tests of
+// IntersectionUtil. Meant to be reused: clear() keeps the storage.
+struct RectangleBatch {
+    RectangleBatch() : count(0) {}
+
+    void clear() { count = 0; }
+    void add(const glm::vec2& position, const glm::vec2& size, float rotation);
+
+    unsigned count;
+    // center, half size and rotation (as cos/sin)
+    std::vector<float> x, y, halfWidth, halfHeight, cos, sin;
+};
+
 class IntersectionUtil {
     public:
     static bool
@@ -114,4 +128,40 @@ class IntersectionUtil {
     static void computeAABB(const TransformationComponent* tc,
                             AABB& aabb,
                             bool useRotation = true);
+
+    // Rectangles moving during [0, 1], position and rotation being
+    // interpolated linearly between [0] and [1]. Returns the first time
+    // where they are less than 'tolerance' apart (largest gap along their
+    // separating axes; 0 if they're already that close at t=0), or FLT_MAX
+    // if they don't get that close.
+    static float rectangleRectangleTimeOfImpact(const glm::vec2 rectAPos[2],
+                                                const glm::vec2& rectASize,
+                                                const float rectARot[2],
+                                                const glm::vec2 rectBPos[2],
+                                                const glm::vec2& rectBSize,
+                                                const float rectBRot[2],
+                                                float tolerance);
+
+    // Batched tests: process 4 rectangles at once where SSE or NEON is
+    // available. 'result' must hold batch.count items.
+
+    // result[i] = 1 if batch rectangle i intersects rectangle A, 0 otherwise
+    static void rectangleRectangles(const glm::vec2& rectAPos,
+                                    const glm::vec2& rectASize,
+                                    float rectARot,
+                                    const RectangleBatch& batch,
+                                    uint8_t* result);
+
+    // result[i] = 1 if the AABB of batch rectangle i intersects 'aabb'
+    static void rectanglesAABB(const AABB& aabb,
+                               const RectangleBatch& batch,
+                               uint8_t* result);
+
+    // result[i] = t of the first point of segment [pA1, pA2] (pA1 + t * (pA2
+    // - pA1), t in [0, 1]) on the border of batch rectangle i, or FLT_MAX if
+    // they don't intersect
+    static void lineRectangles(const glm::vec2& pA1,
+                               const glm::vec2& pA2,
+                               const RectangleBatch& batch,
+                               float* result);
 };
@@ -0,0 +1,100 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "OcclusionBuffer.h"
+
+#include <cmath>
+#include <algorithm>
+
+OcclusionBuffer::OcclusionBuffer() {
+    reset(glm::vec2(0.0f), glm::vec2(1.0f), 0);
+}
+
+void OcclusionBuffer::reset(const glm::vec2& pCameraPosition, const glm::vec2& cameraSize, float pCameraRotation) {
+    cameraPosition = pCameraPosition;
+    cameraHalfSize = cameraSize * 0.5f;
+    tilesPerUnit = glm::vec2(OCCLUSION_TILES) / cameraSize;
+    cameraRotation = pCameraRotation;
+    cosR = glm::cos(-cameraRotation);
+    sinR = glm::sin(-cameraRotation);
+    // z is in ]0, 1]: 0 means 'not covered'
+    std::fill(depth, depth + OCCLUSION_TILES * OCCLUSION_TILES, 0.0f);
+}
+
+void OcclusionBuffer::tileBounds(const glm::vec2& position, const glm::vec2& halfSize, float rotation, glm::vec2& min, glm::vec2& max) const {
+    // camera space
+    const glm::vec2 d(position - cameraPosition);
+    const glm::vec2 center(cosR * d.x - sinR * d.y, sinR * d.x + cosR * d.y);
+    const float r = rotation - cameraRotation;
+    const float c = glm::abs(glm::cos(r)), s = glm::abs(glm::sin(r));
+    const glm::vec2 extent(c * halfSize.x + s * halfSize.y, s * halfSize.x + c * halfSize.y);
+
+    min = (center - extent + cameraHalfSize) * tilesPerUnit;
+    max = (center + extent + cameraHalfSize) * tilesPerUnit;
+}
+
+static inline int clampTile(float f) {
+    return std::min(std::max((int)f, 0), OCCLUSION_TILES);
+}
+
+bool OcclusionBuffer::addOccluder(const glm::vec2& position, const glm::vec2& halfSize, float rotation, float z) {
+    // the bounding box is the rectangle itself only if both are aligned
+    const float r = rotation - cameraRotation;
+    if (glm::abs(glm::sin(2 * r)) > 0.001f)
+        return false;
+
+    glm::vec2 min, max;
+    tileBounds(position, halfSize, rotation, min, max);
+
+    // only fully covered tiles
+    const int x0 = clampTile(std::ceil(min.x)), x1 = clampTile(std::floor(max.x));
+    const int y0 = clampTile(std::ceil(min.y)), y1 = clampTile(std::floor(max.y));
+    if (x0 >= x1 || y0 >= y1)
+        return false;
+
+    for (int y=y0; y<y1; y++) {
+        float* row = &depth[y * OCCLUSION_TILES];
+        for (int x=x0; x<x1; x++) {
+            row[x] = std::max(row[x], z);
+        }
+    }
+    return true;
+}
+
+bool OcclusionBuffer::isOccluded(const glm::vec2& position, const glm::vec2& halfSize, float rotation, float z) const {
+    glm::vec2 min, max;
+    tileBounds(position, halfSize, rotation, min, max);
+
+    // every touched tile
+    const int x0 = clampTile(std::floor(min.x)), x1 = clampTile(std::ceil(max.x));
+    const int y0 = clampTile(std::floor(min.y)), y1 = clampTile(std::ceil(max.y));
+    if (x0 >= x1 || y0 >= y1)
+        return false;
+
+    for (int y=y0; y<y1; y++) {
+        const float* row = &depth[y * OCCLUSION_TILES];
+        for (int x=x0; x<x1; x++) {
+            if (row[x] <= z)
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Coarse screen-space occlusion buffer: the camera view is split in
+// OCCLUSION_TILES x OCCLUSION_TILES tiles, each one storing the z of the
+// nearest opaque rectangle fully covering it (bigger z is nearer).
+// Only rectangles aligned with the camera axis are used as occluders.
+#define OCCLUSION_TILES 32
+
+class OcclusionBuffer {
+    public:
+    OcclusionBuffer();
+
+    // Start a new view (all positions/sizes are in world space)
+    void reset(const glm::vec2& cameraPosition,
+               const glm::vec2& cameraSize,
+               float cameraRotation);
+
+    // Returns true if the rectangle covers at least one tile
+    bool addOccluder(const glm::vec2& position,
+                     const glm::vec2& halfSize,
+                     float rotation,
+                     float z);
+
+    // Returns true if every tile touched by the rectangle is covered by an
+    // occluder nearer than z
+    bool isOccluded(const glm::vec2& position,
+                    const glm::vec2& halfSize,
+                    float rotation,
+                    float z) const;
+
+    private:
+    // bounding box of the rectangle, in tiles units
+    void tileBounds(const glm::vec2& position,
+                    const glm::vec2& halfSize,
+                    float rotation,
+                    glm::vec2& min,
+                    glm::vec2& max) const;
+
+    glm::vec2 cameraPosition, cameraHalfSize, tilesPerUnit;
+    float cameraRotation, cosR, sinR;
+    float depth[OCCLUSION_TILES * OCCLUSION_TILES];
+};
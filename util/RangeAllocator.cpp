@@ -0,0 +1,102 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "RangeAllocator.h"
+#include "base/Log.h"
+
+#include <algorithm>
+
+RangeAllocator::RangeAllocator(unsigned initialCapacity, unsigned pMaxCapacity)
+    : currentCapacity(std::min(initialCapacity, pMaxCapacity)), maxCapacity(pMaxCapacity), usedSize(0) {
+    if (currentCapacity)
+        freeRanges[0] = currentCapacity;
+}
+
+bool RangeAllocator::allocate(unsigned size, unsigned* offset) {
+    LOGF_IF(size == 0, "Empty range allocation");
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second >= size) {
+            *offset = it->first;
+            const unsigned remaining = it->second - size;
+            freeRanges.erase(it);
+            if (remaining)
+                freeRanges[*offset + size] = remaining;
+            usedSize += size;
+            return true;
+        }
+    }
+
+    // grow (the free range at the end, if any, will be extended): at least
+    // double the capacity to keep the number of (costly) storage
+    // reallocations low
+    unsigned tail = 0;
+    if (!freeRanges.empty()) {
+        auto last = freeRanges.rbegin();
+        if (last->first + last->second == currentCapacity)
+            tail = last->second;
+    }
+    if (maxCapacity - currentCapacity < size - tail) {
+        LOGW("RangeAllocator full: " << usedSize << '/' << currentCapacity << " used, " << size << " requested");
+        return false;
+    }
+    const unsigned newCapacity = std::min(maxCapacity,
+        std::max(currentCapacity * 2, currentCapacity + size - tail));
+    insertFreeRange(currentCapacity, newCapacity - currentCapacity);
+    currentCapacity = newCapacity;
+    return allocate(size, offset);
+}
+
+void RangeAllocator::release(unsigned offset, unsigned size) {
+    LOGF_IF(offset + size > currentCapacity, "Invalid range release: " << offset << '+' << size << " > " << currentCapacity);
+    usedSize -= size;
+    insertFreeRange(offset, size);
+}
+
+void RangeAllocator::clear() {
+    freeRanges.clear();
+    usedSize = 0;
+    if (currentCapacity)
+        freeRanges[0] = currentCapacity;
+}
+
+void RangeAllocator::insertFreeRange(unsigned offset, unsigned size) {
+    auto next = freeRanges.lower_bound(offset);
+    LOGF_IF(next != freeRanges.end() && next->first < offset + size, "Releasing an already free range: " << offset << '+' << size);
+
+    // merge with previous
+    if (next != freeRanges.begin()) {
+        auto prev = next;
+        --prev;
+        LOGF_IF(prev->first + prev->second > offset, "Releasing an already free range: " << offset << '+' << size);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            freeRanges.erase(prev);
+        }
+    }
+    // merge with next
+    if (next != freeRanges.end() && next->first == offset + size) {
+        size += next->second;
+        freeRanges.erase(next);
+    }
+    freeRanges[offset] = size;
+}
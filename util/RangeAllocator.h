@@ -0,0 +1,52 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <map>
+
+// First-fit allocator of [offset, offset + size) ranges inside a space
+// growing on demand (up to maxCapacity). Released ranges are merged with
+// their free neighbours.
+// Only bookkeeping is done here: the storage itself belongs to the caller.
+class RangeAllocator {
+    public:
+    RangeAllocator(unsigned initialCapacity = 0, unsigned maxCapacity = ~0u);
+
+    // Returns false if there's no room for 'size', even after growing
+    bool allocate(unsigned size, unsigned* offset);
+
+    void release(unsigned offset, unsigned size);
+
+    // forget every allocation (capacity is kept)
+    void clear();
+
+    unsigned capacity() const { return currentCapacity; }
+    unsigned used() const { return usedSize; }
+    unsigned freeRangeCount() const { return freeRanges.size(); }
+
+    private:
+    void insertFreeRange(unsigned offset, unsigned size);
+
+    unsigned currentCapacity, maxCapacity, usedSize;
+    // offset -> size
+    std::map<unsigned, unsigned> freeRanges;
+};
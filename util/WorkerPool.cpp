@@ -0,0 +1,157 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "WorkerPool.h"
+#include "base/Log.h"
+#include <memory>
+#include <algorithm>
+#if !SAC_EMSCRIPTEN
+#include <atomic>
+#endif
+
+WorkerPool& WorkerPool::shared() {
+    static WorkerPool pool;
+    return pool;
+}
+
+#if SAC_EMSCRIPTEN
+WorkerPool::WorkerPool(unsigned) {}
+WorkerPool::~WorkerPool() {}
+void WorkerPool::submit(std::function<void()> job) { job(); }
+void WorkerPool::waitAll() {}
+unsigned WorkerPool::threadCount() const { return 0; }
+
+void WorkerPool::parallelFor(unsigned count, unsigned, const std::function<void(unsigned, unsigned)>& f) {
+    if (count > 0)
+        f(0, count);
+}
+
+#else
+WorkerPool::WorkerPool(unsigned threadCount) : activeCount(0), quit(false) {
+    if (threadCount == 0) {
+        const unsigned cores = std::thread::hardware_concurrency();
+        threadCount = (cores > 1) ? (cores - 1) : 1;
+    }
+    LOGV(1, "Starting " << threadCount << " worker threads");
+    for (unsigned i=0; i<threadCount; i++) {
+        threads.push_back(std::thread(&WorkerPool::run, this));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    waitAll();
+    mutex.lock();
+    quit = true;
+    mutex.unlock();
+    jobAvailable.notify_all();
+    for (auto& t: threads) {
+        t.join();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> job) {
+    mutex.lock();
+    jobs.push_back(std::move(job));
+    activeCount++;
+    mutex.unlock();
+    jobAvailable.notify_one();
+}
+
+void WorkerPool::waitAll() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (activeCount > 0)
+        allDone.wait(lock);
+}
+
+unsigned WorkerPool::threadCount() const {
+    return threads.size();
+}
+
+void WorkerPool::parallelFor(unsigned count, unsigned grain, const std::function<void(unsigned, unsigned)>& f) {
+    if (grain == 0)
+        grain = 1;
+    const unsigned rangeCount = (count + grain - 1) / grain;
+    if (rangeCount <= 1 || threads.empty()) {
+        if (count > 0)
+            f(0, count);
+        return;
+    }
+
+    // Shared with helper jobs, which may start after this call returned
+    struct State {
+        std::atomic<unsigned> next;
+        unsigned done;
+        std::mutex mutex;
+        std::condition_variable cond;
+    };
+    std::shared_ptr<State> state(new State);
+    state->next = 0;
+    state->done = 0;
+
+    // process ranges until none is left
+    auto work = [state, count, grain, rangeCount] (const std::function<void(unsigned, unsigned)>* func) -> void {
+        unsigned processed = 0;
+        unsigned r;
+        while ((r = state->next++) < rangeCount) {
+            const unsigned begin = r * grain;
+            (*func)(begin, std::min(count, begin + grain));
+            processed++;
+        }
+        if (processed) {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->done += processed;
+            if (state->done == rangeCount)
+                state->cond.notify_all();
+        }
+    };
+
+    const unsigned helpers = std::min((unsigned)threads.size(), rangeCount - 1);
+    // f outlives all ranges: helpers starting after the last one don't use it
+    const std::function<void(unsigned, unsigned)>* func = &f;
+    for (unsigned i=0; i<helpers; i++) {
+        submit([work, func] () -> void { work(func); });
+    }
+    work(func);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (state->done < rangeCount)
+        state->cond.wait(lock);
+}
+
+void WorkerPool::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        while (jobs.empty() && !quit)
+            jobAvailable.wait(lock);
+        if (jobs.empty())
+            return;
+
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+
+        job();
+
+        lock.lock();
+        if (--activeCount == 0)
+            allDone.notify_all();
+    }
+}
+#endif
@@ -0,0 +1,69 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+#include <deque>
+#include <vector>
+#if !SAC_EMSCRIPTEN
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// Fixed set of threads running submitted jobs, in submission order.
+// Without thread support (emscripten) jobs are run directly by submit().
+class WorkerPool {
+    public:
+    // threadCount = 0: one thread per core, minus the calling one
+    WorkerPool(unsigned threadCount = 0);
+    // waits for all submitted jobs
+    ~WorkerPool();
+
+    void submit(std::function<void()> job);
+
+    // Block until every submitted job is done
+    void waitAll();
+
+    // Call f(begin, end) on consecutive ranges of at most 'grain' items
+    // covering [0, count), using the workers and the calling thread.
+    // Returns once every range is done; safe to call from a worker job.
+    void parallelFor(unsigned count, unsigned grain,
+                     const std::function<void(unsigned, unsigned)>& f);
+
+    unsigned threadCount() const;
+
+    // Pool shared by CPU bound loops (one thread per core, minus one)
+    static WorkerPool& shared();
+
+    private:
+#if !SAC_EMSCRIPTEN
+    void run();
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()> > jobs;
+    // jobs submitted but not finished yet
+    unsigned activeCount;
+    bool quit;
+    std::mutex mutex;
+    std::condition_variable jobAvailable, allDone;
+#endif
+};
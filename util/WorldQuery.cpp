@@ -0,0 +1,350 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "WorldQuery.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+// keep the cell count (and the grid memory) bounded
+#define MAX_CELL_COUNT 65536
+#define RAYS_PER_JOB 32
+
+static float largestSide(const AABB& a) {
+    return glm::max(a.right - a.left, a.top - a.bottom);
+}
+
+WorldQuery::WorldQuery() : origin(0.0f), size(0), invSize(0), w(0), h(0), extentSum(0), rebuildCount(0) {}
+
+void WorldQuery::clear() {
+    cells.clear();
+    proxies.clear();
+    freeProxies.clear();
+    w = h = 0;
+    size = invSize = 0;
+    extentSum = 0;
+}
+
+void WorldQuery::cellRange(const AABB& bounds, int& x0, int& y0, int& x1, int& y1) const {
+    x0 = glm::clamp((int)glm::floor((bounds.left - origin.x) * invSize), 0, w - 1);
+    y0 = glm::clamp((int)glm::floor((bounds.bottom - origin.y) * invSize), 0, h - 1);
+    x1 = glm::clamp((int)glm::floor((bounds.right - origin.x) * invSize), 0, w - 1);
+    y1 = glm::clamp((int)glm::floor((bounds.top - origin.y) * invSize), 0, h - 1);
+}
+
+bool WorldQuery::inGrid(const AABB& bounds) const {
+    return w > 0 &&
+        bounds.left >= origin.x && bounds.right <= origin.x + w * size &&
+        bounds.bottom >= origin.y && bounds.top <= origin.y + h * size;
+}
+
+int WorldQuery::update(int proxy, Entity e, const glm::vec2& position, const glm::vec2& rectSize, float rotation, int mask) {
+    // proxy may come from a copied component: check it's ours
+    if (proxy >= 0 && proxy < (int)proxies.size() && proxies[proxy].entity == e) {
+        extentSum -= largestSide(proxies[proxy].bounds);
+    } else {
+        if (freeProxies.empty()) {
+            proxy = proxies.size();
+            proxies.push_back(Proxy());
+        } else {
+            proxy = freeProxies.back();
+            freeProxies.pop_back();
+        }
+        proxies[proxy].x0 = -1;
+    }
+
+    Proxy& p = proxies[proxy];
+    const bool maskChanged = (p.x0 >= 0 && p.mask != mask);
+    p.entity = e;
+    p.position = position;
+    p.size = rectSize;
+    p.rotation = rotation;
+    p.mask = mask;
+
+    const float c = glm::abs(glm::cos(rotation)), s = glm::abs(glm::sin(rotation));
+    const glm::vec2 half(
+        (c * rectSize.x + s * rectSize.y) * 0.5f,
+        (s * rectSize.x + c * rectSize.y) * 0.5f);
+    p.bounds.left = position.x - half.x;
+    p.bounds.right = position.x + half.x;
+    p.bounds.bottom = position.y - half.y;
+    p.bounds.top = position.y + half.y;
+    extentSum += largestSide(p.bounds);
+
+    // cells ~2 rectangles wide, see CollisionSystem, but not smaller than
+    // what rebuild allows for this grid (sparse world) or every update
+    // would rebuild it
+    const float target = glm::max(2 * extentSum / count(),
+        glm::sqrt(w * h * size * size / MAX_CELL_COUNT));
+    if (!inGrid(p.bounds) || target > size * 2 || target < size * 0.5f) {
+        rebuild(target);
+        return proxy;
+    }
+
+    int x0, y0, x1, y1;
+    cellRange(p.bounds, x0, y0, x1, y1);
+    if (!maskChanged && p.x0 == x0 && p.y0 == y0 && p.x1 == x1 && p.y1 == y1)
+        return proxy;
+    removeFromCells(p, proxy);
+    insertInCells(p, proxy);
+    return proxy;
+}
+
+void WorldQuery::remove(int proxy, Entity e) {
+    if (proxy < 0 || proxy >= (int)proxies.size() || proxies[proxy].entity != e)
+        return;
+    Proxy& p = proxies[proxy];
+    removeFromCells(p, proxy);
+    extentSum -= largestSide(p.bounds);
+    p.entity = 0;
+    freeProxies.push_back(proxy);
+}
+
+void WorldQuery::rebuild(float cellSize) {
+    rebuildCount++;
+
+    // new bounds: every rectangle, with some room to move before the next
+    // rebuild
+    AABB b;
+    b.left = b.bottom = FLT_MAX;
+    b.right = b.top = -FLT_MAX;
+    for (const auto& p: proxies) {
+        if (!p.entity) continue;
+        b.left = glm::min(b.left, p.bounds.left);
+        b.right = glm::max(b.right, p.bounds.right);
+        b.bottom = glm::min(b.bottom, p.bounds.bottom);
+        b.top = glm::max(b.top, p.bounds.top);
+    }
+    const float margin = glm::max(largestSide(b) * 0.25f, cellSize);
+    const glm::vec2 extent(b.right - b.left + 2 * margin, b.top - b.bottom + 2 * margin);
+
+    size = glm::max(cellSize, glm::sqrt(extent.x * extent.y / MAX_CELL_COUNT));
+    if (size <= 0)
+        size = 1;
+    invSize = 1.0f / size;
+    origin = glm::vec2(b.left - margin, b.bottom - margin);
+    w = glm::max(1, (int)glm::ceil(extent.x * invSize));
+    h = glm::max(1, (int)glm::ceil(extent.y * invSize));
+
+    for (auto& c: cells) {
+        c.proxies.clear();
+        c.mask = 0;
+    }
+    cells.resize(w * h);
+    for (unsigned i=0; i<proxies.size(); i++) {
+        if (!proxies[i].entity) continue;
+        proxies[i].x0 = -1;
+        insertInCells(proxies[i], i);
+    }
+}
+
+void WorldQuery::insertInCells(Proxy& p, int proxy) {
+    cellRange(p.bounds, p.x0, p.y0, p.x1, p.y1);
+    for (int y = p.y0; y <= p.y1; y++) {
+        for (int x = p.x0; x <= p.x1; x++) {
+            Cell& c = cells[x + y * w];
+            c.proxies.push_back(proxy);
+            c.mask |= p.mask;
+        }
+    }
+}
+
+void WorldQuery::removeFromCells(Proxy& p, int proxy) {
+    if (p.x0 < 0)
+        return;
+    for (int y = p.y0; y <= p.y1; y++) {
+        for (int x = p.x0; x <= p.x1; x++) {
+            Cell& c = cells[x + y * w];
+            auto it = std::find(c.proxies.begin(), c.proxies.end(), proxy);
+            if (it == c.proxies.end())
+                continue;
+            *it = c.proxies.back();
+            c.proxies.pop_back();
+            if (c.proxies.empty())
+                c.mask = 0;
+        }
+    }
+    p.x0 = -1;
+}
+
+void WorldQuery::cast(const Ray& ray, Scratch& scratch, Hit& nearest, std::vector<Hit>* all) const {
+    if (w == 0)
+        return;
+
+    // clip the segment to the grid
+    const glm::vec2 d = ray.to - ray.from;
+    float tEnter = 0, tExit = 1;
+    for (int i=0; i<2; i++) {
+        const float lo = origin[i], hi = origin[i] + (i ? h : w) * size;
+        if (d[i] == 0) {
+            if (ray.from[i] < lo || ray.from[i] > hi)
+                return;
+        } else {
+            float t1 = (lo - ray.from[i]) / d[i];
+            float t2 = (hi - ray.from[i]) / d[i];
+            if (t1 > t2) std::swap(t1, t2);
+            tEnter = glm::max(tEnter, t1);
+            tExit = glm::min(tExit, t2);
+        }
+    }
+    if (tEnter > tExit)
+        return;
+
+    // then walk the cells crossed, from http://www.cse.yorku.ca/~amana/research/grid.pdf
+    const glm::vec2 start = (ray.from + d * tEnter - origin) * invSize;
+    int X = glm::clamp((int)glm::floor(start.x), 0, w - 1);
+    int Y = glm::clamp((int)glm::floor(start.y), 0, h - 1);
+    const int stepX = (d.x > 0) ? 1 : ((d.x < 0) ? -1 : 0);
+    const int stepY = (d.y > 0) ? 1 : ((d.y < 0) ? -1 : 0);
+    float tMaxX = stepX ? (origin.x + (X + (stepX > 0)) * size - ray.from.x) / d.x : FLT_MAX;
+    float tMaxY = stepY ? (origin.y + (Y + (stepY > 0)) * size - ray.from.y) / d.y : FLT_MAX;
+    const float tDeltaX = stepX ? size / glm::abs(d.x) : FLT_MAX;
+    const float tDeltaY = stepY ? size / glm::abs(d.y) : FLT_MAX;
+
+    while (true) {
+        const Cell& cell = cells[X + Y * w];
+        if (cell.mask & ray.mask) {
+            scratch.proxies.clear();
+            scratch.shapes.clear();
+            for (auto i: cell.proxies) {
+                const Proxy& p = proxies[i];
+                if ((p.mask & ray.mask) && p.entity != ray.ignore) {
+                    scratch.proxies.push_back(i);
+                    scratch.shapes.add(p.position, p.size, p.rotation);
+                }
+            }
+            if (!scratch.proxies.empty()) {
+                scratch.hits.resize(scratch.proxies.size());
+                IntersectionUtil::lineRectangles(ray.from, ray.to, scratch.shapes, &scratch.hits[0]);
+                for (unsigned i=0; i<scratch.proxies.size(); i++) {
+                    const float t = scratch.hits[i];
+                    if (t == FLT_MAX)
+                        continue;
+                    Hit hit;
+                    hit.entity = proxies[scratch.proxies[i]].entity;
+                    hit.t = t;
+                    hit.point = ray.from + d * t;
+                    if (all)
+                        all->push_back(hit);
+                    if (t < nearest.t)
+                        nearest = hit;
+                }
+            }
+        }
+
+        // nothing further can be nearer than what was found in this cell
+        const float tCellExit = glm::min(tMaxX, tMaxY);
+        if ((!all && nearest.t <= tCellExit) || tCellExit >= tExit)
+            break;
+
+        if (tMaxX < tMaxY) {
+            tMaxX += tDeltaX;
+            X += stepX;
+        } else {
+            tMaxY += tDeltaY;
+            Y += stepY;
+        }
+        if (X >= w || X < 0 || Y >= h || Y < 0)
+            break;
+    }
+}
+
+WorldQuery::Hit WorldQuery::raycast(const Ray& ray) const {
+    Scratch scratch;
+    Hit nearest;
+    cast(ray, scratch, nearest, 0);
+    return nearest;
+}
+
+void WorldQuery::raycast(const Ray* rays, unsigned rayCount, Hit* out) const {
+    WorkerPool::shared().parallelFor(rayCount, RAYS_PER_JOB,
+        [this, rays, out] (unsigned begin, unsigned end) -> void {
+        Scratch scratch;
+        for (unsigned i=begin; i<end; i++) {
+            out[i] = Hit();
+            cast(rays[i], scratch, out[i], 0);
+        }
+    });
+}
+
+void WorldQuery::raycastAll(const Ray& ray, std::vector<Hit>& out) const {
+    Scratch scratch;
+    Hit nearest;
+    out.clear();
+    cast(ray, scratch, nearest, &out);
+
+    // rectangles covering several cells were found once per cell
+    std::sort(out.begin(), out.end(),
+        [] (const Hit& h1, const Hit& h2) -> bool {
+            return h1.t < h2.t || (h1.t == h2.t && h1.entity < h2.entity);
+        }
+    );
+    out.erase(std::unique(out.begin(), out.end(),
+        [] (const Hit& h1, const Hit& h2) -> bool {
+            return h1.entity == h2.entity && h1.t == h2.t;
+        }), out.end());
+}
+
+void WorldQuery::overlapAABB(const AABB& aabb, int mask, std::vector<Entity>& out) const {
+    out.clear();
+    if (w == 0 ||
+        aabb.right < origin.x || aabb.left > origin.x + w * size ||
+        aabb.top < origin.y || aabb.bottom > origin.y + h * size)
+        return;
+
+    int x0, y0, x1, y1;
+    cellRange(aabb, x0, y0, x1, y1);
+
+    Scratch scratch;
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            const Cell& cell = cells[x + y * w];
+            if (!(cell.mask & mask))
+                continue;
+            for (auto i: cell.proxies) {
+                const Proxy& p = proxies[i];
+                // report each rectangle from the first cell it shares with aabb
+                if ((p.mask & mask) &&
+                    glm::max(p.x0, x0) == x && glm::max(p.y0, y0) == y &&
+                    IntersectionUtil::rectangleRectangleAABB(p.bounds, aabb)) {
+                    scratch.proxies.push_back(i);
+                    scratch.shapes.add(p.position, p.size, p.rotation);
+                }
+            }
+        }
+    }
+    if (scratch.proxies.empty())
+        return;
+
+    // then the exact test
+    scratch.overlaps.resize(scratch.proxies.size());
+    IntersectionUtil::rectangleRectangles(
+        glm::vec2((aabb.left + aabb.right) * 0.5f, (aabb.bottom + aabb.top) * 0.5f),
+        glm::vec2(aabb.right - aabb.left, aabb.top - aabb.bottom),
+        0,
+        scratch.shapes,
+        &scratch.overlaps[0]);
+    for (unsigned i=0; i<scratch.proxies.size(); i++) {
+        if (scratch.overlaps[i])
+            out.push_back(proxies[scratch.proxies[i]].entity);
+    }
+}
@@ -0,0 +1,132 @@
+/*
+    This file is part of Soupe Au Caillou.
+
+    @author Soupe au Caillou - Jordane Pelloux-Prayer
+    @author Soupe au Caillou - Gautier Pelloux-Prayer
+    @author Soupe au Caillou - Pierre-Eric Pelloux-Prayer
+
+    Soupe Au Caillou is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, version 3.
+
+    Soupe Au Caillou is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Soupe Au Caillou.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cfloat>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "base/Entity.h"
+#include "util/IntersectionUtil.h"
+
+// Spatial queries (raycasts, overlaps) against a set of rectangles.
+// Rectangles are bucketed in a persistent uniform grid, whose bounds and cell
+// size follow the content: it's rebuilt when a rectangle leaves it, or when
+// the average rectangle size changed a lot. Queries only visit the cells they
+// cross, so their cost depends on what's around them, not on the number of
+// rectangles.
+// Queries don't modify anything: they can run concurrently, but not during
+// updates.
+class WorldQuery {
+    public:
+    struct Ray {
+        Ray() : from(0.0f), to(0.0f), mask(~0), ignore(0) {}
+        Ray(const glm::vec2& f, const glm::vec2& t, int m = ~0, Entity i = 0)
+            : from(f), to(t), mask(m), ignore(i) {}
+
+        // segment tested
+        glm::vec2 from, to;
+        // only rectangles sharing a bit with 'mask' are tested
+        int mask;
+        Entity ignore;
+    };
+
+    struct Hit {
+        Hit() : entity(0), t(FLT_MAX), point(0.0f) {}
+
+        // 0 if nothing was hit
+        Entity entity;
+        // hit point is from + t * (to - from)
+        float t;
+        glm::vec2 point;
+    };
+
+    WorldQuery();
+
+    // Insert (proxy < 0) or move a rectangle. Returns its proxy, to give back
+    // on next calls.
+    int update(int proxy, Entity e, const glm::vec2& position,
+               const glm::vec2& size, float rotation, int mask);
+    void remove(int proxy, Entity e);
+    void clear();
+
+    // nearest rectangle hit by the ray
+    Hit raycast(const Ray& ray) const;
+    // out[i] = raycast(rays[i]), spread on the shared worker pool
+    void raycast(const Ray* rays, unsigned count, Hit* out) const;
+    // every rectangle hit by the ray, nearest first
+    void raycastAll(const Ray& ray, std::vector<Hit>& out) const;
+    // every rectangle intersecting 'aabb'
+    void overlapAABB(const AABB& aabb, int mask, std::vector<Entity>& out) const;
+
+    // number of rectangles
+    unsigned count() const { return proxies.size() - freeProxies.size(); }
+    int width() const { return w; }
+    int height() const { return h; }
+    float cellSize() const { return size; }
+    // grid rebuilds done so far
+    unsigned rebuilds() const { return rebuildCount; }
+
+    private:
+    struct Proxy {
+        Entity entity;
+        glm::vec2 position, size;
+        float rotation;
+        int mask;
+        AABB bounds;
+        // covered cells (x0 < 0: not in the grid)
+        int x0, y0, x1, y1;
+    };
+
+    struct Cell {
+        Cell() : mask(0) {}
+        std::vector<int> proxies;
+        // masks of the rectangles in this cell (may be a superset after
+        // removals, reset when the cell is empty)
+        int mask;
+    };
+
+    // candidates of the cell being tested
+    struct Scratch {
+        std::vector<int> proxies;
+        RectangleBatch shapes;
+        std::vector<float> hits;
+        std::vector<uint8_t> overlaps;
+    };
+
+    void cast(const Ray& ray, Scratch& scratch, Hit& nearest, std::vector<Hit>* all) const;
+    void rebuild(float cellSize);
+    void cellRange(const AABB& bounds, int& x0, int& y0, int& x1, int& y1) const;
+    bool inGrid(const AABB& bounds) const;
+    void insertInCells(Proxy& p, int proxy);
+    void removeFromCells(Proxy& p, int proxy);
+
+    // lower left corner of the grid
+    glm::vec2 origin;
+    float size, invSize;
+    int w, h;
+    std::vector<Cell> cells;
+    std::vector<Proxy> proxies;
+    std::vector<int> freeProxies;
+    // sum of the largest side of all rectangle bounds
+    float extentSum;
+    unsigned rebuildCount;
+};